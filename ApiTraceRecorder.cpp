@@ -0,0 +1,327 @@
+#include "ApiTraceRecorder.h"
+#include "CipherContextPool.h"
+#include "PublicSuffixList.h"
+#include "UrlIndex.h"
+#include <openssl/crypto.h>
+#include <openssl/evp.h>
+#include <openssl/rand.h>
+#include <openssl/sha.h>
+#include <stdexcept>
+
+// Инициализация статических констант
+const std::string ApiTraceRecorder::TRACE_HEADER = "IRONVAULT-API-TRACE";
+const std::string ApiTraceRecorder::TRACE_VERSION = "1";
+
+namespace {
+    const char *const OPERATION_NAMES[] = {
+            "load", "unlock", "save", "lock", "add", "update", "remove", "find",
+            "search", "prefix", "page", "url", "begin", "commit", "rollback"
+    };
+
+    // Значений байта в перестановке обезличивания
+    const size_t PERMUTATION_SIZE = 256;
+
+    // HMAC-SHA256(ключ, префикс) для всех префиксов строки за один проход:
+    // перед каждым завершением копируется состояние внутреннего хеша
+    class PrefixHmac {
+    private:
+        EVP_MD_CTX *inner;   // SHA-256 от (ключ ^ ipad) и уже добавленных байтов
+        EVP_MD_CTX *outer;   // SHA-256 от (ключ ^ opad)
+        EVP_MD_CTX *scratch;
+
+        // Константы
+        static const size_t BLOCK_SIZE = 64;
+
+    public:
+        PrefixHmac(const unsigned char *key, size_t key_length)
+                : inner(EVP_MD_CTX_new()), outer(EVP_MD_CTX_new()), scratch(EVP_MD_CTX_new()) {
+            unsigned char inner_pad[BLOCK_SIZE];
+            unsigned char outer_pad[BLOCK_SIZE];
+            for (size_t i = 0; i < BLOCK_SIZE; ++i) {
+                unsigned char key_byte = i < key_length ? key[i] : 0;
+                inner_pad[i] = key_byte ^ 0x36;
+                outer_pad[i] = key_byte ^ 0x5c;
+            }
+            bool ok = inner && outer && scratch && key_length <= BLOCK_SIZE &&
+                      EVP_DigestInit_ex(inner, EVP_sha256(), nullptr) == 1 &&
+                      EVP_DigestUpdate(inner, inner_pad, BLOCK_SIZE) == 1 &&
+                      EVP_DigestInit_ex(outer, EVP_sha256(), nullptr) == 1 &&
+                      EVP_DigestUpdate(outer, outer_pad, BLOCK_SIZE) == 1;
+            OPENSSL_cleanse(inner_pad, sizeof(inner_pad));
+            OPENSSL_cleanse(outer_pad, sizeof(outer_pad));
+            if (!ok) {
+                EVP_MD_CTX_free(inner);
+                EVP_MD_CTX_free(outer);
+                EVP_MD_CTX_free(scratch);
+                throw std::runtime_error("Failed to initialize trace anonymization");
+            }
+        }
+
+        PrefixHmac(const PrefixHmac &) = delete;
+
+        PrefixHmac &operator=(const PrefixHmac &) = delete;
+
+        ~PrefixHmac() {
+            EVP_MD_CTX_free(inner);
+            EVP_MD_CTX_free(outer);
+            EVP_MD_CTX_free(scratch);
+        }
+
+        void append(unsigned char byte) {
+            if (EVP_DigestUpdate(inner, &byte, 1) != 1) {
+                throw std::runtime_error("Failed to anonymize trace value");
+            }
+        }
+
+        // HMAC добавленных байтов в буфер SHA256_DIGEST_LENGTH байт
+        void digest(unsigned char *out) {
+            unsigned char inner_digest[SHA256_DIGEST_LENGTH];
+            bool ok = EVP_MD_CTX_copy_ex(scratch, inner) == 1 &&
+                      EVP_DigestFinal_ex(scratch, inner_digest, nullptr) == 1 &&
+                      EVP_MD_CTX_copy_ex(scratch, outer) == 1 &&
+                      EVP_DigestUpdate(scratch, inner_digest, sizeof(inner_digest)) == 1 &&
+                      EVP_DigestFinal_ex(scratch, out, nullptr) == 1;
+            OPENSSL_cleanse(inner_digest, sizeof(inner_digest));
+            if (!ok) {
+                throw std::runtime_error("Failed to anonymize trace value");
+            }
+        }
+    };
+
+    // Глубина вызовов API в потоке: записываются только внешние
+    thread_local int call_depth = 0;
+
+    std::string orDash(std::string text) {
+        return text.empty() ? "-" : text;
+    }
+
+    // Список через запятую
+    std::string joinAnonymized(const ApiTraceRecorder &trace, const std::vector<std::string> &values) {
+        std::string joined;
+        for (const auto &value : values) {
+            if (!joined.empty()) {
+                joined += ',';
+            }
+            joined += trace.anonymize(value);
+        }
+        return orDash(joined);
+    }
+}
+
+// Вход в вызов
+ApiTraceRecorder *ApiTraceRecorder::Call::enter(ApiTraceRecorder *trace) {
+    if (!trace || call_depth > 0) {
+        return nullptr;
+    }
+    ++call_depth;
+    return trace;
+}
+
+// Асинхронный вызов, начатый внутри другого вызова, в него и входит
+ApiTraceRecorder *ApiTraceRecorder::Call::enterAsync(ApiTraceRecorder *trace) {
+    return trace && call_depth == 0 ? trace : nullptr;
+}
+
+// Запись строки вызова
+ApiTraceRecorder::Call::~Call() {
+    if (!recorder) {
+        return;
+    }
+    if (holds_depth) {
+        --call_depth;
+    }
+    auto finish = std::chrono::steady_clock::now();
+    int64_t duration_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(finish - start).count();
+    if (std::uncaught_exceptions() > exceptions_at_start) {
+        results = RESULT_ERROR;
+    }
+    try {
+        recorder->writeCall(operation, arguments, start, duration_ns, results);
+    } catch (...) {
+        // Ошибка трассы не должна менять исход вызова
+    }
+}
+
+void ApiTraceRecorder::Call::setResults(size_t count) {
+    results = static_cast<int64_t>(count);
+}
+
+// Конструктор
+ApiTraceRecorder::ApiTraceRecorder(const std::string &file_path)
+        : file(file_path, std::ios::trunc),
+          epoch(std::chrono::steady_clock::now()),
+          snapshot_written(false) {
+    if (!file.is_open()) {
+        throw std::runtime_error("Failed to open API trace file: " + file_path);
+    }
+    if (RAND_bytes(key.data(), static_cast<int>(key.size())) != 1) {
+        throw std::runtime_error("Failed to generate trace anonymization key");
+    }
+    file << TRACE_HEADER << '\n' << TRACE_VERSION << '\n';
+}
+
+// Деструктор
+ApiTraceRecorder::~ApiTraceRecorder() {
+    OPENSSL_cleanse(key.data(), key.size());
+    file.flush();
+}
+
+bool ApiTraceRecorder::hasSnapshot() {
+    std::lock_guard<std::mutex> lock(mutex);
+    return snapshot_written;
+}
+
+// Состояние хранилища: записи без секретов
+void ApiTraceRecorder::writeSnapshot(const std::vector<CredentialRecord> &records) {
+    std::vector<std::string> lines;
+    lines.reserve(records.size());
+    for (const auto &record : records) {
+        lines.push_back(describeRecord(record));
+    }
+
+    std::lock_guard<std::mutex> lock(mutex);
+    if (snapshot_written) {
+        return;
+    }
+    snapshot_written = true;
+    file << "snapshot " << lines.size() << '\n';
+    for (const auto &line : lines) {
+        file << "record " << line << '\n';
+    }
+    file.flush();
+}
+
+// Префиксная замена: байт i заменяется по перестановке 256 значений,
+// своей для каждого префикса text[0, i). Перестановка - тасование
+// Фишера-Йетса на потоке AES-256-CTR с ключом HMAC-SHA256(ключ, префикс),
+// поэтому по заменам соседних байтов нельзя судить о разнице исходных
+std::string ApiTraceRecorder::anonymize(std::string_view text) const {
+    static const char HEX[] = "0123456789abcdef";
+    if (text.empty()) {
+        return "-";
+    }
+    CipherContextPool::Handle ctx = CipherContextPool::local().acquire();
+    PrefixHmac prefix_hmac(key.data(), key.size());
+    unsigned char seed[SHA256_DIGEST_LENGTH];
+    const unsigned char iv[16] = {};
+    static const uint32_t zeros[PERMUTATION_SIZE - 1] = {};
+    uint32_t stream[PERMUTATION_SIZE - 1];
+    unsigned char permutation[PERMUTATION_SIZE];
+
+    std::string result;
+    result.reserve(text.size() * 2);
+    for (char c : text) {
+        int length = 0;
+        prefix_hmac.digest(seed);
+        if (EVP_EncryptInit_ex(ctx.get(), EVP_aes_256_ctr(), nullptr, seed, iv) != 1 ||
+            EVP_EncryptUpdate(ctx.get(), reinterpret_cast<unsigned char *>(stream), &length,
+                              reinterpret_cast<const unsigned char *>(zeros), sizeof(stream)) != 1) {
+            OPENSSL_cleanse(seed, sizeof(seed));
+            throw std::runtime_error("Failed to anonymize trace value");
+        }
+        for (size_t value = 0; value < PERMUTATION_SIZE; ++value) {
+            permutation[value] = static_cast<unsigned char>(value);
+        }
+        // Индекс в [0, last] - старшие биты произведения (смещение меньше 2^-24)
+        for (size_t last = PERMUTATION_SIZE - 1; last > 0; --last) {
+            size_t other = static_cast<size_t>((static_cast<uint64_t>(stream[last - 1]) * (last + 1)) >> 32);
+            std::swap(permutation[last], permutation[other]);
+        }
+        unsigned char mapped = permutation[static_cast<unsigned char>(c)];
+        result += HEX[mapped >> 4];
+        result += HEX[mapped & 0x0f];
+        prefix_hmac.append(static_cast<unsigned char>(c));
+        OPENSSL_cleanse(stream, sizeof(stream));
+    }
+    OPENSSL_cleanse(seed, sizeof(seed));
+    OPENSSL_cleanse(permutation, sizeof(permutation));
+    return result;
+}
+
+// Хост с сохраненным публичным суффиксом
+std::string ApiTraceRecorder::anonymizeHost(std::string_view url) const {
+    NormalizedUrl normalized;
+    if (!UrlIndex::normalize(url, normalized)) {
+        return "-";
+    }
+    if (normalized.is_ip) {
+        return anonymize(normalized.host);
+    }
+
+    // Хост с неизвестным суффиксом обезличивается целиком
+    std::string_view host = normalized.host;
+    std::string_view suffix = PublicSuffixList::publicSuffix(host);
+    if (suffix == host) {
+        return normalized.host;
+    }
+    std::string_view labels = suffix.empty() ? host : host.substr(0, host.size() - suffix.size() - 1);
+    std::string result;
+    while (!labels.empty()) {
+        size_t dot = labels.find('.');
+        result += anonymize(labels.substr(0, dot));
+        result += '.';
+        labels = dot == std::string_view::npos ? std::string_view() : labels.substr(dot + 1);
+    }
+    if (suffix.empty()) {
+        result.pop_back();
+    }
+    result += suffix;
+    return result;
+}
+
+// Запись: имя, категория, хост, длины логина и шифртекста пароля
+std::string ApiTraceRecorder::describeRecord(const CredentialRecord &record) const {
+    return anonymize(record.getServiceName()) + ' ' + anonymize(record.getCategory()) + ' ' +
+           anonymizeHost(record.getUrl()) + ' ' + std::to_string(record.getLogin().size()) + ' ' +
+           std::to_string(record.getEncryptedPassword().size());
+}
+
+// Фильтр: имя и категория обезличены, у остальных запросов - длина
+std::string ApiTraceRecorder::describeFilter(const SearchFilter &filter) const {
+    std::string flags;
+    flags += filter.isCaseSensitive() ? 'c' : '-';
+    flags += filter.isExactMatch() ? 'e' : '-';
+    flags += filter.isSearchInNotes() ? 'n' : '-';
+    flags += filter.getDateFrom() > 0 ? 'f' : '-';
+    flags += filter.getDateTo() > 0 ? 't' : '-';
+
+    return "name=" + anonymize(filter.getServiceNameQuery()) +
+           " login=" + std::to_string(filter.getLoginQuery().size()) +
+           " url=" + std::to_string(filter.getUrlQuery().size()) +
+           " category=" + anonymize(filter.getCategoryQuery()) +
+           " notes=" + std::to_string(filter.getNotesQuery().size()) +
+           " flags=" + flags +
+           " in=" + joinAnonymized(*this, filter.getCategories()) +
+           " out=" + joinAnonymized(*this, filter.getExcludedCategories());
+}
+
+void ApiTraceRecorder::flush() {
+    std::lock_guard<std::mutex> lock(mutex);
+    file.flush();
+}
+
+const char *ApiTraceRecorder::operationName(Operation operation) {
+    return OPERATION_NAMES[static_cast<size_t>(operation)];
+}
+
+bool ApiTraceRecorder::parseOperation(std::string_view name, Operation &out) {
+    for (size_t i = 0; i < std::size(OPERATION_NAMES); ++i) {
+        if (name == OPERATION_NAMES[i]) {
+            out = static_cast<Operation>(i);
+            return true;
+        }
+    }
+    return false;
+}
+
+void ApiTraceRecorder::writeCall(Operation operation, const std::string &arguments,
+                                 std::chrono::steady_clock::time_point start, int64_t duration_ns,
+                                 int64_t results) {
+    int64_t start_us = std::chrono::duration_cast<std::chrono::microseconds>(start - epoch).count();
+    std::lock_guard<std::mutex> lock(mutex);
+    file << "call " << start_us << ' ' << duration_ns << ' ' << operationName(operation) << ' ' << results;
+    if (!arguments.empty()) {
+        file << ' ' << arguments;
+    }
+    file << '\n';
+}
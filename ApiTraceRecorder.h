@@ -0,0 +1,164 @@
+#ifndef IRONVAULT_MANAGER_APITRACERECORDER_H
+#define IRONVAULT_MANAGER_APITRACERECORDER_H
+
+#include "CredentialRecord.h"
+#include "SearchFilter.h"
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Запись обезличенной трассы вызовов API хранилища для воспроизведения
+// (IronVault_Replay). В трассу попадают операция, время начала и
+// длительность, число результатов и форма аргументов; открытых паролей,
+// логинов и мастер-пароля в ней нет.
+// Имена сервисов, категории и метки хостов заменяются шестнадцатеричной
+// записью байтов, каждый из которых переставлен перестановкой, зависящей
+// от случайного ключа и всего предшествующего префикса. Замена взаимно
+// однозначна и сохраняет префиксы, поэтому префиксный поиск, курсоры
+// страниц и совпадения адресов при воспроизведении дают те же записи.
+// Видны длины значений и длины общих префиксов, но не соотношения байтов:
+// у "mail" и "maim" различаются последние байты, и только это. Ключ живет
+// только в памяти, две трассы одного хранилища между собой не сопоставляются.
+// Формат файла (текст, по строке на элемент):
+//   IRONVAULT-API-TRACE
+//   1
+//   snapshot <число записей>              - состояние при первом открытии
+//   record <имя> <категория> <хост> <длина логина> <длина шифртекста пароля>
+//   call <начало, мкс> <длительность, нс> <операция> <результатов> [аргументы]
+// Пустое значение записывается как "-". Записываются только внешние вызовы:
+// вызовы API, сделанные изнутри другого (addRecord из importFromCsv,
+// saveToFile из commit), входят в его время.
+class ApiTraceRecorder {
+public:
+    enum class Operation {
+        Load,
+        Unlock,       // частичная разблокировка категорий
+        Save,
+        Lock,
+        Add,
+        Update,
+        Remove,
+        Find,
+        Search,
+        PrefixSearch,
+        Page,
+        FindByUrl,
+        BeginBatch,
+        Commit,
+        Rollback
+    };
+
+    // Константы
+    static const std::string TRACE_HEADER;
+    static const std::string TRACE_VERSION;
+    static const int64_t RESULT_ERROR = -1; // вызов завершился исключением
+
+    // Область одного вызова: время идет от конца описания аргументов
+    // до разрушения, строка пишется в деструкторе. Без записчика
+    // (recorder == nullptr) и для вложенных вызовов ничего не делает.
+    class Call {
+    private:
+        ApiTraceRecorder *recorder;
+        Operation operation;
+        std::string arguments;
+        std::chrono::steady_clock::time_point start;
+        int64_t results;
+        int exceptions_at_start;
+        bool holds_depth; // вызов занимает глубину вызовов своего потока
+
+    public:
+        // Метка асинхронного вызова: он продолжается и завершается в других
+        // потоках, поэтому глубину вызовов потока не занимает, а вложенные
+        // в него синхронные вызовы записываются отдельно
+        struct Async {
+        };
+
+        template<typename Describe>
+        Call(ApiTraceRecorder *trace, Operation op, Describe &&describe)
+                : recorder(enter(trace)), operation(op), results(0), exceptions_at_start(0),
+                  holds_depth(recorder != nullptr) {
+            if (recorder) {
+                arguments = describe(*recorder);
+                exceptions_at_start = std::uncaught_exceptions();
+                start = std::chrono::steady_clock::now();
+            }
+        }
+
+        // Исключение отмечается по раскрутке стека в потоке завершения
+        template<typename Describe>
+        Call(ApiTraceRecorder *trace, Operation op, Describe &&describe, Async)
+                : recorder(enterAsync(trace)), operation(op), results(0), exceptions_at_start(0),
+                  holds_depth(false) {
+            if (recorder) {
+                arguments = describe(*recorder);
+                start = std::chrono::steady_clock::now();
+            }
+        }
+
+        Call(const Call &) = delete;
+
+        Call &operator=(const Call &) = delete;
+
+        ~Call();
+
+        void setResults(size_t count);
+
+    private:
+        // Внешний вызов потока - записчик, вложенный - nullptr
+        static ApiTraceRecorder *enter(ApiTraceRecorder *trace);
+
+        static ApiTraceRecorder *enterAsync(ApiTraceRecorder *trace);
+    };
+
+private:
+    std::mutex mutex;
+    std::ofstream file;
+    std::array<unsigned char, 32> key; // ключ обезличивания, в файл не пишется
+    std::chrono::steady_clock::time_point epoch;
+    bool snapshot_written;
+
+public:
+    // Конструкторы
+    explicit ApiTraceRecorder(const std::string &file_path);
+
+    ~ApiTraceRecorder();
+
+    ApiTraceRecorder(const ApiTraceRecorder &) = delete;
+
+    ApiTraceRecorder &operator=(const ApiTraceRecorder &) = delete;
+
+    // Состояние хранилища при первом открытии; повторные вызовы ничего не пишут
+    bool hasSnapshot();
+
+    void writeSnapshot(const std::vector<CredentialRecord> &records);
+
+    // Обезличенные значения аргументов (без пробелов, пустое - "-")
+    std::string anonymize(std::string_view text) const;
+
+    // Хост адреса: метки до регистрируемого домена включительно обезличены,
+    // публичный суффикс сохранен (неизвестный тоже обезличен); адрес без
+    // хоста - "-"
+    std::string anonymizeHost(std::string_view url) const;
+
+    std::string describeRecord(const CredentialRecord &record) const;
+
+    std::string describeFilter(const SearchFilter &filter) const;
+
+    void flush();
+
+    static const char *operationName(Operation operation);
+
+    static bool parseOperation(std::string_view name, Operation &out);
+
+private:
+    void writeCall(Operation operation, const std::string &arguments,
+                   std::chrono::steady_clock::time_point start, int64_t duration_ns, int64_t results);
+};
+
+
+#endif //IRONVAULT_MANAGER_APITRACERECORDER_H
@@ -0,0 +1,341 @@
+#include "ApiTraceReplayer.h"
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <limits>
+#include <sstream>
+#include <stdexcept>
+#include <thread>
+#include <unordered_set>
+
+// Инициализация статических констант
+const std::string ApiTraceReplayer::REPLAY_PASSWORD = "ironvault-replay";
+const std::string ApiTraceReplayer::VAULT_FILE_NAME = "replay.dat";
+
+namespace {
+    // Постоянное зерно: синтетическое хранилище одинаково в каждом прогоне
+    const uint64_t RANDOM_SEED = 0x1f0a7c3e5b92d641ULL;
+
+    // Строки трассы не длиннее этого числа полей
+    const size_t MAX_FIELDS = 16;
+
+    std::vector<std::string> splitFields(const std::string &line) {
+        std::vector<std::string> fields;
+        std::istringstream stream(line);
+        std::string field;
+        while (stream >> field && fields.size() < MAX_FIELDS) {
+            fields.push_back(field);
+        }
+        return fields;
+    }
+
+    // "-" - пустое значение
+    std::string valueOf(const std::string &field) {
+        return field == "-" ? std::string() : field;
+    }
+
+    size_t numberOf(const std::string &field) {
+        size_t parsed = 0;
+        size_t value = std::stoull(field, &parsed);
+        if (parsed != field.size()) {
+            throw std::runtime_error("Malformed number in API trace: " + field);
+        }
+        return value;
+    }
+
+    uint64_t nextRandom(uint64_t &state) {
+        uint64_t z = (state += 0x9e3779b97f4a7c15ULL);
+        z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+        z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+        return z ^ (z >> 31);
+    }
+
+    std::string randomText(size_t length, std::string_view alphabet, uint64_t &state) {
+        std::string text(length, ' ');
+        for (auto &c : text) {
+            c = alphabet[nextRandom(state) % alphabet.size()];
+        }
+        return text;
+    }
+
+    std::vector<std::string> splitList(const std::string &field) {
+        std::vector<std::string> values;
+        if (field == "-") {
+            return values;
+        }
+        size_t begin = 0;
+        while (begin <= field.size()) {
+            size_t comma = field.find(',', begin);
+            values.push_back(valueOf(field.substr(begin, comma - begin)));
+            if (comma == std::string::npos) {
+                break;
+            }
+            begin = comma + 1;
+        }
+        return values;
+    }
+
+    const std::string &argument(const std::vector<std::string> &arguments, size_t index) {
+        if (index >= arguments.size()) {
+            throw std::runtime_error("Missing argument in API trace call");
+        }
+        return arguments[index];
+    }
+}
+
+// Перцентиль по ближайшему рангу
+int64_t OperationReplayStats::percentile(std::vector<int64_t> values, double q) {
+    if (values.empty()) {
+        return 0;
+    }
+    size_t rank = static_cast<size_t>(q * static_cast<double>(values.size()));
+    rank = std::min(rank, values.size() - 1);
+    std::nth_element(values.begin(), values.begin() + static_cast<std::ptrdiff_t>(rank), values.end());
+    return values[rank];
+}
+
+int64_t OperationReplayStats::total(const std::vector<int64_t> &values) {
+    int64_t sum = 0;
+    for (int64_t value : values) {
+        sum += value;
+    }
+    return sum;
+}
+
+// Разбор трассы
+ApiTraceReplayer::ApiTraceReplayer(const std::string &trace_path) {
+    std::ifstream file(trace_path);
+    if (!file.is_open()) {
+        throw std::runtime_error("Failed to open API trace: " + trace_path);
+    }
+    std::string line;
+    if (!std::getline(file, line) || line != ApiTraceRecorder::TRACE_HEADER) {
+        throw std::runtime_error("Not an API trace: " + trace_path);
+    }
+    if (!std::getline(file, line) || line != ApiTraceRecorder::TRACE_VERSION) {
+        throw std::runtime_error("Unsupported API trace version: " + line);
+    }
+
+    size_t line_number = 2;
+    while (std::getline(file, line)) {
+        ++line_number;
+        std::vector<std::string> fields = splitFields(line);
+        if (fields.empty()) {
+            continue;
+        }
+        try {
+            if (fields[0] == "record") {
+                snapshot.push_back(parseRecord(fields, 1));
+            } else if (fields[0] == "call") {
+                TraceCall call;
+                call.start_us = static_cast<int64_t>(numberOf(argument(fields, 1)));
+                call.duration_ns = static_cast<int64_t>(numberOf(argument(fields, 2)));
+                if (!ApiTraceRecorder::parseOperation(argument(fields, 3), call.operation)) {
+                    throw std::runtime_error("Unknown operation " + fields[3]);
+                }
+                call.results = std::stoll(argument(fields, 4));
+                call.arguments.assign(fields.begin() + 5, fields.end());
+                calls.push_back(std::move(call));
+            } else if (fields[0] != "snapshot") {
+                throw std::runtime_error("Unknown line type " + fields[0]);
+            }
+        } catch (const std::exception &e) {
+            throw std::runtime_error("API trace line " + std::to_string(line_number) + ": " + e.what());
+        }
+    }
+}
+
+size_t ApiTraceReplayer::getCallCount() const {
+    return calls.size();
+}
+
+size_t ApiTraceReplayer::getSnapshotSize() const {
+    return snapshot.size();
+}
+
+// Синтетическое хранилище и выполнение вызовов по порядку
+ReplayReport ApiTraceReplayer::run(const ReplayOptions &options) const {
+    ReplayReport report;
+    uint64_t random_state = RANDOM_SEED;
+
+    std::filesystem::create_directories(options.work_directory);
+    std::string vault_path = (std::filesystem::path(options.work_directory) / VAULT_FILE_NAME).string();
+    std::filesystem::remove(vault_path);
+    std::filesystem::remove_all(vault_path + ".backups");
+
+    // Исходное состояние; пустой снимок - файла хранилища еще не было
+    if (!snapshot.empty()) {
+        CredentialVault builder(vault_path);
+        builder.setBackupStore(nullptr);
+        if (!builder.loadFromFile(REPLAY_PASSWORD)) {
+            throw std::runtime_error("Failed to create replay vault");
+        }
+        std::unordered_set<std::string> names;
+        for (const auto &description : snapshot) {
+            if (!names.insert(description.service_name).second) {
+                ++report.skipped_records;
+                continue;
+            }
+            builder.addRecord(makeRecord(description, random_state));
+            ++report.snapshot_records;
+        }
+        if (!builder.saveToFile(REPLAY_PASSWORD)) {
+            throw std::runtime_error("Failed to save replay vault");
+        }
+        builder.lockVault();
+    }
+
+    // Трасса, начатая на открытом хранилище, воспроизводится на открытом
+    CredentialVault vault(vault_path);
+    bool starts_with_load = !calls.empty() && (calls.front().operation == ApiTraceRecorder::Operation::Load ||
+                                               calls.front().operation == ApiTraceRecorder::Operation::Unlock);
+    if (!starts_with_load && !vault.loadFromFile(REPLAY_PASSWORD)) {
+        throw std::runtime_error("Failed to open replay vault");
+    }
+
+    auto replay_start = std::chrono::steady_clock::now();
+    int64_t trace_start_us = calls.empty() ? 0 : calls.front().start_us;
+    for (const auto &call : calls) {
+        if (options.realtime && options.speed > 0) {
+            auto offset = std::chrono::microseconds(
+                    static_cast<int64_t>(static_cast<double>(call.start_us - trace_start_us) / options.speed));
+            std::this_thread::sleep_until(replay_start + offset);
+        }
+
+        auto started = std::chrono::steady_clock::now();
+        int64_t results = execute(vault, call, random_state);
+        auto finished = std::chrono::steady_clock::now();
+
+        OperationReplayStats &stats = report.operations[ApiTraceRecorder::operationName(call.operation)];
+        ++stats.count;
+        stats.recorded_ns.push_back(call.duration_ns);
+        stats.replayed_ns.push_back(std::chrono::duration_cast<std::chrono::nanoseconds>(finished - started).count());
+        if (results != call.results) {
+            ++stats.result_mismatches;
+        }
+        ++report.calls;
+    }
+    report.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - replay_start).count();
+    return report;
+}
+
+// Запись снимка: record <имя> <категория> <хост> <длина логина> <длина пароля>
+ApiTraceReplayer::TraceRecord ApiTraceReplayer::parseRecord(const std::vector<std::string> &fields, size_t offset) {
+    TraceRecord record;
+    record.service_name = valueOf(argument(fields, offset));
+    record.category = valueOf(argument(fields, offset + 1));
+    record.host = valueOf(argument(fields, offset + 2));
+    record.login_length = numberOf(argument(fields, offset + 3));
+    record.password_length = numberOf(argument(fields, offset + 4));
+    if (record.service_name.empty()) {
+        throw std::runtime_error("Record without service name");
+    }
+    return record;
+}
+
+// Запись той же формы со случайным содержимым
+CredentialRecord ApiTraceReplayer::makeRecord(const TraceRecord &description, uint64_t &random_state) {
+    static const std::string_view LOGIN_ALPHABET = "abcdefghijklmnopqrstuvwxyz0123456789._";
+    static const std::string_view BASE64_ALPHABET =
+            "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+    std::string url = description.host.empty() ? std::string() : "https://" + description.host + "/";
+    return CredentialRecord(description.service_name, url,
+                            randomText(std::max<size_t>(description.login_length, 1), LOGIN_ALPHABET, random_state),
+                            randomText(description.password_length, BASE64_ALPHABET, random_state),
+                            description.category);
+}
+
+// Фильтр из описания: name= login= url= category= notes= flags= in= out=
+SearchFilter ApiTraceReplayer::makeFilter(const std::vector<std::string> &arguments) {
+    SearchFilter filter;
+    for (const auto &token : arguments) {
+        size_t equals = token.find('=');
+        if (equals == std::string::npos) {
+            throw std::runtime_error("Malformed search argument: " + token);
+        }
+        std::string key = token.substr(0, equals);
+        std::string value = token.substr(equals + 1);
+        if (key == "name") {
+            filter.setServiceNameQuery(valueOf(value));
+        } else if (key == "login") {
+            filter.setLoginQuery(std::string(numberOf(value), 'q'));
+        } else if (key == "url") {
+            filter.setUrlQuery(std::string(numberOf(value), 'q'));
+        } else if (key == "category") {
+            filter.setCategoryQuery(valueOf(value));
+        } else if (key == "notes") {
+            filter.setNotesQuery(std::string(numberOf(value), 'q'));
+        } else if (key == "flags") {
+            filter.setCaseSensitive(value.find('c') != std::string::npos);
+            filter.setExactMatch(value.find('e') != std::string::npos);
+            filter.setSearchInNotes(value.find('n') != std::string::npos);
+            // Открытый диапазон: проверка дат выполняется, записи не отсекаются
+            if (value.find('f') != std::string::npos) {
+                filter.setDateFrom(1);
+            }
+            if (value.find('t') != std::string::npos) {
+                filter.setDateTo(std::numeric_limits<std::time_t>::max());
+            }
+        } else if (key == "in") {
+            filter.setCategories(splitList(value));
+        } else if (key == "out") {
+            filter.setExcludedCategories(splitList(value));
+        }
+    }
+    return filter;
+}
+
+// Один вызов трассы
+int64_t ApiTraceReplayer::execute(CredentialVault &vault, const TraceCall &call, uint64_t &random_state) {
+    using Operation = ApiTraceRecorder::Operation;
+    const auto &arguments = call.arguments;
+    // Неудачная в трассе загрузка стоит того же KDF с неверным паролем
+    const std::string &password = call.results == 0 ? REPLAY_PASSWORD + "-wrong" : REPLAY_PASSWORD;
+    try {
+        switch (call.operation) {
+            case Operation::Load:
+                return vault.loadFromFile(password) ? 1 : 0;
+            case Operation::Unlock:
+                return vault.unlockCategories(password, splitList(argument(arguments, 0))) ? 1 : 0;
+            case Operation::Save:
+                return vault.saveToFile(REPLAY_PASSWORD) ? 1 : 0;
+            case Operation::Lock:
+                vault.lockVault(argument(arguments, 0) == "resident");
+                return 0;
+            case Operation::Add:
+                return vault.addRecord(makeRecord(parseRecord(arguments, 0), random_state)) ? 1 : 0;
+            case Operation::Update:
+                return vault.updateRecord(valueOf(argument(arguments, 0)),
+                                          makeRecord(parseRecord(arguments, 1), random_state)) ? 1 : 0;
+            case Operation::Remove:
+                return vault.removeRecord(valueOf(argument(arguments, 0))) ? 1 : 0;
+            case Operation::Find:
+                return vault.findRecord(valueOf(argument(arguments, 0))) ? 1 : 0;
+            case Operation::Search:
+                return static_cast<int64_t>(vault.searchRecords(makeFilter(arguments)).size());
+            case Operation::PrefixSearch:
+                return static_cast<int64_t>(vault.prefixSearch(valueOf(argument(arguments, 0)),
+                                                               numberOf(argument(arguments, 1))).size());
+            case Operation::Page:
+                return static_cast<int64_t>(vault.getRecordPage(valueOf(argument(arguments, 0)),
+                                                                numberOf(argument(arguments, 1)),
+                                                                valueOf(argument(arguments, 2))).records.size());
+            case Operation::FindByUrl: {
+                std::string host = valueOf(argument(arguments, 0));
+                std::string url = host.empty() ? std::string() : "https://" + host + "/";
+                return static_cast<int64_t>(vault.findByUrl(url, numberOf(argument(arguments, 1))).size());
+            }
+            case Operation::BeginBatch:
+                vault.beginBatch();
+                return 0;
+            case Operation::Commit:
+                return vault.commit(REPLAY_PASSWORD) ? 1 : 0;
+            case Operation::Rollback:
+                vault.rollback();
+                return 0;
+        }
+    } catch (const std::exception &) {
+        return ApiTraceRecorder::RESULT_ERROR;
+    }
+    return ApiTraceRecorder::RESULT_ERROR;
+}
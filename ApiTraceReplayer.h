@@ -0,0 +1,101 @@
+#ifndef IRONVAULT_MANAGER_APITRACEREPLAYER_H
+#define IRONVAULT_MANAGER_APITRACEREPLAYER_H
+
+#include "ApiTraceRecorder.h"
+#include "CredentialVault.h"
+#include <cstdint>
+#include <map>
+#include <string>
+#include <vector>
+
+// Настройки воспроизведения
+struct ReplayOptions {
+    std::string work_directory;  // каталог синтетического хранилища
+    bool realtime = false;       // выдерживать интервалы трассы; иначе вызовы подряд
+    double speed = 1.0;          // ускорение интервалов в режиме realtime
+};
+
+// Задержки одной операции: записанные в трассе и полученные при воспроизведении
+struct OperationReplayStats {
+    size_t count = 0;
+    size_t result_mismatches = 0; // другое число результатов (или исключение только с одной стороны)
+    std::vector<int64_t> recorded_ns;
+    std::vector<int64_t> replayed_ns;
+
+    // Перцентиль по ближайшему рангу, нс; q в [0, 1]
+    static int64_t percentile(std::vector<int64_t> values, double q);
+
+    static int64_t total(const std::vector<int64_t> &values);
+};
+
+// Итог воспроизведения
+struct ReplayReport {
+    size_t snapshot_records = 0;
+    size_t skipped_records = 0;  // совпавшие имена снимка (не воспроизводятся)
+    size_t calls = 0;
+    double seconds = 0;
+    std::map<std::string, OperationReplayStats> operations; // по имени операции
+};
+
+// Воспроизведение трассы ApiTraceRecorder. По снимку строится синтетическое
+// хранилище той же формы: обезличенные имена, категории и хосты, логины и
+// шифртексты паролей случайного содержимого записанной длины (генератор с
+// постоянным зерном - каждый прогон одинаков). Затем вызовы выполняются
+// по порядку под постоянным паролем воспроизведения; неудачная в трассе
+// загрузка повторяется с неверным паролем.
+// Совпадения сохраняются для точных имен, префиксов, курсоров страниц,
+// категорий и адресов; текстовые запросы по логину, адресу и заметкам
+// воспроизводятся строкой той же длины, диапазоны дат - как открытые,
+// поэтому их результаты могут отличаться (см. result_mismatches).
+// Имена и категории сравниваются в обезличенном виде (hex), где регистр
+// исходных символов не сохраняется: поиск без учета регистра находит
+// только точные по байтам совпадения, а "Mail" и "mail" расходятся.
+class ApiTraceReplayer {
+private:
+    struct TraceRecord {
+        std::string service_name;
+        std::string category;
+        std::string host;
+        size_t login_length;
+        size_t password_length;
+    };
+
+    struct TraceCall {
+        int64_t start_us;
+        int64_t duration_ns;
+        ApiTraceRecorder::Operation operation;
+        int64_t results;
+        std::vector<std::string> arguments;
+    };
+
+    std::vector<TraceRecord> snapshot;
+    std::vector<TraceCall> calls;
+
+public:
+    // Константы
+    static const std::string REPLAY_PASSWORD;
+    static const std::string VAULT_FILE_NAME;
+
+    // Конструкторы; исключение, если трасса не читается
+    explicit ApiTraceReplayer(const std::string &trace_path);
+
+    size_t getCallCount() const;
+
+    size_t getSnapshotSize() const;
+
+    ReplayReport run(const ReplayOptions &options) const;
+
+private:
+    static TraceRecord parseRecord(const std::vector<std::string> &fields, size_t offset);
+
+    // Синтетическая запись; random_state - состояние генератора прогона
+    static CredentialRecord makeRecord(const TraceRecord &description, uint64_t &random_state);
+
+    static SearchFilter makeFilter(const std::vector<std::string> &arguments);
+
+    // Выполнение вызова; число результатов или RESULT_ERROR
+    static int64_t execute(CredentialVault &vault, const TraceCall &call, uint64_t &random_state);
+};
+
+
+#endif //IRONVAULT_MANAGER_APITRACEREPLAYER_H
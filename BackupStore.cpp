@@ -0,0 +1,301 @@
+#include "BackupStore.h"
+#include "DataEncryption.h"
+#include "VaultFileIO.h"
+#include "VaultTrace.h"
+#include <algorithm>
+#include <array>
+#include <charconv>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <set>
+#include <sstream>
+#include <stdexcept>
+
+namespace fs = std::filesystem;
+
+namespace {
+    // Таблица gear-хэша: фиксированная псевдослучайная последовательность
+    // (splitmix64), одинаковая во всех сборках - иначе границы фрагментов
+    // разных версий программы не совпадут
+    constexpr std::array<uint64_t, 256> makeGearTable() {
+        std::array<uint64_t, 256> table{};
+        uint64_t state = 0x49524f4e5641554cULL;
+        for (auto &value: table) {
+            state += 0x9e3779b97f4a7c15ULL;
+            uint64_t z = state;
+            z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+            z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+            value = z ^ (z >> 31);
+        }
+        return table;
+    }
+
+    constexpr std::array<uint64_t, 256> GEAR = makeGearTable();
+
+    // Нормализованное разбиение: до среднего размера граница ищется по более
+    // строгой маске, после - по более слабой. Маски берут старшие биты,
+    // которые зависят от последних 64 байт окна.
+    constexpr uint64_t MASK_STRICT = ((uint64_t(1) << 15) - 1) << 49;
+    constexpr uint64_t MASK_LOOSE = ((uint64_t(1) << 11) - 1) << 53;
+
+    std::string toHex(const unsigned char *data, size_t length) {
+        static const char DIGITS[] = "0123456789abcdef";
+        std::string result(length * 2, '\0');
+        for (size_t i = 0; i < length; ++i) {
+            result[2 * i] = DIGITS[data[i] >> 4];
+            result[2 * i + 1] = DIGITS[data[i] & 0x0f];
+        }
+        return result;
+    }
+
+    std::string hashChunk(std::string_view chunk) {
+        unsigned char digest[DataEncryption::DIGEST_LENGTH];
+        DataEncryption::sha256(chunk, digest);
+        return toHex(digest, sizeof(digest));
+    }
+
+    std::string readFile(const std::string &path) {
+        std::optional<std::string> data = VaultFileIO::readFile(path);
+        if (!data) {
+            throw std::runtime_error("Failed to open file: " + path);
+        }
+        return std::move(*data);
+    }
+}
+
+// Инициализация статических констант
+const std::string BackupStore::MANIFEST_HEADER = "IRONVAULT-BACKUP 1";
+
+// Конструктор: каталоги создаются при первой записи
+BackupStore::BackupStore(std::string root_path, size_t max_generations)
+        : root_path(std::move(root_path)), max_generations(max_generations) {
+    if (this->root_path.empty()) {
+        throw std::invalid_argument("Backup root path cannot be empty");
+    }
+    if (max_generations == 0) {
+        throw std::invalid_argument("At least one backup generation must be kept");
+    }
+}
+
+// Новое поколение: записываются только фрагменты, которых еще нет
+uint64_t BackupStore::createGeneration(const std::string &source_path) {
+    IRONVAULT_TRACE_SPAN("backup.create_generation");
+    std::string data = readFile(source_path);
+
+    fs::create_directories(fs::path(root_path) / "chunks");
+    fs::create_directories(fs::path(root_path) / "generations");
+
+    std::vector<uint64_t> ids = listGenerationIds();
+    uint64_t generation_id = ids.empty() ? 1 : ids.back() + 1;
+
+    std::stringstream manifest;
+    std::vector<size_t> boundaries = findChunkBoundaries(data);
+    manifest << MANIFEST_HEADER << "\n";
+    manifest << std::time(nullptr) << " " << data.size() << " " << boundaries.size() << "\n";
+
+    // Новые фрагменты записываются одним пакетом; повторы внутри поколения - один раз
+    std::vector<VaultFileIO::FileWrite> new_chunks;
+    std::set<std::string> queued;
+    size_t begin = 0;
+    for (size_t end: boundaries) {
+        std::string_view chunk(data.data() + begin, end - begin);
+        std::string hash = hashChunk(chunk);
+        std::string path = chunkPath(hash);
+        if (!fs::exists(path) && queued.insert(hash).second) {
+            new_chunks.push_back({std::move(path), chunk});
+        }
+        manifest << hash << " " << chunk.size() << "\n";
+        begin = end;
+    }
+    // Фрагменты закрепляются на диске (fsync файлов и каталога) до записи
+    // манифеста: после сбоя манифест не ссылается на потерянные фрагменты
+    VaultFileIO::writeFilesAtomically(new_chunks, true);
+
+    // Манифест пишется последним: поколение появляется только целиком
+    VaultFileIO::writeFileAtomically(manifestPath(generation_id), manifest.str(), true);
+    prune();
+    return generation_id;
+}
+
+// Восстановление поколения с проверкой хэшей фрагментов
+void BackupStore::restoreGeneration(uint64_t generation_id, const std::string &destination_path) const {
+    IRONVAULT_TRACE_SPAN("backup.restore_generation");
+    std::vector<std::pair<std::string, uint64_t>> chunks;
+    BackupGeneration generation = readManifest(generation_id, &chunks);
+
+    std::string data;
+    data.reserve(generation.size);
+    for (const auto &[hash, size]: chunks) {
+        std::string chunk = readFile(chunkPath(hash));
+        if (chunk.size() != size || hashChunk(chunk) != hash) {
+            throw std::runtime_error("Backup chunk is corrupted: " + hash);
+        }
+        data.append(chunk);
+    }
+    if (data.size() != generation.size) {
+        throw std::runtime_error("Backup generation size mismatch");
+    }
+
+    VaultFileIO::writeFileAtomically(destination_path, data, true);
+}
+
+// Список поколений
+std::vector<BackupGeneration> BackupStore::listGenerations() const {
+    std::vector<BackupGeneration> generations;
+    for (uint64_t id: listGenerationIds()) {
+        generations.push_back(readManifest(id, nullptr));
+    }
+    return generations;
+}
+
+// Удаление старых поколений и фрагментов без ссылок; возвращает число
+// удаленных фрагментов
+size_t BackupStore::prune() {
+    std::vector<uint64_t> ids = listGenerationIds();
+    while (ids.size() > max_generations) {
+        fs::remove(manifestPath(ids.front()));
+        ids.erase(ids.begin());
+    }
+
+    std::set<std::string> referenced;
+    for (uint64_t id: ids) {
+        std::vector<std::pair<std::string, uint64_t>> chunks;
+        readManifest(id, &chunks);
+        for (auto &chunk: chunks) {
+            referenced.insert(std::move(chunk.first));
+        }
+    }
+
+    size_t removed = 0;
+    fs::path chunks_dir = fs::path(root_path) / "chunks";
+    if (!fs::exists(chunks_dir)) {
+        return 0;
+    }
+    for (const auto &entry: fs::directory_iterator(chunks_dir)) {
+        if (referenced.count(entry.path().filename().string()) == 0) {
+            fs::remove(entry.path());
+            ++removed;
+        }
+    }
+    return removed;
+}
+
+// Настройки
+void BackupStore::setMaxGenerations(size_t generations) {
+    if (generations == 0) {
+        throw std::invalid_argument("At least one backup generation must be kept");
+    }
+    max_generations = generations;
+}
+
+size_t BackupStore::getMaxGenerations() const {
+    return max_generations;
+}
+
+const std::string &BackupStore::getRootPath() const {
+    return root_path;
+}
+
+// Разбиение данных на фрагменты
+std::vector<size_t> BackupStore::findChunkBoundaries(std::string_view data) {
+    std::vector<size_t> boundaries;
+    boundaries.reserve(data.size() / AVG_CHUNK_SIZE + 1);
+    const unsigned char *bytes = reinterpret_cast<const unsigned char *>(data.data());
+    size_t offset = 0;
+    while (offset < data.size()) {
+        offset += nextBoundary(bytes + offset, data.size() - offset);
+        boundaries.push_back(offset);
+    }
+    return boundaries;
+}
+
+// Длина очередного фрагмента (FastCDC)
+size_t BackupStore::nextBoundary(const unsigned char *data, size_t length) {
+    if (length <= MIN_CHUNK_SIZE) {
+        return length;
+    }
+    size_t normal = std::min(AVG_CHUNK_SIZE, length);
+    size_t end = std::min(MAX_CHUNK_SIZE, length);
+
+    uint64_t hash = 0;
+    size_t i = MIN_CHUNK_SIZE;
+    for (; i < normal; ++i) {
+        hash = (hash << 1) + GEAR[data[i]];
+        if ((hash & MASK_STRICT) == 0) {
+            return i + 1;
+        }
+    }
+    for (; i < end; ++i) {
+        hash = (hash << 1) + GEAR[data[i]];
+        if ((hash & MASK_LOOSE) == 0) {
+            return i + 1;
+        }
+    }
+    return end;
+}
+
+std::string BackupStore::chunkPath(const std::string &hash) const {
+    return (fs::path(root_path) / "chunks" / hash).string();
+}
+
+std::string BackupStore::manifestPath(uint64_t generation_id) const {
+    std::ostringstream name;
+    name << std::setw(20) << std::setfill('0') << generation_id << ".manifest";
+    return (fs::path(root_path) / "generations" / name.str()).string();
+}
+
+// Чтение манифеста
+BackupGeneration BackupStore::readManifest(uint64_t generation_id,
+                                           std::vector<std::pair<std::string, uint64_t>> *chunks) const {
+    std::ifstream file(manifestPath(generation_id));
+    if (!file.is_open()) {
+        throw std::runtime_error("Backup generation not found: " + std::to_string(generation_id));
+    }
+
+    std::string header;
+    std::getline(file, header);
+    if (header != MANIFEST_HEADER) {
+        throw std::runtime_error("Invalid backup manifest");
+    }
+
+    BackupGeneration generation{generation_id, 0, 0, 0};
+    if (!(file >> generation.created >> generation.size >> generation.chunk_count)) {
+        throw std::runtime_error("Invalid backup manifest");
+    }
+    if (chunks) {
+        chunks->clear();
+        chunks->reserve(generation.chunk_count);
+        std::string hash;
+        uint64_t size = 0;
+        while (file >> hash >> size) {
+            chunks->emplace_back(std::move(hash), size);
+        }
+        if (chunks->size() != generation.chunk_count) {
+            throw std::runtime_error("Backup manifest is truncated");
+        }
+    }
+    return generation;
+}
+
+// Идентификаторы поколений по возрастанию
+std::vector<uint64_t> BackupStore::listGenerationIds() const {
+    std::vector<uint64_t> ids;
+    fs::path generations_dir = fs::path(root_path) / "generations";
+    if (!fs::exists(generations_dir)) {
+        return ids;
+    }
+    for (const auto &entry: fs::directory_iterator(generations_dir)) {
+        if (entry.path().extension() != ".manifest") {
+            continue;
+        }
+        std::string stem = entry.path().stem().string();
+        uint64_t id = 0;
+        auto [end, error] = std::from_chars(stem.data(), stem.data() + stem.size(), id);
+        if (error == std::errc() && end == stem.data() + stem.size()) {
+            ids.push_back(id);
+        }
+    }
+    std::sort(ids.begin(), ids.end());
+    return ids;
+}
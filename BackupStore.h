@@ -0,0 +1,82 @@
+#ifndef IRONVAULT_MANAGER_BACKUPSTORE_H
+#define IRONVAULT_MANAGER_BACKUPSTORE_H
+
+#include <cstdint>
+#include <ctime>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Сведения о сохраненном поколении резервной копии
+struct BackupGeneration {
+    uint64_t id;
+    std::time_t created;
+    uint64_t size;        // размер восстановленного файла
+    size_t chunk_count;
+};
+
+// Хранилище резервных копий с дедупликацией.
+// Файл режется на фрагменты по содержимому (FastCDC на gear-хэше), каждый
+// фрагмент хранится один раз под именем своего SHA-256. Поколение - это
+// манифест со списком фрагментов. Хранится не более max_generations
+// поколений; фрагменты, на которые не ссылается ни один манифест, удаляются.
+//
+// Структура каталога:
+//   <root>/chunks/<sha256>
+//   <root>/generations/<id>.manifest
+class BackupStore {
+private:
+    std::string root_path;
+    size_t max_generations;
+
+    // Константы
+    static const std::string MANIFEST_HEADER;
+
+public:
+    // Параметры разбиения: средний фрагмент 8 КиБ
+    static const size_t MIN_CHUNK_SIZE = 2 * 1024;
+    static const size_t AVG_CHUNK_SIZE = 8 * 1024;
+    static const size_t MAX_CHUNK_SIZE = 64 * 1024;
+    static const size_t DEFAULT_GENERATIONS = 5;
+
+    // Конструкторы
+    explicit BackupStore(std::string root_path, size_t max_generations = DEFAULT_GENERATIONS);
+
+    // Новое поколение из файла; возвращает его идентификатор
+    uint64_t createGeneration(const std::string &source_path);
+
+    // Восстановление поколения в файл (через временный файл и переименование)
+    void restoreGeneration(uint64_t generation_id, const std::string &destination_path) const;
+
+    // Поколения от старого к новому
+    std::vector<BackupGeneration> listGenerations() const;
+
+    // Удаление лишних поколений и неиспользуемых фрагментов
+    size_t prune();
+
+    // Настройки
+    void setMaxGenerations(size_t generations);
+
+    size_t getMaxGenerations() const;
+
+    const std::string &getRootPath() const;
+
+    // Границы фрагментов (концы) для данных
+    static std::vector<size_t> findChunkBoundaries(std::string_view data);
+
+private:
+    std::string chunkPath(const std::string &hash) const;
+
+    std::string manifestPath(uint64_t generation_id) const;
+
+    // Манифест: заголовок поколения и список (хэш, размер)
+    BackupGeneration readManifest(uint64_t generation_id,
+                                  std::vector<std::pair<std::string, uint64_t>> *chunks) const;
+
+    std::vector<uint64_t> listGenerationIds() const;
+
+    static size_t nextBoundary(const unsigned char *data, size_t length);
+};
+
+
+#endif //IRONVAULT_MANAGER_BACKUPSTORE_H
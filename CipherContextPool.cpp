@@ -0,0 +1,104 @@
+#include "CipherContextPool.h"
+#include "VaultMetrics.h"
+#include <openssl/opensslv.h>
+#include <stdexcept>
+
+// Конструктор: запрашиваем реализацию шифра один раз на поток
+CipherContextPool::CipherContextPool()
+        : fetched_cipher(nullptr), cipher(nullptr) {
+#if OPENSSL_VERSION_NUMBER >= 0x30000000L
+    fetched_cipher = EVP_CIPHER_fetch(nullptr, "AES-256-CBC", nullptr);
+    cipher = fetched_cipher;
+#endif
+    if (!cipher) {
+        cipher = EVP_aes_256_cbc();
+    }
+    idle_contexts.reserve(MAX_IDLE_CONTEXTS);
+}
+
+// Деструктор: освобождаем контексты и реализацию шифра
+CipherContextPool::~CipherContextPool() {
+    for (EVP_CIPHER_CTX *ctx: idle_contexts) {
+        EVP_CIPHER_CTX_free(ctx);
+    }
+    idle_contexts.clear();
+#if OPENSSL_VERSION_NUMBER >= 0x30000000L
+    EVP_CIPHER_free(fetched_cipher);
+#endif
+}
+
+// Пул текущего потока
+CipherContextPool &CipherContextPool::local() {
+    thread_local CipherContextPool pool;
+    return pool;
+}
+
+// Получение контекста из пула
+CipherContextPool::Handle CipherContextPool::acquire() {
+    EVP_CIPHER_CTX *ctx = nullptr;
+    if (!idle_contexts.empty()) {
+        ctx = idle_contexts.back();
+        idle_contexts.pop_back();
+        IRONVAULT_METRIC_ADD(MetricCounter::CipherContextHits, 1);
+    } else {
+        IRONVAULT_METRIC_ADD(MetricCounter::CipherContextMisses, 1);
+        ctx = EVP_CIPHER_CTX_new();
+        if (!ctx) {
+            throw std::runtime_error("Failed to create cipher context");
+        }
+    }
+    return Handle(this, ctx);
+}
+
+const EVP_CIPHER *CipherContextPool::getCipher() const {
+    return cipher;
+}
+
+std::vector<unsigned char> &CipherContextPool::scratch() {
+    return scratch_buffer;
+}
+
+// Возврат контекста: сброс стирает ключевой материал
+void CipherContextPool::release(EVP_CIPHER_CTX *ctx) {
+    if (!ctx) {
+        return;
+    }
+    if (EVP_CIPHER_CTX_reset(ctx) != 1 || idle_contexts.size() >= MAX_IDLE_CONTEXTS) {
+        EVP_CIPHER_CTX_free(ctx);
+        return;
+    }
+    idle_contexts.push_back(ctx);
+}
+
+// Handle
+CipherContextPool::Handle::Handle(CipherContextPool *owner, EVP_CIPHER_CTX *context)
+        : pool(owner), ctx(context) {}
+
+CipherContextPool::Handle::Handle(Handle &&other) noexcept
+        : pool(other.pool), ctx(other.ctx) {
+    other.pool = nullptr;
+    other.ctx = nullptr;
+}
+
+CipherContextPool::Handle &CipherContextPool::Handle::operator=(Handle &&other) noexcept {
+    if (this != &other) {
+        if (pool) {
+            pool->release(ctx);
+        }
+        pool = other.pool;
+        ctx = other.ctx;
+        other.pool = nullptr;
+        other.ctx = nullptr;
+    }
+    return *this;
+}
+
+CipherContextPool::Handle::~Handle() {
+    if (pool) {
+        pool->release(ctx);
+    }
+}
+
+EVP_CIPHER_CTX *CipherContextPool::Handle::get() const {
+    return ctx;
+}
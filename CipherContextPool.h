@@ -0,0 +1,70 @@
+#ifndef IRONVAULT_MANAGER_CIPHERCONTEXTPOOL_H
+#define IRONVAULT_MANAGER_CIPHERCONTEXTPOOL_H
+
+#include <vector>
+#include <openssl/evp.h>
+
+// Пул контекстов шифрования, свой для каждого потока.
+// Реализация шифра запрашивается один раз, а контексты сбрасываются
+// и переиспользуются вместо EVP_CIPHER_CTX_new/EVP_CIPHER_CTX_free на каждый вызов.
+class CipherContextPool {
+public:
+    // RAII-обертка над контекстом: при разрушении возвращает контекст в пул
+    class Handle {
+    private:
+        CipherContextPool *pool;
+        EVP_CIPHER_CTX *ctx;
+
+    public:
+        Handle(CipherContextPool *owner, EVP_CIPHER_CTX *context);
+
+        Handle(Handle &&other) noexcept;
+
+        Handle &operator=(Handle &&other) noexcept;
+
+        Handle(const Handle &) = delete;
+
+        Handle &operator=(const Handle &) = delete;
+
+        ~Handle();
+
+        EVP_CIPHER_CTX *get() const;
+    };
+
+private:
+    std::vector<EVP_CIPHER_CTX *> idle_contexts;
+    EVP_CIPHER *fetched_cipher; // реализация AES-256-CBC (OpenSSL 3)
+    const EVP_CIPHER *cipher;
+
+    // Константы
+    static const size_t MAX_IDLE_CONTEXTS = 8;
+
+    CipherContextPool();
+
+public:
+    ~CipherContextPool();
+
+    CipherContextPool(const CipherContextPool &) = delete;
+
+    CipherContextPool &operator=(const CipherContextPool &) = delete;
+
+    // Пул текущего потока
+    static CipherContextPool &local();
+
+    // Получение сброшенного контекста
+    Handle acquire();
+
+    // Заранее запрошенная реализация шифра
+    const EVP_CIPHER *getCipher() const;
+
+    // Рабочий буфер потока для промежуточных (не секретных) данных
+    std::vector<unsigned char> &scratch();
+
+private:
+    void release(EVP_CIPHER_CTX *ctx);
+
+    std::vector<unsigned char> scratch_buffer;
+};
+
+
+#endif //IRONVAULT_MANAGER_CIPHERCONTEXTPOOL_H
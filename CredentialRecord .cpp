@@ -1,32 +1,74 @@
 #include "CredentialRecord .h"
+#include "DataEncryption .h"
 #include "sstream"
 #include "iomanip"
 #include "stdexcept"
+#include <algorithm>
+#include <charconv>
+
+namespace {
+    // Категория по умолчанию ссылается на литерал и не занимает место в арене
+    const std::string_view DEFAULT_CATEGORY = "General";
+
+    // Минимальный блок собственной арены записи
+    const size_t RECORD_ARENA_MIN_CHUNK = 256;
+
+    // Очередная строка без символа перевода строки
+    std::string_view nextLine(std::string_view &data) {
+        size_t end = data.find('\n');
+        std::string_view line = data.substr(0, end);
+        data.remove_prefix(end == std::string_view::npos ? data.size() : end + 1);
+        return line;
+    }
+}
 
 //Конструктор
 CredentialRecord::CredentialRecord()
-        : service_name(""), url(""), login(""), encrypted_password(""),
-          category("General"), internal_key(""), last_modified(std::time(nullptr)) {}
+        : category(DEFAULT_CATEGORY), last_modified(std::time(nullptr)), version(0), origin(0), sequence(0) {}
 
 
 // Параметризованный конструктор
-CredentialRecord::CredentialRecord(const std::string &service, const std::string &url,
-                                   const std::string &login, const std::string &encrypted_password,
-                                   const std::string &category)
-        : service_name(service), url(url), login(login),
-          encrypted_password(encrypted_password), category(category),
-          internal_key(""), last_modified(std::time(nullptr)) {
-
-    if (service_name.empty()) {
+CredentialRecord::CredentialRecord(std::string_view service, std::string_view url,
+                                   std::string_view login, std::string_view encrypted_password,
+                                   std::string_view category)
+        : last_modified(std::time(nullptr)), version(0), origin(0), sequence(0) {
+    assignFields(service, url, login, encrypted_password, category, std::string_view());
+}
+
+// Проверка и копирование всех полей в новую арену одним выделением
+void CredentialRecord::assignFields(std::string_view service, std::string_view url, std::string_view login,
+                                    std::string_view encrypted_password, std::string_view category,
+                                    std::string_view internal_key) {
+    if (service.empty()) {
         throw std::invalid_argument("Service name cannot be empty");
     }
     if (login.empty()) {
         throw std::invalid_argument("Login cannot be empty");
     }
+
+    size_t total = service.size() + url.size() + login.size() +
+                   encrypted_password.size() + category.size() + internal_key.size();
+    arena = std::make_shared<FieldArena>(std::max(total, RECORD_ARENA_MIN_CHUNK));
+    service_name = arena->store(service);
+    this->url = arena->store(url);
+    this->login = arena->store(login);
+    this->encrypted_password = arena->store(encrypted_password);
+    this->category = category.empty() ? DEFAULT_CATEGORY : arena->store(category);
+    this->internal_key = arena->store(internal_key);
+}
+
+// Копирование значения в арену записи. Арена, на которую ссылается кто-то
+// еще (хранилище, другие копии), не изменяется: она не потокобезопасна, а
+// после lockVault обнуляется. Запись сначала переезжает в собственную арену.
+std::string_view CredentialRecord::storeField(std::string_view value) {
+    if (!arena || arena.use_count() > 1) {
+        moveToArena(std::make_shared<FieldArena>(std::max(getFieldBytes() + value.size(), RECORD_ARENA_MIN_CHUNK)));
+    }
+    return arena->store(value);
 }
 
 // Основной метод - возвращает расшифорованный пароль
-std::string CredentialRecord::getPassword(const std::string &decryption_key) const {
+secure_string CredentialRecord::getPassword(const std::string &decryption_key) const {
     return DataEncryption::decrypt(encrypted_password, decryption_key, internal_key);
 }
 
@@ -35,57 +77,131 @@ void CredentialRecord::updateLastModified() {
     last_modified = std::time(nullptr);
 }
 
+void CredentialRecord::setLastModified(std::time_t timestamp) {
+    last_modified = timestamp;
+}
+
 // Сеттеры
-void CredentialRecord::setServiceName(const std::string &name) {
+void CredentialRecord::setServiceName(std::string_view name) {
     if (name.empty()) {
         throw std::invalid_argument("Service name cannot be empty");
     }
-    service_name = name;
+    service_name = storeField(name);
     updateLastModified();
 }
 
-void CredentialRecord::setUrl(const std::string &url) {
-    this->url = url;
+void CredentialRecord::setUrl(std::string_view url) {
+    this->url = storeField(url);
     updateLastModified();
 }
 
-void CredentialRecord::setLogin(const std::string &login) {
+void CredentialRecord::setLogin(std::string_view login) {
     if (login.empty()) {
         throw std::invalid_argument("Login cannot be empty");
     }
-    this->login = login;
+    this->login = storeField(login);
     updateLastModified();
 }
 
-void CredentialRecord::setEncryptedPassword(const std::string &encrypted_password) {
-    this->encrypted_password = encrypted_password;
+void CredentialRecord::setEncryptedPassword(std::string_view encrypted_password) {
+    this->encrypted_password = storeField(encrypted_password);
     updateLastModified();
 }
 
-void CredentialRecord::setCategory(const std::string &category) {
-    this->category = category.empty() ? "General" : category;
+void CredentialRecord::setCategory(std::string_view category) {
+    if (category.empty()) {
+        this->category = DEFAULT_CATEGORY;
+    } else {
+        this->category = storeField(category);
+    }
     updateLastModified();
 }
 
-void CredentialRecord::setInternalKey(const std::string &key) {
-    internal_key = key;
+void CredentialRecord::setInternalKey(std::string_view key) {
+    internal_key = storeField(key);
     updateLastModified();
 }
 
 // Геттеры
-std::string CredentialRecord::getServiceName() const { return service_name; }
+std::string_view CredentialRecord::getServiceName() const { return service_name; }
+
+std::string_view CredentialRecord::getUrl() const { return url; }
+
+std::string_view CredentialRecord::getLogin() const { return login; }
+
+std::string_view CredentialRecord::getEncryptedPassword() const { return encrypted_password; }
 
-std::string CredentialRecord::getUrl() const { return url; }
+std::string_view CredentialRecord::getCategory() const { return category; }
 
-std::string CredentialRecord::getLogin() const { return login; }
+std::string_view CredentialRecord::getInternalKey() const { return internal_key; }
 
-std::string CredentialRecord::getEncryptedPassword() const { return encrypted_password; }
+std::time_t CredentialRecord::getLastModified() const { return last_modified; }
 
-std::string CredentialRecord::getCategory() const { return category; }
+// Версия синхронизации
+uint64_t CredentialRecord::getVersion() const { return version; }
 
-std::string CredentialRecord::getInternalKey() const { return internal_key; }
+uint64_t CredentialRecord::getOrigin() const { return origin; }
+
+void CredentialRecord::setVersion(uint64_t version, uint64_t origin) {
+    this->version = version;
+    this->origin = origin;
+}
+
+uint64_t CredentialRecord::getSequence() const { return sequence; }
+
+void CredentialRecord::setSequence(uint64_t sequence) {
+    this->sequence = sequence;
+}
+
+// Изменение побеждает при большей отметке, при равной - при большем origin
+bool CredentialRecord::isNewerThan(uint64_t other_version, uint64_t other_origin) const {
+    if (version != other_version) {
+        return version > other_version;
+    }
+    return origin > other_origin;
+}
+
+// Перенос полей в другую арену; прежняя арена освобождается,
+// когда на нее не останется ссылок
+void CredentialRecord::moveToArena(const std::shared_ptr<FieldArena> &target) {
+    if (!target) {
+        throw std::invalid_argument("Target arena cannot be null");
+    }
+    if (arena == target) {
+        return;
+    }
+    target->reserve(getFieldBytes());
+    service_name = target->store(service_name);
+    url = target->store(url);
+    login = target->store(login);
+    encrypted_password = target->store(encrypted_password);
+    if (category.data() != DEFAULT_CATEGORY.data()) {
+        category = target->store(category);
+    }
+    internal_key = target->store(internal_key);
+    arena = target;
+}
+
+bool CredentialRecord::moveAllToArena(const std::shared_ptr<FieldArena> &target) {
+    bool moved = arena != target;
+    moveToArena(target);
+    if (category.data() == DEFAULT_CATEGORY.data()) {
+        category = target->store(category);
+        moved = true;
+    }
+    return moved;
+}
 
-std::string CredentialRecord::getLastModified() const { return last_modified; }
+const std::shared_ptr<FieldArena> &CredentialRecord::getArena() const { return arena; }
+
+size_t CredentialRecord::getFieldBytes() const {
+    size_t total = service_name.size() + url.size() + login.size() +
+                   encrypted_password.size() + internal_key.size();
+    if (category.data() != DEFAULT_CATEGORY.data()) {
+        total += category.size();
+    }
+    return total;
+}
 
 // Проверка на путсую запсь
 bool CredentialRecord::isEmpty() const {
@@ -112,27 +228,122 @@ std::string CredentialRecord::serialize() const {
        << encrypted_password << "\n"
        << category << "\n"
        << internal_key << "\n"
-       << last_modified;
+       << last_modified << "\n"
+       << version << " " << origin << " " << sequence;
     return ss.str();
 }
 
-// Десериализация из строки
-CredentialRecord CredentialRecord::deserialize(const std::string& data) {
-    std::stringstream ss(data);
-    CredentialRecord record;
-
-    std::getline(ss, record.service_name);
-    std::getline(ss, record.url);
-    std::getline(ss, record.login);
-    std::getline(ss, record.encrypted_password);
-    std::getline(ss, record.category);
-    std::getline(ss, record.internal_key);
+// Строки полей по порядку, затем время изменения и версия
+template<typename Store>
+void CredentialRecord::parseFields(CredentialRecord &record, std::string_view data, Store &&store, bool legacy) {
+    record.service_name = store(nextLine(data));
+    record.url = store(nextLine(data));
+    record.login = store(nextLine(data));
+    record.encrypted_password = store(nextLine(data));
+    record.category = store(nextLine(data));
+    record.internal_key = store(nextLine(data));
 
-    std::string time_str;
-    std::getline(ss, time_str);
+    std::string_view time_str = nextLine(data);
     if (!time_str.empty()) {
-        record.last_modified = std::stol(time_str);
+        std::time_t parsed = 0;
+        auto [end, error] = std::from_chars(time_str.data(), time_str.data() + time_str.size(), parsed);
+        if (error != std::errc()) {
+            throw std::invalid_argument("Invalid modification time");
+        }
+        record.last_modified = parsed;
+    }
+
+    // Версия синхронизации; в старых файлах строки нет, а отметки получения
+    // нет в файлах до ее появления - тогда она равна версии
+    std::string_view version_str = nextLine(data);
+    if (!version_str.empty()) {
+        const char *begin = version_str.data();
+        const char *end = begin + version_str.size();
+        uint64_t version = 0;
+        uint64_t origin = 0;
+        auto [version_end, version_error] = std::from_chars(begin, end, version);
+        bool valid = version_error == std::errc() && version_end != end && *version_end == ' ';
+        const char *origin_end = end;
+        if (valid) {
+            auto origin_result = std::from_chars(version_end + 1, end, origin);
+            origin_end = origin_result.ptr;
+            valid = origin_result.ec == std::errc();
+        }
+        uint64_t sequence = version;
+        if (valid && origin_end != end) {
+            valid = *origin_end == ' ' && std::from_chars(origin_end + 1, end, sequence).ec == std::errc();
+        }
+        if (!valid) {
+            // В файле 1.0 такая строка - остаток старой разметки, а не версия
+            if (legacy) {
+                return;
+            }
+            throw std::invalid_argument("Invalid record version");
+        }
+        record.version = version;
+        record.origin = origin;
+        record.sequence = sequence;
+    }
+}
+
+// Десериализация из строки: поля копируются напрямую в арену,
+// без промежуточных std::string
+CredentialRecord CredentialRecord::deserialize(std::string_view data, const std::shared_ptr<FieldArena> &arena) {
+    CredentialRecord record;
+    record.arena = arena ? arena : std::make_shared<FieldArena>(std::max(data.size(), RECORD_ARENA_MIN_CHUNK));
+    FieldArena &target = *record.arena;
+    parseFields(record, data, [&target](std::string_view value) { return target.store(value); }, false);
+    return record;
+}
+
+// Разбор в участок арены
+CredentialRecord CredentialRecord::deserialize(std::string_view data, const std::shared_ptr<FieldArena> &arena,
+                                               FieldArena::Region &region, bool legacy) {
+    if (!arena) {
+        throw std::invalid_argument("Arena cannot be null");
     }
+    CredentialRecord record;
+    record.arena = arena;
+    parseFields(record, data, [&region](std::string_view value) { return region.store(value); }, legacy);
+    return record;
+}
+
+// Построитель записи
+CredentialRecord::Builder::Builder()
+        : category("General") {}
+
+CredentialRecord::Builder &CredentialRecord::Builder::withServiceName(std::string value) {
+    service_name = std::move(value);
+    return *this;
+}
+
+CredentialRecord::Builder &CredentialRecord::Builder::withUrl(std::string value) {
+    url = std::move(value);
+    return *this;
+}
+
+CredentialRecord::Builder &CredentialRecord::Builder::withLogin(std::string value) {
+    login = std::move(value);
+    return *this;
+}
 
+CredentialRecord::Builder &CredentialRecord::Builder::withEncryptedPassword(std::string value) {
+    encrypted_password = std::move(value);
+    return *this;
+}
+
+CredentialRecord::Builder &CredentialRecord::Builder::withCategory(std::string value) {
+    category = std::move(value);
+    return *this;
+}
+
+CredentialRecord::Builder &CredentialRecord::Builder::withInternalKey(std::string value) {
+    internal_key = std::move(value);
+    return *this;
+}
+
+CredentialRecord CredentialRecord::Builder::build() {
+    CredentialRecord record;
+    record.assignFields(service_name, url, login, encrypted_password, category, internal_key);
     return record;
-}
\ No newline at end of file
+}
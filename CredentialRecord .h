@@ -1,62 +1,112 @@
 #ifndef CREDENTIALRECORD_H
 #define CREDENTIALRECORD_H
 
+#include <cstdint>
+#include <memory>
 #include <string>
+#include <string_view>
 #include <ctime>
-
+#include "SecureMemory.h"
+#include "FieldArena.h"
+
+// Строковые поля записи хранятся в FieldArena, запись содержит только
+// представления на них. Копии записи разделяют арену только для чтения:
+// сеттер дописывает значение в арену, лишь если запись - ее единственный
+// владелец, иначе сначала переносит поля в собственную арену (копирование
+// при записи). Поэтому изменение копии не трогает арену хранилища и
+// другие копии. Зашифрованный пароль и внутренний ключ хранятся текстом
+// DataEncryption, как в файле, а не отдельными бинарными полями.
 class CredentialRecord {
 private:
-    std::string service_name; // название сервиса
-    std::string url; // URL-адрес сервиса
-    std::string login; // логин
-    std::string encrypted_password; // зашифрованный пароль
-    std::string category; // категория
-    std::string internal_key; // внутренний ключ для шифрования
+    std::string_view service_name; // название сервиса
+    std::string_view url; // URL-адрес сервиса
+    std::string_view login; // логин
+    std::string_view encrypted_password; // зашифрованный пароль
+    std::string_view category; // категория
+    std::string_view internal_key; // внутренний ключ для шифрования
     std::time_t last_modified; // дата последнего изменения
+    uint64_t version; // отметка Лэмпорта последнего изменения (0 - не синхронизировалась)
+    uint64_t origin; // идентификатор реплики, сделавшей изменение
+    uint64_t sequence; // отметка часов этой реплики, когда изменение попало в нее (для выгрузки дельт)
+    std::shared_ptr<FieldArena> arena; // хранилище полей
 
 
 
 public:
+    class Builder;
+
     // Конструкторы
     CredentialRecord();
 
-    CredentialRecord(const std::string &service, const std::string &url,
-                     const std::string &login, const std::string &encrypted_password,
-                     const std::string &category = "General");
+    // Поля копируются в собственную арену записи одним выделением
+    CredentialRecord(std::string_view service, std::string_view url,
+                     std::string_view login, std::string_view encrypted_password,
+                     std::string_view category = "General");
 
 
     // Основные методы
-    std::string getPassword(const std::string &decryption_key) const;// возвращает расшифрованный пароль
+    secure_string getPassword(const std::string &decryption_key) const;// возвращает расшифрованный пароль
     void updateLastModified();
 
+    // Явная отметка времени (одна на весь пакет изменений хранилища)
+    void setLastModified(std::time_t timestamp);
+
     // Сеттеры
-    void setServiceName(const std::string &name);
+    void setServiceName(std::string_view name);
 
-    void setUrl(const std::string &url);
+    void setUrl(std::string_view url);
 
-    void setLogin(const std::string &login);
+    void setLogin(std::string_view login);
 
-    void setEncryptedPassword(const std::string &encrypted_password);
+    void setEncryptedPassword(std::string_view encrypted_password);
 
-    void setCategory(const std::string &category);
+    void setCategory(std::string_view category);
 
-    void setInternalKey(const std::string &key);
+    void setInternalKey(std::string_view key);
 
-    // Геттеры
-    std::string getServiceName() const;
+    // Геттеры (представления действительны, пока жива арена записи
+    // и пока хранилище, которому она принадлежит, не заблокировано)
+    std::string_view getServiceName() const;
 
-    std::string getUrl() const;
+    std::string_view getUrl() const;
 
-    std::string getLogin() const;
+    std::string_view getLogin() const;
 
-    std::string getEncryptedPassword() const;
+    std::string_view getEncryptedPassword() const;
 
-    std::string getCategory() const;
+    std::string_view getCategory() const;
 
-    std::string getInternalKey() const;
+    std::string_view getInternalKey() const;
 
     std::time_t getLastModified() const;
 
+    // Версия для синхронизации реплик: сравнивается пара (version, origin)
+    uint64_t getVersion() const;
+
+    uint64_t getOrigin() const;
+
+    void setVersion(uint64_t version, uint64_t origin);
+
+    // Локальная отметка получения: изменение, пришедшее от другой реплики,
+    // получает новую отметку и поэтому попадает в дельты этой реплики
+    uint64_t getSequence() const;
+
+    void setSequence(uint64_t sequence);
+
+    bool isNewerThan(uint64_t other_version, uint64_t other_origin) const;
+
+    // Перенос полей в другую арену (например, общую арену хранилища)
+    void moveToArena(const std::shared_ptr<FieldArena> &target);
+
+    // То же, но и категория по умолчанию копируется в target: после этого
+    // ни одно поле записи не лежит вне арены. false - запись уже была там
+    bool moveAllToArena(const std::shared_ptr<FieldArena> &target);
+
+    const std::shared_ptr<FieldArena> &getArena() const;
+
+    // Суммарный размер строковых полей
+    size_t getFieldBytes() const;
+
     // Вспомогательные мтеоды
     bool isEmpty() const;
 
@@ -65,8 +115,56 @@ public:
     // сохранение в файл
     std::string serialize() const;
 
-    static CredentialRecord deserialize(const std::string &data);
+    // Поля копируются в arena; без арены создается собственная
+    static CredentialRecord deserialize(std::string_view data,
+                                        const std::shared_ptr<FieldArena> &arena = nullptr);
+
+    // Поля копируются в заранее выделенный участок region арены arena;
+    // участку нужно не больше data.size() байт. Для параллельного разбора:
+    // сама арена не изменяется. legacy - запись файла 1.0: строка версии,
+    // которая не разбирается, означает, что версии нет.
+    static CredentialRecord deserialize(std::string_view data, const std::shared_ptr<FieldArena> &arena,
+                                        FieldArena::Region &region, bool legacy = false);
+
+private:
+    void assignFields(std::string_view service, std::string_view url, std::string_view login,
+                      std::string_view encrypted_password, std::string_view category,
+                      std::string_view internal_key);
+
+    std::string_view storeField(std::string_view value);
+
+    template<typename Store>
+    static void parseFields(CredentialRecord &record, std::string_view data, Store &&store, bool legacy);
+};
+
+// Построитель записи: поля накапливаются здесь и копируются в арену записи
+// одним выделением при build()
+class CredentialRecord::Builder {
+private:
+    std::string service_name;
+    std::string url;
+    std::string login;
+    std::string encrypted_password;
+    std::string category;
+    std::string internal_key;
+
+public:
+    Builder();
+
+    Builder &withServiceName(std::string value);
+
+    Builder &withUrl(std::string value);
+
+    Builder &withLogin(std::string value);
+
+    Builder &withEncryptedPassword(std::string value);
+
+    Builder &withCategory(std::string value);
+
+    Builder &withInternalKey(std::string value);
 
+    // Проверяет обязательные поля и создает запись
+    CredentialRecord build();
 };
 
 #endif
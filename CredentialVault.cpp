@@ -1,21 +1,164 @@
 #include "CredentialVault.h"
-#include <fstream>
+#include "ParallelRunner.h"
+#include "VaultFileIO.h"
+#include "VaultMetrics.h"
+#include "VaultTrace.h"
+#include <filesystem>
 #include <sstream>
 #include <algorithm>
 #include <ctime>
 #include <iostream>
 #include <iomanip>
+#include <iterator>
+#include <map>
+#include <charconv>
+#include <cstdint>
+#include <unordered_map>
+#include <openssl/hmac.h>
 
 // Инициализация статических констант
 const std::string CredentialVault::VAULT_HEADER = "IRONVAULT";
 const std::string CredentialVault::VAULT_VERSION = "1.0";
+const std::string CredentialVault::VAULT_SEGMENTED_VERSION = "2.0";
+const std::string CredentialVault::VAULT_COMPRESSED_VERSION = "2.1";
+const std::string CredentialVault::DEFAULT_CLIENT_ID = "local";
+const std::string CredentialVault::DELTA_HEADER = "IRONVAULT-DELTA";
+const std::string CredentialVault::DELTA_VERSION = "2";
+
+namespace {
+    const std::string_view RECORD_BEGIN = "---RECORD---";
+    const std::string_view RECORD_END = "---END_RECORD---";
+    // RECORD_END отдельной строкой: так запись заканчивается в файлах 2.x
+    const std::string_view RECORD_END_LINE = "\n---END_RECORD---\n";
+
+    // Разбор записей: меньшие объемы разбираются в вызывающем потоке,
+    // большие делятся на шарды не меньше PARSE_SHARD_MIN_BYTES
+    const size_t PARALLEL_PARSE_MIN_BYTES = 1024 * 1024;
+    const size_t PARSE_SHARD_MIN_BYTES = 256 * 1024;
+    // Порция распакованного сегмента, разбираемая за раз
+    const size_t PARSE_BATCH_BYTES = 8 * 1024 * 1024;
+
+    // Данные записи: [begin, end) между строками RECORD_BEGIN и RECORD_END
+    struct RecordSpan {
+        size_t begin;
+        size_t end;
+    };
+
+    // Первая строка, целиком равная line, не раньше from.
+    // string_view::find ищет первый символ через memchr
+    size_t findLine(std::string_view data, std::string_view line, size_t from) {
+        for (size_t hit = data.find(line, from); hit != std::string_view::npos; hit = data.find(line, hit + 1)) {
+            size_t after = hit + line.size();
+            if ((hit == 0 || data[hit - 1] == '\n') && (after == data.size() || data[after] == '\n')) {
+                return hit;
+            }
+        }
+        return std::string_view::npos;
+    }
+
+    // Конец блока записи не раньше from. В файле 1.0 запись писалась без
+    // перевода строки в конце, и RECORD_END дописан к строке времени
+    // изменения: в режиме legacy принимается и он
+    size_t findRecordEnd(std::string_view data, size_t from, bool legacy) {
+        for (size_t hit = data.find(RECORD_END, from); hit != std::string_view::npos;
+             hit = data.find(RECORD_END, hit + 1)) {
+            size_t after = hit + RECORD_END.size();
+            if (after != data.size() && data[after] != '\n') {
+                continue;
+            }
+            size_t line_start = data.rfind('\n', hit == 0 ? 0 : hit - 1);
+            line_start = hit == 0 || line_start == std::string_view::npos ? 0 : line_start + 1;
+            if (line_start == hit) {
+                return hit;
+            }
+            std::string_view prefix = data.substr(line_start, hit - line_start);
+            if (legacy && line_start >= from &&
+                std::all_of(prefix.begin(), prefix.end(), [](char c) { return c >= '0' && c <= '9'; })) {
+                return hit;
+            }
+        }
+        return std::string_view::npos;
+    }
+
+    // Границы всех записей. Строки вне блоков пропускаются; блок без
+    // RECORD_END продолжается до конца данных
+    std::vector<RecordSpan> findRecordSpans(std::string_view data, bool legacy) {
+        std::vector<RecordSpan> spans;
+        size_t position = 0;
+        while (position < data.size()) {
+            size_t begin_line = findLine(data, RECORD_BEGIN, position);
+            if (begin_line == std::string_view::npos) {
+                break;
+            }
+            size_t begin = std::min(data.size(), begin_line + RECORD_BEGIN.size() + 1);
+            size_t end_line = findRecordEnd(data, begin, legacy);
+            if (end_line == std::string_view::npos) {
+                spans.push_back(RecordSpan{begin, data.size()});
+                break;
+            }
+            spans.push_back(RecordSpan{begin, end_line});
+            position = end_line + RECORD_END.size() + 1;
+        }
+        return spans;
+    }
+
+    // Число строк, целиком равных line
+    size_t countLines(std::string_view data, std::string_view line) {
+        size_t count = 0;
+        for (size_t hit = findLine(data, line, 0); hit != std::string_view::npos;
+             hit = findLine(data, line, hit + line.size())) {
+            ++count;
+        }
+        return count;
+    }
+
+    // Очередная строка без символа перевода строки
+    std::string_view nextLine(std::string_view &data) {
+        size_t end = data.find('\n');
+        std::string_view line = data.substr(0, end);
+        data.remove_prefix(end == std::string_view::npos ? data.size() : end + 1);
+        return line;
+    }
+
+    // Десятичное число в начале строки; возвращает остаток после пробела
+    std::string_view parseNumber(std::string_view text, uint64_t &value) {
+        auto [end, error] = std::from_chars(text.data(), text.data() + text.size(), value);
+        if (error != std::errc()) {
+            throw std::runtime_error("Invalid number in vault data");
+        }
+        text.remove_prefix(end - text.data());
+        if (!text.empty() && text.front() == ' ') {
+            text.remove_prefix(1);
+        }
+        return text;
+    }
+
+    // Производный ключ HMAC-SHA256(vault_key, label)
+    secure_vector<unsigned char> deriveSubkey(const secure_vector<unsigned char> &vault_key, std::string_view label) {
+        secure_vector<unsigned char> key(DataEncryption::KEY_LENGTH);
+        unsigned int key_length = 0;
+        if (!HMAC(EVP_sha256(), vault_key.data(), static_cast<int>(vault_key.size()),
+                  reinterpret_cast<const unsigned char*>(label.data()), label.size(), key.data(), &key_length) ||
+            key_length != key.size()) {
+            throw std::runtime_error("Failed to derive vault subkey");
+        }
+        return key;
+    }
+}
 
 
 // Конструктор по умолчанию
 CredentialVault::CredentialVault()
         : vault_file_path("ironvault.dat"),
           master_password_hash(""),
-          is_authenticated(false) {
+          is_authenticated(false),
+          field_arena(std::make_shared<FieldArena>()),
+          async_call_active(false),
+          backup_store(std::make_shared<BackupStore>(vault_file_path + ".backups")),
+          compression_codec(VaultCompression::Codec::None),
+          lamport_clock(0),
+          replica_id(0),
+          loaded_record_markers(0) {
     initializePasswordGenerator();
 }
 
@@ -23,142 +166,934 @@ CredentialVault::CredentialVault()
 CredentialVault::CredentialVault(const std::string& file_path)
         : vault_file_path(file_path),
           master_password_hash(""),
-          is_authenticated(false) {
+          is_authenticated(false),
+          field_arena(std::make_shared<FieldArena>()),
+          async_call_active(false),
+          backup_store(std::make_shared<BackupStore>(vault_file_path + ".backups")),
+          compression_codec(VaultCompression::Codec::None),
+          lamport_clock(0),
+          replica_id(0),
+          loaded_record_markers(0) {
     initializePasswordGenerator();
 }
 // Загрузка хранилища из файла
-bool CredentialVault::loadFromFile(const std::string& master_password) {
+bool CredentialVault::loadFromFile(const std::string& master_password, const std::string& client_id) {
+    bool loaded;
+    {
+        ApiTraceRecorder::Call trace_call(api_trace.get(), ApiTraceRecorder::Operation::Load,
+                                          [](ApiTraceRecorder&) { return std::string(); });
+        ensureNoAsyncCall();
+        loaded = loadVault(master_password, nullptr, client_id);
+        trace_call.setResults(loaded ? 1 : 0);
+    }
+    traceSnapshot();
+    return loaded;
+}
+
+// Частичная разблокировка: расшифровываются только сегменты указанных категорий
+bool CredentialVault::unlockCategories(const std::string& master_password,
+                                       const std::vector<std::string>& categories,
+                                       const std::string& client_id) {
+    if (categories.empty()) {
+        throw std::invalid_argument("At least one category must be specified");
+    }
+    bool loaded;
+    {
+        ApiTraceRecorder::Call trace_call(api_trace.get(), ApiTraceRecorder::Operation::Unlock,
+                                          [&categories](ApiTraceRecorder& trace) {
+                                              std::string described;
+                                              for (const auto& category : categories) {
+                                                  described += (described.empty() ? "" : ",") +
+                                                               trace.anonymize(category);
+                                              }
+                                              return described;
+                                          });
+        ensureNoAsyncCall();
+        loaded = loadVault(master_password, &categories, client_id);
+        trace_call.setResults(loaded ? 1 : 0);
+    }
+    traceSnapshot();
+    return loaded;
+}
+
+// Общая загрузка; categories == nullptr - все категории
+bool CredentialVault::loadVault(const std::string& master_password,
+                                const std::vector<std::string>* categories,
+                                const std::string& client_id) {
     if (master_password.empty()) {
         throw std::invalid_argument("Master password cannot be empty");
     }
+    IRONVAULT_METRIC_TIMER(MetricOperation::LoadVault);
+    IRONVAULT_TRACE_SPAN("vault.load");
+
+    std::optional<std::string> file_data;
+    if (!isResidentFresh(categories)) {
+        file_data = readVaultFile();
+    }
+    return openVault(master_password, categories, client_id, file_data);
+}
 
-    std::ifstream file(vault_file_path, std::ios::binary);
-    if (!file.is_open()) {
+// Содержимое файла хранилища; nullopt, если файла нет
+std::optional<std::string> CredentialVault::readVaultFile() const {
+    IRONVAULT_TRACE_SPAN("vault.read_file");
+    return VaultFileIO::readFile(vault_file_path);
+}
+
+// Открытие прочитанного файла или записей, оставленных в памяти
+bool CredentialVault::openVault(const std::string& master_password,
+                                const std::vector<std::string>* categories,
+                                const std::string& client_id,
+                                std::optional<std::string>& file_data) {
+    // Загрузка заменяет все записи: журнал открытого пакета к ним не относится
+    batch.reset();
+
+    // Записи в памяти годятся, только если файл не менялся после блокировки
+    // и запрошены все категории
+    if (resident && !isResidentFresh(categories)) {
+        clearUnlockedState();
+        // Файл изменился после проверки перед чтением
+        if (!file_data) {
+            file_data = readVaultFile();
+        }
+    }
+
+    if (!resident && !file_data) {
         // Файл не существует - создаем новое хранилище
-        master_password_hash = MasterPasswordManager::hashPassword(master_password);
+        master_verifier = PasswordVerifier::create(master_password);
+        master_password_hash = master_verifier->encode();
+        sealed_segments.clear();
+        segment_cache.clear();
+        vault_salt.clear();
+        tombstones.clear();
+        lamport_clock = 0;
+        replica_id = generateReplicaId();
         is_authenticated = true;
         return true;
     }
-    try {
-        // Читаем зашифрованные данные
-        std::stringstream encrypted_buffer;
-        encrypted_buffer << file.rdbuf();
-        file.close();
 
-        std::string encrypted_data = encrypted_buffer.str();
-        if (encrypted_data.empty()) {
-            throw std::runtime_error("Vault file is empty or corrupted");
+    // Ограничиваем попытки разблокировки до вычисления KDF
+    std::optional<UnlockGate::Permit> permit;
+    if (unlock_gate) {
+        permit.emplace(unlock_gate->tryAcquire(client_id));
+        if (!*permit) {
+            throw UnlockRejectedError(permit->getDecision(), permit->getRetryAfter());
         }
+    }
 
-        // Дешифруем данные
-        std::string decrypted_data = decryptVaultData(encrypted_data, master_password);
-        / Проверяем заголовок
-        if (!validateVaultHeader(decrypted_data)) {
-            throw std::runtime_error("Invalid vault file format");
+    // Ошибка здесь (в том числе неверный пароль) не трогает записи в памяти
+    if (resident) {
+        try {
+            unlockResident(master_password);
+        } catch (const std::exception& e) {
+            std::cerr << "Failed to unlock vault: " << e.what() << std::endl;
+            IRONVAULT_METRIC_ADD(MetricCounter::LoadFailures, 1);
+            if (permit) {
+                permit->recordResult(false);
+            }
+            return false;
+        }
+        if (permit) {
+            permit->recordResult(true);
         }
+        return true;
+    }
+
+    return decodeVault(*file_data, master_password, categories, permit);
+}
 
-        // Парсим данные
-        std::stringstream data_stream(decrypted_data);
-        std::string line;
+// Файл не менялся после блокировки с сохранением записей и запрошены все категории
+bool CredentialVault::isResidentFresh(const std::vector<std::string>* categories) const {
+    return resident && !categories && !resident->file_stamp.empty() && resident->file_stamp == fileStamp();
+}
 
-        // Пропускаем заголовок
-        std::getline(data_stream, line); // header
-        std::getline(data_stream, line); // version
-        std::getline(data_stream, master_password_hash);
+// Загрузка из уже прочитанного содержимого файла
+bool CredentialVault::loadFromData(const std::string& file_data, const std::string& master_password) {
+    ensureNoAsyncCall();
+    if (master_password.empty()) {
+        throw std::invalid_argument("Master password cannot be empty");
+    }
+    IRONVAULT_METRIC_TIMER(MetricOperation::LoadVault);
+    IRONVAULT_TRACE_SPAN("vault.load_data");
+    batch.reset();
+    if (resident) {
+        clearUnlockedState();
+    }
+    std::optional<UnlockGate::Permit> permit;
+    return decodeVault(file_data, master_password, nullptr, permit);
+}
 
-        // Читаем записи
-        records.clear();
-        while (std::getline(data_stream, line)) {
-            if (line == "---RECORD---") {
-                std::string record_data;
-                while (std::getline(data_stream, line) && line != "---END_RECORD---") {
-                    record_data += line + "\n";
-                }
-                if (!record_data.empty()) {
-                    try {
-                        CredentialRecord record = CredentialRecord::deserialize(record_data);
-                        records.push_back(record);
-                    } catch (const std::exception& e) {
-                        std::cerr << "Warning: Failed to parse record: " << e.what() << std::endl;
-                    }
-                }
-            }
+// Разбор содержимого файла любой версии; при ошибке записи в памяти сбрасываются
+bool CredentialVault::decodeVault(const std::string& encrypted_data, const std::string& master_password,
+                                  const std::vector<std::string>* categories,
+                                  std::optional<UnlockGate::Permit>& permit) {
+    try {
+        if (encrypted_data.empty()) {
+            throw std::runtime_error("Vault file is empty or corrupted");
         }
 
+        // Формат 1.0 не делится на сегменты и всегда загружается целиком
+        if (isSegmentedVault(encrypted_data)) {
+            loadSegmentedVault(encrypted_data, master_password, categories, permit);
+        } else {
+            loadLegacyVault(encrypted_data, master_password, permit);
+        }
+
+        {
+            IRONVAULT_TRACE_SPAN("vault.verify_hash");
+            refreshMasterVerifier(master_password);
+        }
+        initializeReplication();
+
         is_authenticated = true;
-        sortRecords();
+        {
+            IRONVAULT_TRACE_SPAN_ARG("vault.index_records", "records", records.size());
+            rebuildIndexes();
+        }
         return true;
 
     } catch (const std::exception& e) {
         std::cerr << "Failed to load vault: " << e.what() << std::endl;
+        IRONVAULT_METRIC_ADD(MetricCounter::LoadFailures, 1);
+        if (permit) {
+            permit->recordResult(false);
+        }
+        // Частично разобранные записи не проиндексированы
+        records.clear();
+        name_index.clear();
+        url_index.clear();
         is_authenticated = false;
         return false;
     }
 }
 
+// Загрузка формата 1.0: весь файл зашифрован ключом из мастер-пароля
+void CredentialVault::loadLegacyVault(const std::string& encrypted_data, const std::string& master_password,
+                                      std::optional<UnlockGate::Permit>& permit) {
+    // Дешифруем данные
+    secure_string decrypted_data;
+    {
+        IRONVAULT_TRACE_SPAN_ARG("vault.decrypt", "bytes", encrypted_data.size());
+        decrypted_data = decryptVaultData(encrypted_data, master_password);
+    }
+    // Проверяем заголовок
+    {
+        IRONVAULT_TRACE_SPAN("vault.validate_header");
+        if (!validateVaultHeader(decrypted_data)) {
+            throw std::runtime_error("Invalid vault file format");
+        }
+    }
+    if (permit) {
+        permit->recordResult(true);
+    }
+
+    // Парсим данные
+    std::string_view data = decrypted_data.view();
+
+    // Пропускаем заголовок
+    nextLine(data); // header
+    nextLine(data); // version
+    master_password_hash.assign(nextLine(data));
+
+    // Поля всех записей копируются в одну арену одним выделением
+    records.clear();
+    sealed_segments.clear();
+    segment_cache.clear();
+    vault_salt.clear();
+    clearSessionKeys();
+    tombstones.clear();
+    lamport_clock = 0;
+    replica_id = 0;
+    field_arena = std::make_shared<FieldArena>();
+    field_arena->reserve(data.size());
+    loaded_record_markers = countLines(data, RECORD_BEGIN);
+    parseRecords(data, records, true);
+}
+
+// Загрузка формата 2.x: один KDF для ключа хранилища, затем расшифровка
+// индекса и только запрошенных сегментов; остальные остаются запечатанными.
+// Версия 2.1 отличается строкой кодека сжатия после версии.
+void CredentialVault::loadSegmentedVault(std::string_view file_data, const std::string& master_password,
+                                         const std::vector<std::string>* categories,
+                                         std::optional<UnlockGate::Permit>& permit) {
+    nextLine(file_data); // header
+    std::string_view version = nextLine(file_data);
+    VaultCompression::Codec codec = VaultCompression::Codec::None;
+    if (version == VAULT_COMPRESSED_VERSION) {
+        codec = VaultCompression::parseCodec(nextLine(file_data));
+    } else if (version != VAULT_SEGMENTED_VERSION) {
+        throw std::runtime_error("Unsupported vault version");
+    }
+
+    std::vector<unsigned char> salt;
+    DataEncryption::decodeBase64(nextLine(file_data), salt);
+    if (salt.size() != DataEncryption::SALT_LENGTH) {
+        throw std::runtime_error("Invalid vault salt");
+    }
+
+    // Ключ хранилища: из кэша сессии или через KDF
+    secure_vector<unsigned char> vault_key;
+    bool cached = key_cache && key_cache->lookup(master_password, salt, vault_key);
+    if (!cached) {
+        vault_key = DataEncryption::deriveKey(master_password, salt);
+    }
+
+    // Индекс: хэш мастер-пароля и ключи сегментов; MAC индекса проверяет пароль
+    secure_string index;
+    {
+        IRONVAULT_TRACE_SPAN("vault.decrypt_index");
+        index = DataEncryption::decryptWithKey(nextLine(file_data), vault_key.data());
+    }
+    if (permit) {
+        permit->recordResult(true);
+    }
+    // В кэш попадают только ключи, прошедшие проверку MAC индекса
+    if (key_cache && !cached) {
+        key_cache->store(master_password, salt, vault_key);
+    }
+    setSessionKeys(vault_key);
+
+    std::string_view index_data = index.view();
+    master_password_hash.assign(nextLine(index_data));
+    size_t segment_count = 0;
+    std::string_view count_str = nextLine(index_data);
+    auto [count_end, count_error] = std::from_chars(count_str.data(), count_str.data() + count_str.size(),
+                                                    segment_count);
+    if (count_error != std::errc()) {
+        throw std::runtime_error("Invalid vault index");
+    }
+
+    records.clear();
+    sealed_segments.clear();
+    segment_cache.clear();
+    tombstones.clear();
+    lamport_clock = 0;
+    replica_id = 0;
+    loaded_record_markers = 0;
+    field_arena = std::make_shared<FieldArena>();
+    compression_codec = codec;
+
+    // Позиция сегмента в индексе -> номер в sealed_segments
+    std::vector<size_t> sealed_at(segment_count, SIZE_MAX);
+    for (size_t i = 0; i < segment_count; ++i) {
+        // Строка индекса: обернутый ключ, число записей, категория
+        std::string_view entry = nextLine(index_data);
+        size_t key_end = entry.find(' ');
+        size_t count_pos = key_end == std::string_view::npos ? key_end : entry.find(' ', key_end + 1);
+        if (count_pos == std::string_view::npos) {
+            throw std::runtime_error("Invalid vault index entry");
+        }
+        std::string_view wrapped_key = entry.substr(0, key_end);
+        std::string_view record_count_str = entry.substr(key_end + 1, count_pos - key_end - 1);
+        std::string_view category = entry.substr(count_pos + 1);
+        size_t record_count = 0;
+        auto [record_count_end, record_count_error] = std::from_chars(
+                record_count_str.data(), record_count_str.data() + record_count_str.size(), record_count);
+        if (record_count_error != std::errc() ||
+            record_count_end != record_count_str.data() + record_count_str.size()) {
+            throw std::runtime_error("Invalid vault index entry");
+        }
+
+        std::string_view segment = nextLine(file_data);
+        if (segment.empty()) {
+            throw std::runtime_error("Vault segment is missing");
+        }
+
+        if (categories && std::find(categories->begin(), categories->end(), category) == categories->end()) {
+            sealed_at[i] = sealed_segments.size();
+            sealed_segments.push_back(SealedSegment{std::string(category), std::string(wrapped_key),
+                                                    std::string(segment), record_count, {}, false});
+            continue;
+        }
+
+        IRONVAULT_TRACE_SPAN_ARG("vault.decrypt_segment", "bytes", segment.size());
+        secure_string data_key = DataEncryption::decryptWithKey(wrapped_key, vault_key.data());
+        if (data_key.size() != DataEncryption::KEY_LENGTH) {
+            throw std::runtime_error("Invalid segment key");
+        }
+        secure_string segment_data = DataEncryption::decryptWithKey(
+                segment, reinterpret_cast<const unsigned char *>(data_key.data()));
+        records.reserve(records.size() + record_count);
+        field_arena->reserve(segment_data.size());
+
+        // Распаковка потоком: полные записи разбираются по мере поступления,
+        // так что целиком распакованный сегмент в памяти не собирается
+        DataEncryption::Sha256 hash;
+        secure_string pending;
+        VaultCompression::decompress(codec, segment_data.view(), [&](std::string_view piece) {
+            hash.update(piece);
+            pending.append(piece);
+            // Порция режется только по строке RECORD_END: то же значение
+            // внутри поля записи не конец записи
+            size_t last_end = pending.size() < PARSE_BATCH_BYTES ? std::string_view::npos
+                                                                 : pending.view().rfind(RECORD_END_LINE);
+            if (last_end != std::string_view::npos) {
+                size_t complete = last_end + RECORD_END_LINE.size();
+                loaded_record_markers += countLines(pending.view().substr(0, complete), RECORD_BEGIN);
+                parseRecords(pending.view().substr(0, complete), records);
+                pending.erase(0, complete);
+            }
+        });
+        loaded_record_markers += countLines(pending.view(), RECORD_BEGIN);
+        parseRecords(pending.view(), records);
+
+        unsigned char digest[DataEncryption::DIGEST_LENGTH];
+        hash.finish(digest);
+        cacheSegment(category, digest, reinterpret_cast<const unsigned char *>(data_key.data()), codec, segment);
+    }
+
+    // Хвост индекса: часы Лэмпорта, идентификатор реплики, отметки удаления
+    // и имена сервисов сегментов (для проверки уникальности при частичной
+    // разблокировке)
+    while (!index_data.empty()) {
+        std::string_view line = nextLine(index_data);
+        std::string_view kind = line.substr(0, line.find(' '));
+        line.remove_prefix(std::min(line.size(), kind.size() + 1));
+        if (kind == "clock") {
+            uint64_t clock = 0;
+            line = parseNumber(line, clock);
+            parseNumber(line, replica_id);
+            lamport_clock = std::max(lamport_clock, clock);
+        } else if (kind == "removed" || kind == "tombstone") {
+            // "tombstone" - запись до появления отметок получения
+            Tombstone tombstone{};
+            line = parseNumber(line, tombstone.version);
+            line = parseNumber(line, tombstone.origin);
+            tombstone.sequence = tombstone.version;
+            if (kind == "removed") {
+                line = parseNumber(line, tombstone.sequence);
+            }
+            tombstone.service_name.assign(line);
+            tombstones.push_back(std::move(tombstone));
+        } else if (kind == "name") {
+            size_t position = 0;
+            line = parseNumber(line, position);
+            if (position < segment_count && sealed_at[position] != SIZE_MAX) {
+                SealedSegment& sealed = sealed_segments[sealed_at[position]];
+                sealed.service_names.emplace_back(line);
+                sealed.names_known = true;
+            }
+        }
+    }
+    for (auto& sealed : sealed_segments) {
+        std::sort(sealed.service_names.begin(), sealed.service_names.end());
+        // Пустой сегмент не пишет строк имен, но его имена известны
+        sealed.names_known = sealed.names_known || sealed.record_count == 0;
+    }
+
+    vault_salt = std::move(salt);
+}
+
+// Разбор блоков ---RECORD--- ... ---END_RECORD--- в арену хранилища.
+// Границы находятся одним проходом, записи разбираются шардами параллельно.
+// Поля записи не длиннее ее текста, поэтому участок арены повторяет
+// разметку входных данных: каждая запись пишет в свою часть участка,
+// и потокам не нужна общая арена. Порядок записей и предупреждений
+// совпадает с разбором в одном потоке.
+void CredentialVault::parseRecords(std::string_view data, std::vector<CredentialRecord>& out, bool legacy) {
+    IRONVAULT_TRACE_SPAN_ARG("vault.parse_records", "bytes", data.size());
+    std::vector<RecordSpan> spans = findRecordSpans(data, legacy);
+    if (spans.empty()) {
+        return;
+    }
+    size_t first = spans.front().begin;
+    size_t covered = spans.back().end - first;
+    FieldArena::Region region = field_arena->carve(covered);
+
+    // Шарды - подряд идущие записи примерно равного объема
+    size_t thread_count = covered < PARALLEL_PARSE_MIN_BYTES ? 1 : ParallelRunner::defaultThreadCount();
+    size_t shard_bytes = std::max(PARSE_SHARD_MIN_BYTES, covered / (thread_count * 4));
+    std::vector<size_t> shard_starts;
+    for (size_t i = 0, boundary = first; i < spans.size(); ++i) {
+        if (spans[i].begin >= boundary) {
+            shard_starts.push_back(i);
+            boundary = spans[i].begin + shard_bytes;
+        }
+    }
+
+    struct Shard {
+        std::vector<CredentialRecord> records;
+        std::vector<std::string> errors;
+    };
+    std::vector<Shard> shards(shard_starts.size());
+    ParallelRunner::forEach(shards.size(), thread_count, [&](size_t index) {
+        size_t from = shard_starts[index];
+        size_t to = index + 1 < shard_starts.size() ? shard_starts[index + 1] : spans.size();
+        Shard& shard = shards[index];
+        shard.records.reserve(to - from);
+        for (size_t i = from; i < to; ++i) {
+            const RecordSpan& span = spans[i];
+            if (span.begin == span.end) {
+                continue;
+            }
+            FieldArena::Region part = region.slice(span.begin - first, span.end - span.begin);
+            try {
+                shard.records.push_back(CredentialRecord::deserialize(
+                        data.substr(span.begin, span.end - span.begin), field_arena, part, legacy));
+            } catch (const std::exception& e) {
+                shard.errors.emplace_back(e.what());
+            }
+        }
+    });
+
+    // Неразобранная запись - ошибка загрузки: иначе следующее сохранение
+    // окончательно удалит ее из файла
+    for (const auto& shard : shards) {
+        if (!shard.errors.empty()) {
+            throw std::runtime_error("Failed to parse record: " + shard.errors.front());
+        }
+    }
+    out.reserve(out.size() + spans.size());
+    for (auto& shard : shards) {
+        std::move(shard.records.begin(), shard.records.end(), std::back_inserter(out));
+    }
+}
+
 // Сохранение хранилища в файл
 bool CredentialVault::saveToFile(const std::string& master_password) {
+    ApiTraceRecorder::Call trace_call(api_trace.get(), ApiTraceRecorder::Operation::Save,
+                                      [](ApiTraceRecorder&) { return std::string(); });
+    ensureNoAsyncCall();
     if (!is_authenticated) {
         throw std::runtime_error("Vault is not authenticated");
     }
+    ensureNoBatch();
     if (master_password.empty()) {
         throw std::invalid_argument("Master password cannot be empty");
     }
-
-    // Создаем резервную копию
-    backupVaultFile();
+    IRONVAULT_METRIC_TIMER(MetricOperation::SaveVault);
+    IRONVAULT_TRACE_SPAN("vault.save");
 
     try {
-        // Формируем данные для сохранения
-        std::stringstream data_stream;
-        data_stream << createVaultHeader();
-        data_stream << master_password_hash << "\n";
+        std::string encrypted_data = buildSegmentedVault(master_password);
+        writeVaultFile(encrypted_data);
+        trace_call.setResults(1);
 
-        // Сериализуем записи
-        for (const auto& record : records) {
-            data_stream << "---RECORD---\n";
-            data_stream << record.serialize();
-            data_stream << "---END_RECORD---\n";
-        }
+        return true;
+
+    } catch (const std::exception& e) {
+        std::cerr << "Failed to save vault: " << e.what() << std::endl;
+        IRONVAULT_METRIC_ADD(MetricCounter::SaveFailures, 1);
+        return false;
+    }
+}
 
-        std::string data = data_stream.str();
-        std::string encrypted_data = encryptVaultData(data, master_password);
+// Резервная копия и запись файла
+void CredentialVault::writeVaultFile(const std::string& file_data) {
+    // Создаем резервную копию
+    {
+        IRONVAULT_TRACE_SPAN("vault.backup");
+        backupVaultFile();
+    }
 
-        // Сохраняем в файл
-        std::ofstream file(vault_file_path, std::ios::binary);
-        if (!file.is_open()) {
-            throw std::runtime_error("Failed to open vault file for writing");
+    // Сохраняем в файл: замена целиком, данные на диске до возврата
+    {
+        IRONVAULT_TRACE_SPAN_ARG("vault.write_file", "bytes", file_data.size());
+        VaultFileIO::writeFileAtomically(vault_file_path, file_data, true);
+    }
+    IRONVAULT_METRIC_ADD(MetricCounter::SaveBytes, file_data.size());
+}
+
+// Асинхронная загрузка: чтение в Io, KDF и разбор в Cpu
+VaultTask<bool> CredentialVault::loadAsync(std::string master_password, std::string client_id) {
+    AsyncCallScope async_call(async_call_active);
+    bool loaded = false;
+    {
+        ApiTraceRecorder::Call trace_call(api_trace.get(), ApiTraceRecorder::Operation::Load,
+                                          [](ApiTraceRecorder&) { return std::string(); },
+                                          ApiTraceRecorder::Call::Async{});
+        if (master_password.empty()) {
+            throw std::invalid_argument("Master password cannot be empty");
+        }
+        std::shared_ptr<VaultExecutor> vault_executor = getExecutor();
+        std::exception_ptr error;
+
+        std::optional<std::string> file_data;
+        if (!isResidentFresh(nullptr)) {
+            co_await vault_executor->schedule(VaultWork::Io);
+            try {
+                file_data = readVaultFile();
+            } catch (...) {
+                error = std::current_exception();
+            }
+        }
+        if (!error) {
+            co_await vault_executor->schedule(VaultWork::Cpu);
+            try {
+                IRONVAULT_METRIC_TIMER(MetricOperation::LoadVault);
+                loaded = openVault(master_password, nullptr, client_id, file_data);
+            } catch (...) {
+                error = std::current_exception();
+            }
         }
+        OPENSSL_cleanse(master_password.data(), master_password.size());
 
-        file << encrypted_data;
-        file.close();
+        co_await vault_executor->schedule(VaultWork::Completion);
+        if (error) {
+            std::rethrow_exception(error);
+        }
+        trace_call.setResults(loaded ? 1 : 0);
+    }
+    traceSnapshot();
+    co_return loaded;
+}
 
-        return true;
+// Асинхронное сохранение: сборка и шифрование в Cpu, резервная копия и запись в Io
+VaultTask<bool> CredentialVault::saveAsync(std::string master_password) {
+    AsyncCallScope async_call(async_call_active);
+    ApiTraceRecorder::Call trace_call(api_trace.get(), ApiTraceRecorder::Operation::Save,
+                                      [](ApiTraceRecorder&) { return std::string(); },
+                                      ApiTraceRecorder::Call::Async{});
+    if (!is_authenticated) {
+        throw std::runtime_error("Vault is not authenticated");
+    }
+    ensureNoBatch();
+    if (master_password.empty()) {
+        throw std::invalid_argument("Master password cannot be empty");
+    }
+    std::shared_ptr<VaultExecutor> vault_executor = getExecutor();
+    bool saved = false;
+    std::string encrypted_data;
 
+    co_await vault_executor->schedule(VaultWork::Cpu);
+    try {
+        encrypted_data = buildSegmentedVault(master_password);
+        saved = true;
     } catch (const std::exception& e) {
         std::cerr << "Failed to save vault: " << e.what() << std::endl;
+    }
+    OPENSSL_cleanse(master_password.data(), master_password.size());
+
+    if (saved) {
+        co_await vault_executor->schedule(VaultWork::Io);
+        try {
+            writeVaultFile(encrypted_data);
+        } catch (const std::exception& e) {
+            std::cerr << "Failed to save vault: " << e.what() << std::endl;
+            saved = false;
+        }
+    }
+    if (!saved) {
+        IRONVAULT_METRIC_ADD(MetricCounter::SaveFailures, 1);
+    }
+
+    co_await vault_executor->schedule(VaultWork::Completion);
+    trace_call.setResults(saved ? 1 : 0);
+    co_return saved;
+}
+
+// Асинхронный поиск в Cpu
+VaultTask<std::vector<CredentialRecord>> CredentialVault::searchAsync(SearchFilter filter) {
+    AsyncCallScope async_call(async_call_active);
+    std::shared_ptr<VaultExecutor> vault_executor = getExecutor();
+    std::vector<CredentialRecord> results;
+    std::exception_ptr error;
+
+    co_await vault_executor->schedule(VaultWork::Cpu);
+    try {
+        results = filterRecords(filter);
+    } catch (...) {
+        error = std::current_exception();
+    }
+
+    co_await vault_executor->schedule(VaultWork::Completion);
+    if (error) {
+        std::rethrow_exception(error);
+    }
+    co_return results;
+}
+
+// Асинхронная генерация пароля в Cpu
+VaultTask<secure_string> CredentialVault::generatePasswordAsync(int length, bool use_uppercase,
+                                                               bool use_lowercase, bool use_digits,
+                                                               bool use_special) {
+    AsyncCallScope async_call(async_call_active);
+    std::shared_ptr<VaultExecutor> vault_executor = getExecutor();
+    secure_string password;
+    std::exception_ptr error;
+
+    co_await vault_executor->schedule(VaultWork::Cpu);
+    try {
+        password = runPasswordGenerator(length, use_uppercase, use_lowercase, use_digits, use_special);
+    } catch (...) {
+        error = std::current_exception();
+    }
+
+    co_await vault_executor->schedule(VaultWork::Completion);
+    if (error) {
+        std::rethrow_exception(error);
+    }
+    co_return password;
+}
+
+void CredentialVault::setExecutor(std::shared_ptr<VaultExecutor> vault_executor) {
+    ensureNoAsyncCall();
+    executor = std::move(vault_executor);
+}
+
+std::shared_ptr<VaultExecutor> CredentialVault::getExecutor() const {
+    return executor ? executor : VaultExecutor::shared();
+}
+
+// Файл текущего формата без записи на диск
+std::string CredentialVault::buildFileImage(const std::string& master_password) {
+    ensureNoAsyncCall();
+    if (!is_authenticated) {
+        throw std::runtime_error("Vault is not authenticated");
+    }
+    ensureNoBatch();
+    if (master_password.empty()) {
+        throw std::invalid_argument("Master password cannot be empty");
+    }
+    IRONVAULT_TRACE_SPAN("vault.build_image");
+    return buildSegmentedVault(master_password);
+}
+
+// Сегментированный файл, сжатый, если задан кодек
+bool CredentialVault::isCurrentFormat(std::string_view file_data, VaultCompression::Codec codec) {
+    if (!isSegmentedVault(file_data)) {
         return false;
     }
+    nextLine(file_data); // header
+    std::string_view version = nextLine(file_data);
+    return version == VAULT_COMPRESSED_VERSION || (version == VAULT_SEGMENTED_VERSION &&
+                                                   codec == VaultCompression::Codec::None);
+}
+
+// Формирование файла формата 2.0.
+// Каждая категория - отдельный сегмент со своим случайным ключом данных,
+// обернутым ключом хранилища. Запечатанные сегменты переносятся как есть,
+// поэтому их обернутые ключи требуют прежней соли и прежнего пароля.
+std::string CredentialVault::buildSegmentedVault(const std::string& master_password) {
+    // Ключ из кэша сессии подтверждает, что пароль уже открывал это хранилище:
+    // соль сохраняется, и KDF не вычисляется повторно
+    secure_vector<unsigned char> vault_key;
+    bool cached = !vault_salt.empty() && key_cache && key_cache->lookup(master_password, vault_salt, vault_key);
+    if (!cached) {
+        if (sealed_segments.empty() || vault_salt.empty()) {
+            vault_salt = DataEncryption::generateSalt();
+        } else if (!master_verifier || !master_verifier->verify(master_password)) {
+            throw std::runtime_error("Partially unlocked vault can only be saved with its master password");
+        }
+        vault_key = DataEncryption::deriveKey(master_password, vault_salt);
+        if (key_cache) {
+            key_cache->store(master_password, vault_salt, vault_key);
+        }
+    }
+    setSessionKeys(vault_key);
+
+    // Группируем записи по категориям в порядке имен: содержимое сегмента
+    // не зависит от порядка ячеек, и неизмененный сегмент не перешифровывается
+    std::map<std::string_view, std::vector<const CredentialRecord*>> by_category;
+    for (auto cursor = name_index.begin(); cursor.valid(); cursor.next()) {
+        const CredentialRecord& record = records[cursor.slot()];
+        by_category[record.getCategory()].push_back(&record);
+    }
+
+    std::stringstream index_stream;
+    index_stream << master_password_hash << "\n";
+    index_stream << by_category.size() + sealed_segments.size() << "\n";
+
+    std::stringstream segments_stream;
+    // Имена сервисов каждого сегмента: без них частично открытое хранилище
+    // не может проверить уникальность имени по запечатанным категориям
+    std::stringstream names_stream;
+    size_t segment_position = 0;
+    {
+        IRONVAULT_TRACE_SPAN_ARG("vault.encrypt_segments", "segments", by_category.size());
+        for (const auto& [category, category_records] : by_category) {
+            std::stringstream data_stream;
+            for (const CredentialRecord* record : category_records) {
+                data_stream << "---RECORD---\n";
+                data_stream << record->serialize() << "\n";
+                data_stream << "---END_RECORD---\n";
+            }
+
+            std::string segment_data = data_stream.str();
+
+            // Неизмененный сегмент записывается прежним шифртекстом: файл между
+            // сохранениями меняется только в измененных категориях
+            unsigned char digest[DataEncryption::DIGEST_LENGTH];
+            DataEncryption::sha256(segment_data, digest);
+            auto cached_segment = segment_cache.find(std::string(category));
+            if (cached_segment == segment_cache.end() || cached_segment->second.codec != compression_codec ||
+                !std::equal(digest, digest + DataEncryption::DIGEST_LENGTH, cached_segment->second.digest.begin())) {
+                secure_vector<unsigned char> data_key = DataEncryption::generateKey();
+                secure_string packed = VaultCompression::compress(compression_codec, segment_data);
+                std::string ciphertext = DataEncryption::encryptWithKey(packed.view(), data_key.data());
+                cacheSegment(category, digest, data_key.data(), compression_codec, ciphertext);
+                cached_segment = segment_cache.find(std::string(category));
+            }
+
+            const CachedSegment& segment = cached_segment->second;
+            std::string_view key_view(reinterpret_cast<const char *>(segment.data_key.data()), segment.data_key.size());
+            index_stream << DataEncryption::encryptWithKey(key_view, vault_key.data()) << " "
+                         << category_records.size() << " " << category << "\n";
+            segments_stream << segment.ciphertext << "\n";
+            for (const CredentialRecord* record : category_records) {
+                names_stream << "name " << segment_position << " " << record->getServiceName() << "\n";
+            }
+            ++segment_position;
+        }
+    }
+
+    // Категории, которых больше нет, удаляются из кэша
+    for (auto it = segment_cache.begin(); it != segment_cache.end();) {
+        if (by_category.count(it->first) == 0) {
+            it = segment_cache.erase(it);
+        } else {
+            ++it;
+        }
+    }
+    for (const auto& segment : sealed_segments) {
+        index_stream << segment.wrapped_key << " " << segment.record_count << " " << segment.category << "\n";
+        segments_stream << segment.ciphertext << "\n";
+        for (const auto& name : segment.service_names) {
+            names_stream << "name " << segment_position << " " << name << "\n";
+        }
+        ++segment_position;
+    }
+    index_stream << "clock " << lamport_clock << " " << replica_id << "\n";
+    for (const auto& tombstone : tombstones) {
+        index_stream << "removed " << tombstone.version << " " << tombstone.origin << " "
+                     << tombstone.sequence << " " << tombstone.service_name << "\n";
+    }
+    index_stream << names_stream.rdbuf();
+
+    std::stringstream file_stream;
+    file_stream << VAULT_HEADER << "\n";
+    if (compression_codec == VaultCompression::Codec::None) {
+        file_stream << VAULT_SEGMENTED_VERSION << "\n";
+    } else {
+        file_stream << VAULT_COMPRESSED_VERSION << "\n";
+        file_stream << VaultCompression::codecName(compression_codec) << "\n";
+    }
+    file_stream << DataEncryption::encodeBase64(vault_salt.data(), vault_salt.size()) << "\n";
+    file_stream << DataEncryption::encryptWithKey(index_stream.str(), vault_key.data()) << "\n";
+    file_stream << segments_stream.rdbuf();
+    return file_stream.str();
 }
 
 // Проверка мастер-пароля
-bool CredentialVault::verifyMasterPassword(const std::string& master_password) const {
-    return MasterPasswordManager::verifyPassword(master_password, master_password_hash);
+bool CredentialVault::verifyMasterPassword(const std::string& master_password, const std::string& client_id) const {
+    ensureNoAsyncCall();
+    if (!master_verifier) {
+        return false;
+    }
+    if (unlock_gate) {
+        return unlock_gate->verify(client_id, *master_verifier, master_password);
+    }
+    return master_verifier->verify(master_password);
+}
+
+// Установка ограничителя попыток разблокировки
+void CredentialVault::setUnlockGate(std::shared_ptr<UnlockGate> gate) {
+    ensureNoAsyncCall();
+    unlock_gate = std::move(gate);
+}
+
+// Установка общего кэша ключей сессии
+void CredentialVault::setKeyCache(std::shared_ptr<SessionKeyCache> cache) {
+    ensureNoAsyncCall();
+    key_cache = std::move(cache);
+}
+
+// Включение трассы вызовов; открытое хранилище сразу попадает в трассу
+void CredentialVault::setApiTrace(std::shared_ptr<ApiTraceRecorder> trace) {
+    ensureNoAsyncCall();
+    api_trace = std::move(trace);
+    traceSnapshot();
+}
+
+std::shared_ptr<ApiTraceRecorder> CredentialVault::getApiTrace() const {
+    ensureNoAsyncCall();
+    return api_trace;
+}
+
+// Выбор кодека сжатия. Запечатанные сегменты записываются как есть, а кодек
+// в файле один на все сегменты, поэтому сменить его можно только при
+// полностью разблокированном хранилище.
+void CredentialVault::setCompression(VaultCompression::Codec codec) {
+    ensureNoAsyncCall();
+    if (!VaultCompression::isAvailable(codec)) {
+        throw std::invalid_argument(std::string("Compression codec is not available: ") +
+                                    VaultCompression::codecName(codec));
+    }
+    if (codec != compression_codec && !sealed_segments.empty()) {
+        throw std::runtime_error("Cannot change compression while categories are sealed");
+    }
+    compression_codec = codec;
+}
+
+VaultCompression::Codec CredentialVault::getCompression() const {
+    ensureNoAsyncCall();
+    return compression_codec;
 }
 
 // Блокировка хранилища
-void CredentialVault::lockVault() {
+void CredentialVault::lockVault(bool keep_resident) {
+    ApiTraceRecorder::Call trace_call(api_trace.get(), ApiTraceRecorder::Operation::Lock,
+                                      [keep_resident](ApiTraceRecorder&) {
+                                          return std::string(keep_resident ? "resident" : "full");
+                                      });
+    ensureNoAsyncCall();
+    if (keep_resident && resident) {
+        return;
+    }
+    // Незафиксированный пакет отменяется: в памяти остается сохраненное состояние
+    if (batch && keep_resident) {
+        rollback();
+    }
+    batch.reset();
+    if (keep_resident && is_authenticated && !resident_key.empty() && !vault_salt.empty() &&
+        sealed_segments.empty()) {
+        sealResident();
+        return;
+    }
+    clearUnlockedState();
+}
+
+// Полная блокировка без записи в трассу; внутренние вызовы при загрузке
+// и восстановлении идут сюда, а не в lockVault
+void CredentialVault::clearUnlockedState() {
     is_authenticated = false;
-    // Очищаем чувствительные данные из памяти
+    resident.reset();
+    clearSessionKeys();
+    // Очищаем чувствительные данные из памяти: поля всех записей
+    // обнуляются одним проходом по арене
     records.clear();
+    name_index.clear();
+    url_index.clear();
+    field_arena->wipe();
+    field_arena = std::make_shared<FieldArena>();
+    sealed_segments.clear();
+    segment_cache.clear();
+    vault_salt.clear();
+    tombstones.clear();
+    lamport_clock = 0;
+    replica_id = 0;
     master_password_hash.clear();
+    if (master_verifier) {
+        master_verifier->clear();
+        master_verifier.reset();
+    }
+}
+
+bool CredentialVault::isResident() const {
+    ensureNoAsyncCall();
+    return resident.has_value();
 }
 
 // Добавление записи
 bool CredentialVault::addRecord(const CredentialRecord& record) {
-    if (!is_authenticated) {
-        throw std::runtime_error("Vault is not authenticated");
-    }
+    return addRecord(CredentialRecord(record));
+}
+
+// Добавление записи с перемещением
+bool CredentialVault::addRecord(CredentialRecord&& record) {
+    ApiTraceRecorder::Call trace_call(api_trace.get(), ApiTraceRecorder::Operation::Add,
+                                      [&record](ApiTraceRecorder& trace) { return trace.describeRecord(record); });
+    ensureAuthenticated();
+    ensureNoAsyncCall();
 
     if (!validateRecord(record)) {
         return false;
@@ -167,81 +1102,264 @@ bool CredentialVault::addRecord(const CredentialRecord& record) {
     if (!isServiceNameUnique(record.getServiceName())) {
         throw std::invalid_argument("Service name must be unique");
     }
+    ensureCategoryUnlocked(record.getCategory());
 
-    records.push_back(record);
-    sortRecords();
+    record.moveToArena(field_arena);
+    stampRecord(record);
+    recordBatchChange(record.getServiceName(), nullptr);
+    appendRecord(std::move(record));
+    trace_call.setResults(1);
+    return true;
+}
+
+// Проверка записи, созданной через emplaceRecord
+bool CredentialVault::adoptEmplacedRecord() {
+    const CredentialRecord& record = records.back();
+    ApiTraceRecorder::Call trace_call(api_trace.get(), ApiTraceRecorder::Operation::Add,
+                                      [&record](ApiTraceRecorder& trace) { return trace.describeRecord(record); });
+    if (!validateRecord(record)) {
+        records.pop_back();
+        return false;
+    }
+    if (isCategorySealed(record.getCategory())) {
+        std::string category(record.getCategory());
+        records.pop_back();
+        ensureCategoryUnlocked(category);
+    }
+
+    bool unique = false;
+    try {
+        unique = isServiceNameUnique(record.getServiceName());
+    } catch (...) {
+        records.pop_back();
+        throw;
+    }
+    if (!unique) {
+        records.pop_back();
+        throw std::invalid_argument("Service name must be unique");
+    }
+
+    records.back().moveToArena(field_arena);
+    stampRecord(records.back());
+    recordBatchChange(records.back().getServiceName(), nullptr);
+    name_index.insert(records.back().getServiceName(), static_cast<ServiceNameIndex::Slot>(records.size() - 1));
+    url_index.insert(records.back().getUrl(), records.back().getServiceName());
+    trace_call.setResults(1);
     return true;
 }
 
 // Обновление записи
 bool CredentialVault::updateRecord(const std::string& service_name, const CredentialRecord& updated_record) {
+    return updateRecord(service_name, CredentialRecord(updated_record));
+}
+
+// Обновление записи с перемещением
+bool CredentialVault::updateRecord(const std::string& service_name, CredentialRecord&& updated_record) {
+    ApiTraceRecorder::Call trace_call(api_trace.get(), ApiTraceRecorder::Operation::Update,
+                                      [&](ApiTraceRecorder& trace) {
+                                          return trace.anonymize(service_name) + ' ' +
+                                                 trace.describeRecord(updated_record);
+                                      });
+    ensureAuthenticated();
+    ensureNoAsyncCall();
+
+    ServiceNameIndex::Slot slot = 0;
+    if (!name_index.find(service_name, slot)) {
+        return false;
+    }
+
+    // Проверяем уникальность нового имени сервиса (если оно изменилось)
+    bool renamed = service_name != updated_record.getServiceName();
+    if (renamed && !isServiceNameUnique(updated_record.getServiceName())) {
+        throw std::invalid_argument("Service name must be unique");
+    }
+    ensureCategoryUnlocked(updated_record.getCategory());
+
+    // Переименование реплицируется как удаление старого имени
+    if (renamed) {
+        addTombstone(service_name, nextVersion(), replica_id);
+        name_index.erase(service_name);
+    }
+    recordBatchChange(updated_record.getServiceName(), &records[slot]);
+    url_index.erase(records[slot].getUrl(), service_name);
+    updated_record.moveToArena(field_arena);
+    stampRecord(updated_record);
+    records[slot] = std::move(updated_record);
+    if (renamed) {
+        name_index.insert(records[slot].getServiceName(), slot);
+    }
+    url_index.insert(records[slot].getUrl(), records[slot].getServiceName());
+    compactFieldArena();
+    trace_call.setResults(1);
+    return true;
+}
+
+// Удаление записи
+bool CredentialVault::removeRecord(const std::string& service_name) {
+    ApiTraceRecorder::Call trace_call(api_trace.get(), ApiTraceRecorder::Operation::Remove,
+                                      [&service_name](ApiTraceRecorder& trace) {
+                                          return trace.anonymize(service_name);
+                                      });
     if (!is_authenticated) {
         throw std::runtime_error("Vault is not authenticated");
     }
+    ensureNoAsyncCall();
 
-    for (auto& record : records) {
-        if (record.getServiceName() == service_name) {
-            // Проверяем уникальность нового имени сервиса (если оно изменилось)
-            if (service_name != updated_record.getServiceName() &&
-                !isServiceNameUnique(updated_record.getServiceName())) {
-                throw std::invalid_argument("Service name must be unique");
-            }
+    ServiceNameIndex::Slot slot = 0;
+    if (!name_index.find(service_name, slot)) {
+        return false;
+    }
+    recordBatchChange({}, &records[slot]);
+    eraseRecordAt(slot);
+    addTombstone(service_name, nextVersion(), replica_id);
+    compactFieldArena();
+    trace_call.setResults(1);
+    return true;
+}
+
+// Начало пакета изменений
+void CredentialVault::beginBatch() {
+    ApiTraceRecorder::Call trace_call(api_trace.get(), ApiTraceRecorder::Operation::BeginBatch,
+                                      [](ApiTraceRecorder&) { return std::string(); });
+    ensureAuthenticated();
+    ensureNoAsyncCall();
+    if (batch) {
+        throw std::runtime_error("Batch is already in progress");
+    }
+    batch.emplace();
+    batch->lamport_clock = lamport_clock;
+}
+
+// Фиксация пакета: одна отметка времени, одно сохранение, одно уплотнение
+bool CredentialVault::commit(const std::string& master_password) {
+    ApiTraceRecorder::Call trace_call(api_trace.get(), ApiTraceRecorder::Operation::Commit,
+                                      [this](ApiTraceRecorder&) {
+                                          return std::to_string(batch ? batch->changes.size() : 0);
+                                      });
+    ensureAuthenticated();
+    ensureNoAsyncCall();
+    if (!batch) {
+        throw std::runtime_error("No batch in progress");
+    }
+    if (master_password.empty()) {
+        throw std::invalid_argument("Master password cannot be empty");
+    }
+    IRONVAULT_TRACE_SPAN_ARG("vault.commit_batch", "changes", batch->changes.size());
 
-            record = updated_record;
-            sortRecords();
-            return true;
+    std::time_t now = std::time(nullptr);
+    for (const auto& change : batch->changes) {
+        if (CredentialRecord* record = findIndexedRecord(change.service_name)) {
+            record->setLastModified(now);
         }
     }
 
-    return false;
+    // Журнал возвращается при любой неудаче сохранения, в том числе при исключении
+    std::optional<BatchState> committed = std::move(batch);
+    batch.reset();
+    bool saved = false;
+    try {
+        saved = saveToFile(master_password);
+    } catch (...) {
+        batch = std::move(committed);
+        throw;
+    }
+    if (!saved) {
+        batch = std::move(committed);
+        return false;
+    }
+    compactFieldArena();
+    trace_call.setResults(1);
+    return true;
 }
 
-// Удаление записи
-bool CredentialVault::removeRecord(const std::string& service_name) {
-    if (!is_authenticated) {
-        throw std::runtime_error("Vault is not authenticated");
+// Откат пакета по журналу в обратном порядке
+void CredentialVault::rollback() {
+    ApiTraceRecorder::Call trace_call(api_trace.get(), ApiTraceRecorder::Operation::Rollback,
+                                      [this](ApiTraceRecorder&) {
+                                          return std::to_string(batch ? batch->changes.size() : 0);
+                                      });
+    ensureNoAsyncCall();
+    if (!batch) {
+        throw std::runtime_error("No batch in progress");
     }
+    IRONVAULT_TRACE_SPAN_ARG("vault.rollback_batch", "changes", batch->changes.size());
 
-    auto it = std::remove_if(records.begin(), records.end(),
-                             [&service_name](const CredentialRecord& record) {
-                                 return record.getServiceName() == service_name;
-                             });
-
-    if (it != records.end()) {
-        records.erase(it, records.end());
-        return true;
+    for (auto change = batch->changes.rbegin(); change != batch->changes.rend(); ++change) {
+        ServiceNameIndex::Slot slot = 0;
+        if (!change->service_name.empty() && name_index.find(change->service_name, slot)) {
+            eraseRecordAt(slot);
+        }
+        if (change->previous) {
+            change->previous->moveToArena(field_arena);
+            appendRecord(std::move(*change->previous));
+        }
     }
+    for (auto change = batch->tombstone_changes.rbegin(); change != batch->tombstone_changes.rend(); ++change) {
+        auto current = std::find_if(tombstones.begin(), tombstones.end(), [&change](const Tombstone& tombstone) {
+            return tombstone.service_name == change->service_name;
+        });
+        if (change->previous) {
+            if (current != tombstones.end()) {
+                *current = std::move(*change->previous);
+            } else {
+                tombstones.push_back(std::move(*change->previous));
+            }
+        } else if (current != tombstones.end()) {
+            tombstones.erase(current);
+        }
+    }
+    lamport_clock = batch->lamport_clock;
+    batch.reset();
+}
 
-    return false;
+bool CredentialVault::inBatch() const {
+    ensureNoAsyncCall();
+    return batch.has_value();
 }
 
 // Поиск записи по имени сервиса
 CredentialRecord* CredentialVault::findRecord(const std::string& service_name) {
+    ApiTraceRecorder::Call trace_call(api_trace.get(), ApiTraceRecorder::Operation::Find,
+                                      [&service_name](ApiTraceRecorder& trace) {
+                                          return trace.anonymize(service_name);
+                                      });
+    ensureNoAsyncCall();
     if (!is_authenticated) {
         throw std::runtime_error("Vault is not authenticated");
     }
 
-    for (auto& record : records) {
-        if (record.getServiceName() == service_name) {
-            return &record;
-        }
-    }
-
-    return nullptr;
+    CredentialRecord* record = findIndexedRecord(service_name);
+    trace_call.setResults(record ? 1 : 0);
+    return record;
 }
 
 // Поиск записей по фильтру
 std::vector<CredentialRecord> CredentialVault::searchRecords(const SearchFilter& filter) const {
+    ensureNoAsyncCall();
+    return filterRecords(filter);
+}
+
+// Поиск без проверки асинхронного вызова: его выполняет и searchAsync
+std::vector<CredentialRecord> CredentialVault::filterRecords(const SearchFilter& filter) const {
+    ApiTraceRecorder::Call trace_call(api_trace.get(), ApiTraceRecorder::Operation::Search,
+                                      [&filter](ApiTraceRecorder& trace) { return trace.describeFilter(filter); });
     if (!is_authenticated) {
         throw std::runtime_error("Vault is not authenticated");
     }
+    IRONVAULT_METRIC_TIMER(MetricOperation::Search);
+    IRONVAULT_METRIC_ADD(MetricCounter::SearchCalls, 1);
+    IRONVAULT_METRIC_ADD(MetricCounter::RecordsScanned, records.size());
+    IRONVAULT_TRACE_SPAN_ARG("search.filter", "records", records.size());
 
+    // Обход по индексу: результат упорядочен по имени сервиса
     std::vector<CredentialRecord> results;
-    for (const auto& record : records) {
+    for (auto cursor = name_index.begin(); cursor.valid(); cursor.next()) {
+        const CredentialRecord& record = records[cursor.slot()];
         if (filter.matches(record)) {
             results.push_back(record);
         }
     }
+    trace_call.setResults(results.size());
     return results;
 }
 
@@ -252,11 +1370,76 @@ std::vector<CredentialRecord> CredentialVault::getRecordsByCategory(const std::s
     return searchRecords(filter);
 }
 
+// Префиксный поиск по индексу имен
+std::vector<CredentialRecord> CredentialVault::prefixSearch(std::string_view prefix, size_t limit) const {
+    ApiTraceRecorder::Call trace_call(api_trace.get(), ApiTraceRecorder::Operation::PrefixSearch,
+                                      [&](ApiTraceRecorder& trace) {
+                                          return trace.anonymize(prefix) + ' ' + std::to_string(limit);
+                                      });
+    ensureNoAsyncCall();
+    ensureAuthenticated();
+    std::vector<CredentialRecord> results;
+    for (ServiceNameIndex::Slot slot : name_index.prefixSlots(prefix, limit)) {
+        results.push_back(records[slot]);
+    }
+    trace_call.setResults(results.size());
+    return results;
+}
+
+// Страница записей после курсора
+RecordPage CredentialVault::getRecordPage(std::string_view cursor, size_t limit, std::string_view prefix) const {
+    ApiTraceRecorder::Call trace_call(api_trace.get(), ApiTraceRecorder::Operation::Page,
+                                      [&](ApiTraceRecorder& trace) {
+                                          return trace.anonymize(cursor) + ' ' + std::to_string(limit) + ' ' +
+                                                 trace.anonymize(prefix);
+                                      });
+    ensureNoAsyncCall();
+    ensureAuthenticated();
+    if (limit == 0) {
+        throw std::invalid_argument("Page size must be positive");
+    }
+
+    RecordPage page;
+    auto position = cursor.empty() || cursor < prefix ? name_index.lowerBound(prefix) : name_index.upperBound(cursor);
+    for (; position.valid() && position.key().substr(0, prefix.size()) == prefix; position.next()) {
+        if (page.records.size() == limit) {
+            page.next_cursor.assign(page.records.back().getServiceName());
+            break;
+        }
+        page.records.push_back(records[position.slot()]);
+    }
+    trace_call.setResults(page.records.size());
+    return page;
+}
+
+// Записи для автозаполнения по адресу страницы
+std::vector<UrlMatch> CredentialVault::findByUrl(std::string_view url, size_t limit) const {
+    ApiTraceRecorder::Call trace_call(api_trace.get(), ApiTraceRecorder::Operation::FindByUrl,
+                                      [&](ApiTraceRecorder& trace) {
+                                          return trace.anonymizeHost(url) + ' ' + std::to_string(limit);
+                                      });
+    ensureNoAsyncCall();
+    ensureAuthenticated();
+    std::vector<UrlMatch> results;
+    for (const auto& [service_name, kind] : url_index.find(url, limit)) {
+        ServiceNameIndex::Slot slot = 0;
+        if (name_index.find(service_name, slot)) {
+            results.push_back(UrlMatch{records[slot], kind});
+        }
+    }
+    trace_call.setResults(results.size());
+    return results;
+}
+
 // Получение всех категорий
 std::vector<std::string> CredentialVault::getAllCategories() const {
+    ensureNoAsyncCall();
     std::vector<std::string> categories;
+    if (!is_authenticated) {
+        return categories;
+    }
     for (const auto& record : records) {
-        categories.push_back(record.getCategory());
+        categories.emplace_back(record.getCategory());
     }
 
     // Удаляем дубликаты
@@ -266,9 +1449,17 @@ std::vector<std::string> CredentialVault::getAllCategories() const {
     return categories;
 }
 // Генерация пароля
-std::string CredentialVault::generatePassword(int length, bool use_uppercase,
+secure_string CredentialVault::generatePassword(int length, bool use_uppercase,
                                               bool use_lowercase, bool use_digits,
                                               bool use_special) {
+    ensureNoAsyncCall();
+    return runPasswordGenerator(length, use_uppercase, use_lowercase, use_digits, use_special);
+}
+
+// Генерация без проверки асинхронного вызова: ее выполняет и generatePasswordAsync
+secure_string CredentialVault::runPasswordGenerator(int length, bool use_uppercase,
+                                                   bool use_lowercase, bool use_digits,
+                                                   bool use_special) {
     if (!password_generator) {
         initializePasswordGenerator();
     }
@@ -284,15 +1475,23 @@ std::string CredentialVault::generatePassword(int length, bool use_uppercase,
 
 // Статистика
 size_t CredentialVault::getRecordCount() const {
-    return records.size();
+    ensureNoAsyncCall();
+    return is_authenticated ? records.size() : 0;
+}
+
+size_t CredentialVault::getLoadedRecordMarkers() const {
+    ensureNoAsyncCall();
+    return loaded_record_markers;
 }
 
 size_t CredentialVault::getCategoryCount() const {
+    ensureNoAsyncCall();
     return getAllCategories().size();
 }
 
 std::time_t CredentialVault::getLastModified() const {
-    if (records.empty()) {
+    ensureNoAsyncCall();
+    if (!is_authenticated || records.empty()) {
         return std::time(nullptr);
     }
 
@@ -308,18 +1507,43 @@ std::time_t CredentialVault::getLastModified() const {
 
 // Геттеры
 std::string CredentialVault::getVaultFilePath() const { return vault_file_path; }
-bool CredentialVault::isAuthenticated() const { return is_authenticated; }
+bool CredentialVault::isAuthenticated() const {
+    ensureNoAsyncCall();
+    return is_authenticated;
+}
+
 std::vector<CredentialRecord> CredentialVault::getAllRecords() const {
+    ensureNoAsyncCall();
     if (!is_authenticated) {
         throw std::runtime_error("Vault is not authenticated");
     }
-    return records;
+    return orderedRecords();
 }
 
-// Валидация уникальности имени сервиса
-bool CredentialVault::isServiceNameUnique(const std::string& service_name) const {
-    for (const auto& record : records) {
-        if (record.getServiceName() == service_name) {
+// Копии записей в порядке имен сервисов
+std::vector<CredentialRecord> CredentialVault::orderedRecords() const {
+    std::vector<CredentialRecord> ordered;
+    ordered.reserve(records.size());
+    for (ServiceNameIndex::Slot slot : orderedSlots()) {
+        ordered.push_back(records[slot]);
+    }
+    return ordered;
+}
+
+// Валидация уникальности имени сервиса, в том числе по запечатанным
+// категориям: иначе дубликат обнаружился бы только при полной загрузке
+bool CredentialVault::isServiceNameUnique(std::string_view service_name) const {
+    ensureNoAsyncCall();
+    if (name_index.contains(service_name)) {
+        return false;
+    }
+    for (const auto& segment : sealed_segments) {
+        if (!segment.names_known) {
+            throw std::runtime_error("Cannot check service name uniqueness: category '" + segment.category +
+                                     "' is sealed and the vault file does not list its names; "
+                                     "unlock all categories and save once");
+        }
+        if (std::binary_search(segment.service_names.begin(), segment.service_names.end(), service_name)) {
             return false;
         }
     }
@@ -333,15 +1557,608 @@ bool CredentialVault::validateRecord(const CredentialRecord& record) const {
            !record.getLogin().empty();
 }
 
+// Текущая версия (часы Лэмпорта) хранилища
+uint64_t CredentialVault::getVersion() const {
+    ensureNoAsyncCall();
+    return lamport_clock;
+}
+
+uint64_t CredentialVault::getReplicaId() const {
+    ensureNoAsyncCall();
+    return replica_id;
+}
+
+uint64_t CredentialVault::assignNewReplicaId() {
+    ensureAuthenticated();
+    ensureNoAsyncCall();
+    ensureNoBatch();
+    replica_id = generateReplicaId();
+    return replica_id;
+}
+
+// Выгрузка изменений, полученных репликой после отметки since_version.
+// Формат: IRONVAULT-DELTA / 2 / <соль Base64> / encryptWithKey(данные), где
+// данные: <реплика> <часы> <since> / <число удалений>,
+//   строки "<версия> <реплика> <имя сервиса>", затем блоки ---RECORD---
+std::string CredentialVault::exportDelta(uint64_t since_version) const {
+    ensureNoAsyncCall();
+    ensureAuthenticated();
+    ensureFullyUnlocked();
+    ensureNoBatch();
+    if (delta_key.empty()) {
+        throw std::runtime_error("Delta export requires a vault opened or saved in segmented format");
+    }
+    IRONVAULT_TRACE_SPAN_ARG("vault.export_delta", "since", since_version);
+
+    std::vector<const Tombstone*> removed;
+    for (const auto& tombstone : tombstones) {
+        if (tombstone.sequence > since_version) {
+            removed.push_back(&tombstone);
+        }
+    }
+
+    std::stringstream delta_stream;
+    delta_stream << replica_id << " " << lamport_clock << " " << since_version << "\n";
+    delta_stream << removed.size() << "\n";
+    for (const Tombstone* tombstone : removed) {
+        delta_stream << tombstone->version << " " << tombstone->origin << " " << tombstone->service_name << "\n";
+    }
+    for (const auto& record : records) {
+        if (record.getSequence() > since_version) {
+            delta_stream << "---RECORD---\n";
+            delta_stream << record.serialize() << "\n";
+            delta_stream << "---END_RECORD---\n";
+        }
+    }
+
+    std::string delta = DELTA_HEADER + "\n" + DELTA_VERSION + "\n";
+    delta += DataEncryption::encodeBase64(vault_salt.data(), vault_salt.size());
+    delta += "\n";
+    delta += DataEncryption::encryptWithKey(delta_stream.str(), delta_key.data());
+    return delta;
+}
+
+// Применение дельты: побеждает изменение с большей парой (версия, реплика).
+// Принятые изменения получают свою отметку получения и уходят дальше
+// со следующей дельтой этой реплики
+DeltaApplyResult CredentialVault::applyDelta(const std::string& delta, const std::string& master_password) {
+    ensureAuthenticated();
+    ensureNoAsyncCall();
+    ensureFullyUnlocked();
+    ensureNoBatch();
+    IRONVAULT_TRACE_SPAN_ARG("vault.apply_delta", "bytes", delta.size());
+
+    std::string_view envelope = delta;
+    if (nextLine(envelope) != DELTA_HEADER || nextLine(envelope) != DELTA_VERSION) {
+        throw std::runtime_error("Invalid delta format");
+    }
+    std::vector<unsigned char> salt;
+    DataEncryption::decodeBase64(nextLine(envelope), salt);
+    if (salt.size() != DataEncryption::SALT_LENGTH) {
+        throw std::runtime_error("Invalid delta salt");
+    }
+
+    // Ключ дельты: свой, если соль совпадает, иначе из ключа хранилища источника
+    secure_vector<unsigned char> key;
+    if (salt == vault_salt && !delta_key.empty()) {
+        key = delta_key;
+    } else {
+        if (master_password.empty()) {
+            throw std::invalid_argument("Master password cannot be empty");
+        }
+        secure_vector<unsigned char> vault_key;
+        bool cached = key_cache && key_cache->lookup(master_password, salt, vault_key);
+        if (!cached) {
+            vault_key = DataEncryption::deriveKey(master_password, salt);
+        }
+        key = deriveDeltaKey(vault_key);
+        if (key_cache && !cached) {
+            key_cache->store(master_password, salt, vault_key);
+        }
+    }
+
+    secure_string plaintext = DataEncryption::decryptWithKey(nextLine(envelope), key.data());
+    std::string_view data = plaintext.view();
+
+    DeltaApplyResult result{};
+    uint64_t since_version = 0;
+    std::string_view source = nextLine(data);
+    source = parseNumber(source, result.source_replica);
+    source = parseNumber(source, result.source_version);
+    parseNumber(source, since_version);
+
+    uint64_t removed_count = 0;
+    parseNumber(nextLine(data), removed_count);
+    std::vector<Tombstone> removed;
+    for (uint64_t i = 0; i < removed_count; ++i) {
+        std::string_view line = nextLine(data);
+        Tombstone tombstone{};
+        line = parseNumber(line, tombstone.version);
+        line = parseNumber(line, tombstone.origin);
+        tombstone.service_name.assign(line);
+        removed.push_back(std::move(tombstone));
+    }
+
+    std::vector<CredentialRecord> incoming;
+    parseRecords(data, incoming);
+
+    auto find_local = [this](std::string_view service_name) {
+        return findIndexedRecord(service_name);
+    };
+    auto find_tombstone = [this](std::string_view service_name) {
+        return std::find_if(tombstones.begin(), tombstones.end(), [service_name](const Tombstone& tombstone) {
+            return tombstone.service_name == service_name;
+        });
+    };
+
+    for (auto& record : incoming) {
+        lamport_clock = std::max(lamport_clock, record.getVersion());
+        auto local = find_local(record.getServiceName());
+        auto tombstone = find_tombstone(record.getServiceName());
+        if ((local && !record.isNewerThan(local->getVersion(), local->getOrigin())) ||
+            (tombstone != tombstones.end() && !record.isNewerThan(tombstone->version, tombstone->origin))) {
+            ++result.changes_skipped;
+            continue;
+        }
+        if (tombstone != tombstones.end()) {
+            tombstones.erase(tombstone);
+        }
+        record.setSequence(nextVersion());
+        if (local) {
+            url_index.erase(local->getUrl(), local->getServiceName());
+            *local = std::move(record);
+            url_index.insert(local->getUrl(), local->getServiceName());
+        } else {
+            appendRecord(std::move(record));
+        }
+        ++result.records_applied;
+    }
+
+    for (auto& removal : removed) {
+        lamport_clock = std::max(lamport_clock, removal.version);
+        auto local = find_local(removal.service_name);
+        if (local) {
+            if (local->isNewerThan(removal.version, removal.origin)) {
+                ++result.changes_skipped;
+                continue;
+            }
+            eraseRecordAt(static_cast<size_t>(local - records.data()));
+            ++result.records_removed;
+        }
+        addTombstone(removal.service_name, removal.version, removal.origin);
+    }
+
+    lamport_clock = std::max(lamport_clock, result.source_version);
+    compactFieldArena();
+    return result;
+}
+
+// Блокировка с сохранением записей: ключи, кэши сегментов и открытые
+// метаданные обнуляются, поля записей шифруются на месте новым случайным
+// ключом. Все поля лежат в field_arena, поэтому ключи индекса имен
+// остаются на своих местах и индекс не перестраивается.
+void CredentialVault::sealResident() {
+    IRONVAULT_TRACE_SPAN_ARG("vault.seal_resident", "bytes", field_arena->getUsedBytes());
+    // Шифруется только общая арена: поля записей, измененных через
+    // findRecord (собственная арена записи), и литерал категории по
+    // умолчанию сначала переносятся в нее
+    bool moved = false;
+    for (auto& record : records) {
+        moved = record.moveAllToArena(field_arena) || moved;
+    }
+    if (moved) {
+        // Ключи индексов указывают на поля в прежних аренах
+        rebuildIndexes();
+    }
+    secure_vector<unsigned char> arena_key = DataEncryption::generateKey();
+
+    secure_string payload;
+    payload.append(reinterpret_cast<const char*>(arena_key.data()), arena_key.size());
+    payload.append(master_password_hash).append("\n");
+    for (const auto& tombstone : tombstones) {
+        payload.append(std::to_string(tombstone.version)).append(" ")
+               .append(std::to_string(tombstone.origin)).append(" ")
+               .append(std::to_string(tombstone.sequence)).append(" ")
+               .append(tombstone.service_name).append("\n");
+    }
+
+    ResidentState state;
+    state.wrapped = DataEncryption::encryptWithKey(payload.view(), resident_key.data());
+    state.file_stamp = fileStamp();
+    field_arena->applyKeystream(arena_key.data());
+
+    is_authenticated = false;
+    resident = std::move(state);
+    clearSessionKeys();
+    url_index.clear();
+    segment_cache.clear();
+    for (auto& tombstone : tombstones) {
+        OPENSSL_cleanse(tombstone.service_name.data(), tombstone.service_name.size());
+    }
+    tombstones.clear();
+    master_password_hash.clear();
+    if (master_verifier) {
+        master_verifier->clear();
+        master_verifier.reset();
+    }
+}
+
+// Разблокировка записей в памяти: один KDF (или ключ из кэша сессии)
+// и проверка MAC обертки; арена расшифровывается только после нее
+void CredentialVault::unlockResident(const std::string& master_password) {
+    IRONVAULT_TRACE_SPAN_ARG("vault.unlock_resident", "bytes", field_arena->getUsedBytes());
+    secure_vector<unsigned char> vault_key;
+    bool cached = key_cache && key_cache->lookup(master_password, vault_salt, vault_key);
+    if (!cached) {
+        vault_key = DataEncryption::deriveKey(master_password, vault_salt);
+    }
+    secure_vector<unsigned char> key = deriveResidentKey(vault_key);
+    secure_string payload = DataEncryption::decryptWithKey(resident->wrapped, key.data());
+    if (payload.size() < DataEncryption::KEY_LENGTH) {
+        throw std::runtime_error("Invalid resident vault state");
+    }
+    if (key_cache && !cached) {
+        key_cache->store(master_password, vault_salt, vault_key);
+    }
+
+    std::string_view data = payload.view();
+    const unsigned char* arena_key = reinterpret_cast<const unsigned char*>(data.data());
+    data.remove_prefix(DataEncryption::KEY_LENGTH);
+    std::string password_hash(nextLine(data));
+    PasswordVerifier verifier = PasswordVerifier::parse(password_hash);
+    std::vector<Tombstone> restored;
+    while (!data.empty()) {
+        std::string_view line = nextLine(data);
+        Tombstone tombstone{};
+        line = parseNumber(line, tombstone.version);
+        line = parseNumber(line, tombstone.origin);
+        line = parseNumber(line, tombstone.sequence);
+        tombstone.service_name.assign(line);
+        restored.push_back(std::move(tombstone));
+    }
+
+    field_arena->applyKeystream(arena_key);
+    master_password_hash = std::move(password_hash);
+    master_verifier = verifier;
+    verifier.clear();
+    tombstones = std::move(restored);
+    url_index.clear();
+    for (const auto& record : records) {
+        url_index.insert(record.getUrl(), record.getServiceName());
+    }
+    setSessionKeys(vault_key);
+    resident.reset();
+    is_authenticated = true;
+}
+
+// Ключ обертки состояния в памяти: отдельный от ключа хранилища
+secure_vector<unsigned char> CredentialVault::deriveResidentKey(const secure_vector<unsigned char>& vault_key) {
+    return deriveSubkey(vault_key, "IRONVAULT-RESIDENT");
+}
+
+// Ключ дельт: у реплик с одной солью совпадает, поэтому дельты между
+// копиями одного файла шифруются и проверяются без KDF
+secure_vector<unsigned char> CredentialVault::deriveDeltaKey(const secure_vector<unsigned char>& vault_key) {
+    return deriveSubkey(vault_key, "IRONVAULT-DELTA");
+}
+
+// Ключи, которые живут, пока хранилище открыто ключом формата 2.x
+void CredentialVault::setSessionKeys(const secure_vector<unsigned char>& vault_key) {
+    resident_key = deriveResidentKey(vault_key);
+    delta_key = deriveDeltaKey(vault_key);
+}
+
+void CredentialVault::clearSessionKeys() {
+    OPENSSL_cleanse(resident_key.data(), resident_key.size());
+    resident_key.clear();
+    OPENSSL_cleanse(delta_key.data(), delta_key.size());
+    delta_key.clear();
+}
+
+// Размер и время изменения файла хранилища; пусто, если файла нет
+std::string CredentialVault::fileStamp() const {
+    std::error_code error;
+    auto size = std::filesystem::file_size(vault_file_path, error);
+    if (error) {
+        return {};
+    }
+    auto time = std::filesystem::last_write_time(vault_file_path, error);
+    if (error) {
+        return {};
+    }
+    return std::to_string(size) + ":" + std::to_string(time.time_since_epoch().count());
+}
+
+// Снимок пишется после вызова загрузки, поэтому в его время не входит
+void CredentialVault::traceSnapshot() {
+    if (api_trace && is_authenticated && !resident && !api_trace->hasSnapshot()) {
+        api_trace->writeSnapshot(orderedRecords());
+    }
+}
+
+// Журнал пакета: имя после изменения и копия записи до него.
+// Копия разделяет арену с хранилищем, а старые значения полей в арене
+// не перезаписываются, поэтому копирование не трогает строки.
+void CredentialVault::recordBatchChange(std::string_view service_name, const CredentialRecord* previous) {
+    if (!batch) {
+        return;
+    }
+    BatchChange change;
+    change.service_name.assign(service_name);
+    if (previous) {
+        change.previous = *previous;
+    }
+    batch->changes.push_back(std::move(change));
+}
+
+void CredentialVault::recordTombstoneChange(std::string_view service_name) {
+    if (!batch) {
+        return;
+    }
+    auto current = std::find_if(tombstones.begin(), tombstones.end(), [service_name](const Tombstone& tombstone) {
+        return tombstone.service_name == service_name;
+    });
+    TombstoneChange change;
+    change.service_name.assign(service_name);
+    if (current != tombstones.end()) {
+        change.previous = *current;
+    }
+    batch->tombstone_changes.push_back(std::move(change));
+}
+
+void CredentialVault::ensureNoBatch() const {
+    if (batch) {
+        throw std::runtime_error("Operation is not allowed while a batch is in progress");
+    }
+}
+
+void CredentialVault::ensureNoAsyncCall() const {
+    if (async_call_active.load(std::memory_order_acquire)) {
+        throw std::runtime_error("Operation is not allowed while an asynchronous call is in progress");
+    }
+}
+
+// Флаг занятости хранилища асинхронным вызовом: снимается при выходе
+// из сопрограммы на любом пути, в том числе по исключению
+CredentialVault::AsyncCallScope::AsyncCallScope(std::atomic<bool>& active)
+        : flag(active) {
+    if (flag.exchange(true, std::memory_order_acq_rel)) {
+        throw std::runtime_error("Another asynchronous vault call is in progress");
+    }
+}
+
+CredentialVault::AsyncCallScope::~AsyncCallScope() {
+    flag.store(false, std::memory_order_release);
+}
+
+// Удаление устаревших отметок удаления
+size_t CredentialVault::pruneTombstones(uint64_t up_to_version) {
+    ensureAuthenticated();
+    ensureNoAsyncCall();
+    ensureNoBatch();
+    size_t before = tombstones.size();
+    tombstones.erase(std::remove_if(tombstones.begin(), tombstones.end(),
+                                    [up_to_version](const Tombstone& tombstone) {
+                                        return tombstone.version <= up_to_version;
+                                    }),
+                     tombstones.end());
+    return before - tombstones.size();
+}
+
+// Аудит паролей. Ключи записей выводятся пачками (DataEncryption::decryptBatch),
+// но каждый поток держит не больше одного открытого пароля: он оценивается и сводится к HMAC под ключом, который живет только во время
+// аудита, после чего сразу обнуляется. Повторы ищутся по этим тегам.
+PasswordAuditReport CredentialVault::auditPasswords(const std::string& master_password, std::time_t max_age,
+                                                    size_t max_threads) const {
+    ensureNoAsyncCall();
+    ensureAuthenticated();
+    if (!verifyMasterPassword(master_password)) {
+        throw std::invalid_argument("Invalid master password");
+    }
+    IRONVAULT_TRACE_SPAN_ARG("vault.audit_passwords", "records", records.size());
+
+    secure_vector<unsigned char> audit_key = DataEncryption::generateKey();
+    std::shared_ptr<const PasswordStrengthEstimator> estimator = MasterPasswordManager::getStrengthEstimator();
+    std::vector<std::array<unsigned char, DataEncryption::DIGEST_LENGTH>> tags(records.size());
+    std::vector<ServiceNameIndex::Slot> order = orderedSlots();
+    std::time_t now = std::time(nullptr);
+
+    PasswordAuditReport report{};
+    report.entries.resize(records.size());
+    report.partial = !sealed_segments.empty();
+
+    std::vector<DataEncryption::BatchItem> items(records.size());
+    for (size_t i = 0; i < records.size(); ++i) {
+        const CredentialRecord& record = records[order[i]];
+        PasswordAuditEntry& entry = report.entries[i];
+        entry.service_name.assign(record.getServiceName());
+        entry.category.assign(record.getCategory());
+        entry.stale = now - record.getLastModified() > max_age;
+        items[i] = DataEncryption::BatchItem{record.getEncryptedPassword(), record.getInternalKey()};
+    }
+
+    DataEncryption::decryptBatch(items, master_password, [&](size_t i, const secure_string *password) {
+        PasswordAuditEntry& entry = report.entries[i];
+        try {
+            if (!password) {
+                throw std::runtime_error("Failed to decrypt password");
+            }
+            StrengthEstimate estimate = estimator->estimate(password->view());
+            entry.score = estimate.score;
+            entry.log2_guesses = estimate.log2_guesses;
+            entry.weak = estimate.score < AUDIT_MIN_SCORE;
+
+            unsigned int length = 0;
+            if (!HMAC(EVP_sha256(), audit_key.data(), static_cast<int>(audit_key.size()),
+                      reinterpret_cast<const unsigned char *>(password->data()), password->size(),
+                      tags[i].data(), &length)) {
+                throw std::runtime_error("Failed to compute password tag");
+            }
+        } catch (const std::exception&) {
+            entry.score = -1;
+            entry.decrypt_failed = true;
+        }
+    }, max_threads);
+
+    // Группы одинаковых паролей в порядке первого появления
+    std::unordered_map<std::string_view, size_t> tag_counts;
+    for (size_t i = 0; i < records.size(); ++i) {
+        if (!report.entries[i].decrypt_failed) {
+            ++tag_counts[std::string_view(reinterpret_cast<const char *>(tags[i].data()), tags[i].size())];
+        }
+    }
+    std::unordered_map<std::string_view, size_t> group_ids;
+    for (size_t i = 0; i < records.size(); ++i) {
+        PasswordAuditEntry& entry = report.entries[i];
+        if (entry.decrypt_failed) {
+            ++report.failed_count;
+        } else {
+            std::string_view tag(reinterpret_cast<const char *>(tags[i].data()), tags[i].size());
+            if (tag_counts[tag] > 1) {
+                auto [group, inserted] = group_ids.emplace(tag, group_ids.size() + 1);
+                entry.reuse_group = group->second;
+                ++report.reused_count;
+            }
+            report.weak_count += entry.weak;
+        }
+        report.stale_count += entry.stale;
+    }
+    report.reuse_groups = group_ids.size();
+    OPENSSL_cleanse(tags.data(), tags.size() * sizeof(tags[0]));
+    return report;
+}
+
+// Категории, сегменты которых не были расшифрованы
+std::vector<std::string> CredentialVault::getSealedCategories() const {
+    ensureNoAsyncCall();
+    std::vector<std::string> categories;
+    categories.reserve(sealed_segments.size());
+    for (const auto& segment : sealed_segments) {
+        categories.push_back(segment.category);
+    }
+    return categories;
+}
+
+bool CredentialVault::isCategorySealed(std::string_view category) const {
+    ensureNoAsyncCall();
+    return std::any_of(sealed_segments.begin(), sealed_segments.end(),
+                       [category](const SealedSegment& segment) { return segment.category == category; });
+}
+
 // Приватные методы
 
+// Запрет изменений в запечатанной категории: ее записи не загружены,
+// и сохранение перезаписало бы сегмент без них
+void CredentialVault::ensureCategoryUnlocked(std::string_view category) const {
+    if (isCategorySealed(category)) {
+        throw std::runtime_error("Category \"" + std::string(category) + "\" is not unlocked");
+    }
+}
+
+// После загрузки: идентификатор реплики для файлов без него и отметки
+// для записей, еще не участвовавших в синхронизации
+void CredentialVault::initializeReplication() {
+    if (replica_id == 0) {
+        replica_id = generateReplicaId();
+    }
+    for (const auto& record : records) {
+        lamport_clock = std::max({lamport_clock, record.getVersion(), record.getSequence()});
+    }
+    for (const auto& tombstone : tombstones) {
+        lamport_clock = std::max({lamport_clock, tombstone.version, tombstone.sequence});
+    }
+    for (auto& record : records) {
+        if (record.getVersion() == 0) {
+            stampRecord(record);
+        }
+    }
+}
+
+// Случайный ненулевой идентификатор реплики
+uint64_t CredentialVault::generateReplicaId() {
+    uint64_t id = 0;
+    while (id == 0) {
+        if (RAND_bytes(reinterpret_cast<unsigned char *>(&id), sizeof(id)) != 1) {
+            throw std::runtime_error("Failed to generate replica id");
+        }
+    }
+    return id;
+}
+
+uint64_t CredentialVault::nextVersion() {
+    return ++lamport_clock;
+}
+
+// Локальное изменение записи отменяет ее прежнее удаление
+void CredentialVault::stampRecord(CredentialRecord& record) {
+    uint64_t version = nextVersion();
+    record.setVersion(version, replica_id);
+    record.setSequence(version);
+    std::string_view service_name = record.getServiceName();
+    recordTombstoneChange(service_name);
+    tombstones.erase(std::remove_if(tombstones.begin(), tombstones.end(),
+                                    [service_name](const Tombstone& tombstone) {
+                                        return tombstone.service_name == service_name;
+                                    }),
+                     tombstones.end());
+}
+
+// Отметка удаления: для одного имени хранится только самая новая.
+// Новая или обновленная отметка получает отметку получения, как запись.
+void CredentialVault::addTombstone(std::string_view service_name, uint64_t version, uint64_t origin) {
+    recordTombstoneChange(service_name);
+    for (auto& tombstone : tombstones) {
+        if (tombstone.service_name == service_name) {
+            if (version > tombstone.version || (version == tombstone.version && origin > tombstone.origin)) {
+                lamport_clock = std::max(lamport_clock, version);
+                tombstone.version = version;
+                tombstone.origin = origin;
+                tombstone.sequence = nextVersion();
+            }
+            return;
+        }
+    }
+    lamport_clock = std::max(lamport_clock, version);
+    tombstones.push_back(Tombstone{std::string(service_name), version, origin, nextVersion()});
+}
+
+// Дельта должна видеть все записи, иначе реплики разойдутся
+void CredentialVault::ensureFullyUnlocked() const {
+    if (!sealed_segments.empty()) {
+        throw std::runtime_error("Replication requires all categories to be unlocked");
+    }
+}
+
+// Запоминание зашифрованного сегмента вместе с хэшем его открытого текста
+void CredentialVault::cacheSegment(std::string_view category, const unsigned char* digest,
+                                   const unsigned char* data_key, VaultCompression::Codec codec,
+                                   std::string_view ciphertext) {
+    CachedSegment& cached = segment_cache[std::string(category)];
+    std::copy(digest, digest + DataEncryption::DIGEST_LENGTH, cached.digest.begin());
+    cached.data_key.assign(data_key, data_key + DataEncryption::KEY_LENGTH);
+    cached.codec = codec;
+    cached.ciphertext.assign(ciphertext);
+}
+
+// Формат 2.0 начинается с открытого заголовка, 1.0 - сразу с Base64
+bool CredentialVault::isSegmentedVault(std::string_view file_data) {
+    return file_data.substr(0, VAULT_HEADER.size() + 1) == VAULT_HEADER + "\n";
+}
+
+// Проверка аутентификации перед изменением записей
+void CredentialVault::ensureAuthenticated() const {
+    if (!is_authenticated) {
+        throw std::runtime_error("Vault is not authenticated");
+    }
+}
+
 // Шифрование данных хранилища
 std::string CredentialVault::encryptVaultData(const std::string& data, const std::string& master_password) const {
     return DataEncryption::encrypt(data, master_password);
 }
 
 // Дешифрование данных хранилища
-std::string CredentialVault::decryptVaultData(const std::string& encrypted_data, const std::string& master_password) const {
+secure_string CredentialVault::decryptVaultData(const std::string& encrypted_data, const std::string& master_password) const {
     return DataEncryption::decrypt(encrypted_data, master_password);
 }
 
@@ -351,12 +2168,14 @@ void CredentialVault::initializePasswordGenerator() {
 }
 
 // Проверка заголовка хранилища
-bool CredentialVault::validateVaultHeader(const std::string& data) const {
-    std::stringstream data_stream(data);
-    std::string header, version;
-
-    std::getline(data_stream, header);
-    std::getline(data_stream, version);
+bool CredentialVault::validateVaultHeader(std::string_view data) const {
+    size_t header_end = data.find('\n');
+    if (header_end == std::string_view::npos) {
+        return false;
+    }
+    std::string_view header = data.substr(0, header_end);
+    std::string_view version = data.substr(header_end + 1);
+    version = version.substr(0, version.find('\n'));
 
     return (header == VAULT_HEADER && version == VAULT_VERSION);
 }
@@ -369,31 +2188,167 @@ std::string CredentialVault::createVaultHeader() const {
     return header.str();
 }
 
-// Сортировка записей
-void CredentialVault::sortRecords() {
-    std::sort(records.begin(), records.end(),
-              [](const CredentialRecord& a, const CredentialRecord& b) {
-                  return a.getServiceName() < b.getServiceName();
-              });
+// Построение индексов имен и адресов с нуля (после загрузки и переноса арены).
+// Из записей с одинаковым именем остается более новая.
+void CredentialVault::rebuildIndexes() {
+    std::vector<std::pair<std::string_view, ServiceNameIndex::Slot>> entries;
+    entries.reserve(records.size());
+    for (size_t i = 0; i < records.size(); ++i) {
+        entries.emplace_back(records[i].getServiceName(), static_cast<ServiceNameIndex::Slot>(i));
+    }
+    std::sort(entries.begin(), entries.end());
+
+    std::vector<size_t> duplicates;
+    size_t unique_end = 0;
+    for (size_t i = 0; i < entries.size(); ++i) {
+        if (unique_end > 0 && entries[unique_end - 1].first == entries[i].first) {
+            CredentialRecord& kept = records[entries[unique_end - 1].second];
+            const CredentialRecord& other = records[entries[i].second];
+            if (other.isNewerThan(kept.getVersion(), kept.getOrigin())) {
+                duplicates.push_back(entries[unique_end - 1].second);
+                entries[unique_end - 1].second = entries[i].second;
+            } else {
+                duplicates.push_back(entries[i].second);
+            }
+            continue;
+        }
+        entries[unique_end++] = entries[i];
+    }
+    entries.resize(unique_end);
+
+    if (!duplicates.empty()) {
+        std::cerr << "Warning: Dropped " << duplicates.size() << " duplicate record(s)" << std::endl;
+        // Удаление с конца, чтобы номера оставшихся дубликатов не сдвигались
+        std::sort(duplicates.rbegin(), duplicates.rend());
+        for (size_t slot : duplicates) {
+            records.erase(records.begin() + static_cast<ptrdiff_t>(slot));
+        }
+        rebuildIndexes();
+        return;
+    }
+    name_index.build(entries);
+
+    url_index.clear();
+    for (const auto& record : records) {
+        url_index.insert(record.getUrl(), record.getServiceName());
+    }
+}
+
+std::vector<ServiceNameIndex::Slot> CredentialVault::orderedSlots() const {
+    std::vector<ServiceNameIndex::Slot> slots;
+    slots.reserve(records.size());
+    for (auto cursor = name_index.begin(); cursor.valid(); cursor.next()) {
+        slots.push_back(cursor.slot());
+    }
+    return slots;
+}
+
+CredentialRecord* CredentialVault::findIndexedRecord(std::string_view service_name) {
+    ServiceNameIndex::Slot slot = 0;
+    return name_index.find(service_name, slot) ? &records[slot] : nullptr;
+}
+
+// Новая запись в конец records и в индекс
+void CredentialVault::appendRecord(CredentialRecord&& record) {
+    records.push_back(std::move(record));
+    name_index.insert(records.back().getServiceName(), static_cast<ServiceNameIndex::Slot>(records.size() - 1));
+    url_index.insert(records.back().getUrl(), records.back().getServiceName());
 }
 
-// Создание резервной копии
+void CredentialVault::eraseRecordAt(size_t slot) {
+    name_index.erase(records[slot].getServiceName());
+    url_index.erase(records[slot].getUrl(), records[slot].getServiceName());
+    if (slot + 1 != records.size()) {
+        records[slot] = std::move(records.back());
+        name_index.assign(records[slot].getServiceName(), static_cast<ServiceNameIndex::Slot>(slot));
+    }
+    records.pop_back();
+}
+
+// Уплотнение арены: обновления и удаления оставляют в ней старые значения.
+// Когда мертвых данных больше, чем живых, записи переносятся в новую арену;
+// старая обнуляется при освобождении последней ссылки на нее.
+void CredentialVault::compactFieldArena() {
+    // В пакете арена уплотняется один раз при commit
+    if (batch) {
+        return;
+    }
+    size_t live_bytes = 0;
+    for (const auto& record : records) {
+        live_bytes += record.getFieldBytes();
+    }
+    size_t used_bytes = field_arena->getUsedBytes();
+    if (used_bytes < FieldArena::DEFAULT_CHUNK_SIZE || used_bytes - live_bytes <= live_bytes) {
+        return;
+    }
+
+    auto compacted = std::make_shared<FieldArena>();
+    compacted->reserve(live_bytes);
+    for (auto& record : records) {
+        record.moveToArena(compacted);
+    }
+    // Ключи индексов указывают на поля в старой арене
+    rebuildIndexes();
+    field_arena = std::move(compacted);
+}
+
+// Разбор хэша мастер-пароля один раз после загрузки.
+// Устаревший формат salt:hash заменяется бинарным заголовком.
+void CredentialVault::refreshMasterVerifier(const std::string& master_password) {
+    try {
+        master_verifier = PasswordVerifier::parse(master_password_hash);
+        if (master_password_hash.size() == PasswordVerifier::ENCODED_LENGTH * 2) {
+            return;
+        }
+    } catch (const std::exception& e) {
+        master_verifier.reset();
+    }
+
+    // Хранилище уже расшифровано этим паролем - пересоздаем хэш в новом формате
+    master_verifier = PasswordVerifier::create(master_password);
+    master_password_hash = master_verifier->encode();
+}
+
+// Создание резервной копии: новое поколение в хранилище копий
 bool CredentialVault::backupVaultFile() const {
-    std::ifstream source(vault_file_path, std::ios::binary);
-    if (!source.is_open()) {
+    if (!backup_store || !std::filesystem::exists(vault_file_path)) {
         return true; // Файла нет - не нужно создавать бэкап
     }
 
-    std::string backup_path = vault_file_path + ".backup";
-    std::ofstream dest(backup_path, std::ios::binary);
-
-    if (!dest.is_open()) {
+    try {
+        backup_store->createGeneration(vault_file_path);
+        return true;
+    } catch (const std::exception& e) {
+        std::cerr << "Warning: Failed to back up vault: " << e.what() << std::endl;
         return false;
     }
+}
 
-    dest << source.rdbuf();
-    source.close();
-    dest.close();
+// Установка хранилища резервных копий
+void CredentialVault::setBackupStore(std::shared_ptr<BackupStore> store) {
+    ensureNoAsyncCall();
+    backup_store = std::move(store);
+}
+
+std::shared_ptr<BackupStore> CredentialVault::getBackupStore() const {
+    ensureNoAsyncCall();
+    return backup_store;
+}
 
+// Восстановление из поколения; хранилище блокируется, так как записи
+// в памяти больше не соответствуют файлу
+bool CredentialVault::restoreBackup(uint64_t generation_id) {
+    ensureNoAsyncCall();
+    if (!backup_store) {
+        throw std::runtime_error("Backup store is not configured");
+    }
+    try {
+        backup_store->restoreGeneration(generation_id, vault_file_path);
+    } catch (const std::exception& e) {
+        std::cerr << "Failed to restore backup: " << e.what() << std::endl;
+        return false;
+    }
+    batch.reset();
+    clearUnlockedState();
     return true;
 }
\ No newline at end of file
@@ -6,24 +6,169 @@
 #include "MasterPasswordManager.h"
 #include "PasswordGenerator.h"
 #include "SearchFilter.h"
+#include "PasswordVerifier.h"
+#include "UnlockGate.h"
+#include "SessionKeyCache.h"
+#include "BackupStore.h"
+#include "ServiceNameIndex.h"
+#include "UrlIndex.h"
+#include "VaultCompression.h"
+#include "ApiTraceRecorder.h"
+#include "VaultExecutor.h"
+#include "VaultTask.h"
+#include <array>
+#include <atomic>
 #include <vector>
 #include <string>
 #include <memory>
 #include <unordered_map>
 #include <ctime>
+#include <optional>
+#include <string_view>
+
+// Итог применения дельты другой реплики
+struct DeltaApplyResult {
+    uint64_t source_replica;  // реплика, выгрузившая дельту
+    uint64_t source_version;  // ее часы на момент выгрузки - since для следующего запроса
+    size_t records_applied;   // добавленные и обновленные записи
+    size_t records_removed;   // записи, удаленные по отметкам удаления
+    size_t changes_skipped;   // изменения, проигравшие более новым локальным
+};
+
+// Страница записей в порядке имен сервисов
+struct RecordPage {
+    std::vector<CredentialRecord> records;
+    std::string next_cursor; // имя последней записи страницы; пустое - дальше записей нет
+};
+
+// Запись, подходящая для страницы
+struct UrlMatch {
+    CredentialRecord record;
+    UrlMatchKind kind;
+};
+
+// Результат проверки пароля одной записи
+struct PasswordAuditEntry {
+    std::string service_name;
+    std::string category;
+    int score;              // 0-4 по оценщику стойкости; -1, если пароль не расшифрован
+    double log2_guesses;
+    size_t reuse_group;     // 0 - пароль уникален, иначе номер группы одинаковых паролей
+    bool weak;
+    bool stale;             // не менялся дольше заданного срока
+    bool decrypt_failed;
+};
+
+// Отчет о паролях хранилища
+struct PasswordAuditReport {
+    std::vector<PasswordAuditEntry> entries; // в порядке имен сервисов
+    size_t weak_count;
+    size_t reused_count;    // записи, пароль которых встречается больше одного раза
+    size_t reuse_groups;
+    size_t stale_count;
+    size_t failed_count;
+    bool partial;           // есть запечатанные категории, их записи не проверены
+};
 
 class CredentialVault {
 private:
-    std::vector<CredentialRecord> records;
+    // Сегмент категории, не расшифрованный при частичной разблокировке;
+    // при сохранении записывается без изменений
+    struct SealedSegment {
+        std::string category;
+        std::string wrapped_key; // ключ данных сегмента, зашифрованный ключом хранилища
+        std::string ciphertext;
+        size_t record_count;
+        std::vector<std::string> service_names; // из индекса файла, по возрастанию
+        bool names_known; // в файле старой версии имен сегмента в индексе нет
+    };
+
+    std::vector<CredentialRecord> records; // порядок ячеек произвольный, порядок имен - в name_index
+    ServiceNameIndex name_index; // имя сервиса -> номер ячейки в records
+    UrlIndex url_index; // хост адреса записи -> имена сервисов
     std::string vault_file_path;
     std::string master_password_hash;
+    std::optional<PasswordVerifier> master_verifier; // разобранный master_password_hash
     bool is_authenticated;
-    std::unique_ptr<PasswordGenerator> password_genera;
+    std::unique_ptr<PasswordGenerator> password_generator;
+    std::shared_ptr<UnlockGate> unlock_gate; // ограничение попыток разблокировки (необязательно)
+    std::shared_ptr<FieldArena> field_arena; // общая арена строковых полей записей
+    // Отметка удаления записи для репликации
+    struct Tombstone {
+        std::string service_name;
+        uint64_t version;
+        uint64_t origin;
+        uint64_t sequence; // отметка получения этой репликой, как у записей
+    };
+
+    // Последний записанный или прочитанный шифртекст расшифрованной категории
+    struct CachedSegment {
+        std::array<unsigned char, 32> digest; // SHA-256 открытого текста сегмента
+        secure_vector<unsigned char> data_key;
+        VaultCompression::Codec codec; // кодек, которым сжат шифруемый текст
+        std::string ciphertext;
+    };
+
+    std::vector<SealedSegment> sealed_segments; // категории, не запрошенные при разблокировке
+    std::unordered_map<std::string, CachedSegment> segment_cache; // по категории
+    std::vector<unsigned char> vault_salt; // соль ключа хранилища (формат 2.0)
+    std::shared_ptr<SessionKeyCache> key_cache; // кэш ключей хранилищ (необязательно)
+    std::shared_ptr<ApiTraceRecorder> api_trace; // обезличенная трасса вызовов (необязательно)
+    std::shared_ptr<VaultExecutor> executor; // исполнитель асинхронных вызовов (nullptr - общий)
+    std::atomic<bool> async_call_active;     // выполняется асинхронный вызов
+    std::shared_ptr<BackupStore> backup_store; // поколения резервных копий (nullptr - без копий)
+    VaultCompression::Codec compression_codec; // сжатие сегментов перед шифрованием
+    uint64_t lamport_clock; // часы Лэмпорта: максимальная известная версия
+    uint64_t replica_id; // случайный идентификатор этого файла хранилища
+    size_t loaded_record_markers; // строки ---RECORD--- в данных последней загрузки
+    std::vector<Tombstone> tombstones;
+
+    // Состояние блокировки без выгрузки записей: поля записей в арене
+    // зашифрованы на месте случайным ключом, а этот ключ, хэш мастер-пароля
+    // и отметки удаления зашифрованы ключом, выводимым из ключа хранилища
+    struct ResidentState {
+        std::string wrapped;
+        std::string file_stamp; // размер и время изменения файла на момент блокировки
+    };
+
+    // Журнал отката пакета изменений: изменения применяются сразу,
+    // откат проходит журнал в обратном порядке
+    struct BatchChange {
+        std::string service_name;                 // имя записи после изменения; пусто - запись удалена
+        std::optional<CredentialRecord> previous; // запись до изменения; нет - запись добавлена
+    };
+
+    struct TombstoneChange {
+        std::string service_name;
+        std::optional<Tombstone> previous;
+    };
+
+    struct BatchState {
+        std::vector<BatchChange> changes;
+        std::vector<TombstoneChange> tombstone_changes;
+        uint64_t lamport_clock; // часы на момент beginBatch
+    };
+
+    std::optional<BatchState> batch;
+    std::optional<ResidentState> resident;
+    secure_vector<unsigned char> resident_key; // ключ обертки; есть, пока хранилище открыто ключом формата 2.x
+    secure_vector<unsigned char> delta_key; // ключ дельт для текущей соли; живет вместе с resident_key
 
 
     // Константы
     static const std::string VAULT_HEADER;
     static const std::string VAULT_VERSION;
+    static const std::string VAULT_SEGMENTED_VERSION;
+    static const std::string VAULT_COMPRESSED_VERSION;
+    static const std::string DELTA_HEADER;
+    static const std::string DELTA_VERSION;
+
+public:
+    static const std::string DEFAULT_CLIENT_ID;
+    // Срок, после которого пароль считается устаревшим (год)
+    static const std::time_t DEFAULT_AUDIT_MAX_AGE = 365 * 24 * 60 * 60;
+    // Пароли с оценкой ниже считаются слабыми
+    static const int AUDIT_MIN_SCORE = 3;
 
 public:
     // Конструкторы
@@ -32,32 +177,180 @@ public:
     explicit CredentialVault(const std::string &file_path);
 
     // Основные методы работы с хранилищем
-    bool loadFromFile(const std::string &master_password);
+    bool loadFromFile(const std::string &master_password, const std::string &client_id = DEFAULT_CLIENT_ID);
+
+    // Разблокировка только указанных категорий (формат 2.0). Остальные сегменты
+    // остаются зашифрованными, сохраняются без изменений и закрыты для записи.
+    // Файл формата 1.0 загружается целиком.
+    bool unlockCategories(const std::string &master_password, const std::vector<std::string> &categories,
+                          const std::string &client_id = DEFAULT_CLIENT_ID);
 
     bool saveToFile(const std::string &master_password);
 
-    bool verifyMasterPassword(const std::string &master_password) const;
+    // Асинхронные варианты: чтение и запись файла выполняются в контексте Io
+    // исполнителя, KDF, шифрование, разбор и поиск - в Cpu, продолжение
+    // ожидающего - в Completion. Аргументы копируются в кадр сопрограммы.
+    // Одновременно с хранилищем работает один вызов: пока задача не
+    // завершена, второй асинхронный вызов и любой другой метод хранилища,
+    // кроме getExecutor и getVaultFilePath, бросают исключение.
+    VaultTask<bool> loadAsync(std::string master_password, std::string client_id = DEFAULT_CLIENT_ID);
+
+    VaultTask<bool> saveAsync(std::string master_password);
+
+    VaultTask<std::vector<CredentialRecord>> searchAsync(SearchFilter filter);
+
+    VaultTask<secure_string> generatePasswordAsync(int length = 16,
+                                                   bool use_uppercase = true,
+                                                   bool use_lowercase = true,
+                                                   bool use_digits = true,
+                                                   bool use_special = true);
+
+    void setExecutor(std::shared_ptr<VaultExecutor> vault_executor);
+
+    // Исполнитель хранилища или общий, если свой не задан
+    std::shared_ptr<VaultExecutor> getExecutor() const;
+
+    // Работа с образом файла в памяти (офлайн-инструменты, миграция):
+    // загрузка уже прочитанного содержимого файла любой версии и файл текущего
+    // формата без записи на диск. Блокировщик попыток и резервные копии
+    // не используются.
+    bool loadFromData(const std::string &file_data, const std::string &master_password);
+
+    std::string buildFileImage(const std::string &master_password);
+
+    // Файл уже в текущем формате: сегменты (2.x), сжатые, если задан codec.
+    // Файл формата 1.0 зашифрован целиком и распознается по отсутствию заголовка.
+    static bool isCurrentFormat(std::string_view file_data, VaultCompression::Codec codec);
+
+    bool verifyMasterPassword(const std::string &master_password,
+                              const std::string &client_id = DEFAULT_CLIENT_ID) const;
+
+    void setUnlockGate(std::shared_ptr<UnlockGate> gate);
+
+    void setKeyCache(std::shared_ptr<SessionKeyCache> cache);
+
+    // Запись трассы вызовов API для IronVault_Replay (nullptr - выключена).
+    // Состояние хранилища попадает в трассу при первом открытии.
+    void setApiTrace(std::shared_ptr<ApiTraceRecorder> trace);
 
-    void lockVault();
+    std::shared_ptr<ApiTraceRecorder> getApiTrace() const;
+
+    // Сжатие сегментов при следующем сохранении; при загрузке берется кодек файла
+    void setCompression(VaultCompression::Codec codec);
+
+    VaultCompression::Codec getCompression() const;
+
+    // Блокировка: записи удаляются, арена их полей обнуляется целиком
+    // (копии записей, полученные до блокировки, становятся пустыми).
+    // keep_resident: записи и индекс имен остаются в памяти, но поля записей
+    // шифруются на месте, а ключи и кэши сегментов обнуляются. Следующая
+    // loadFromFile стоит одного KDF и проверки MAC, если файл не менялся;
+    // иначе выполняется полная загрузка. Хранилище с запечатанными
+    // категориями или ни разу не открытое и не сохраненное в формате 2.x
+    // блокируется полностью.
+    void lockVault(bool keep_resident = false);
+
+    // Заблокировано с сохранением записей в памяти
+    bool isResident() const;
 
     // Управление записями
     bool addRecord(const CredentialRecord &record);
 
+    bool addRecord(CredentialRecord &&record);
+
+    // Создание записи прямо в хранилище из аргументов конструктора CredentialRecord
+    template<typename... Args>
+    bool emplaceRecord(Args &&... args);
+
     bool updateRecord(const std::string &service_name, const CredentialRecord &updated_record);
 
+    bool updateRecord(const std::string &service_name, CredentialRecord &&updated_record);
+
     bool removeRecord(const std::string &service_name);
 
     CredentialRecord *findRecord(const std::string &service_name);
 
+    // Пакет изменений. После beginBatch добавление, обновление и удаление
+    // записей видны сразу, но попадают в журнал отката. commit ставит всем
+    // затронутым записям одну отметку времени, один раз сохраняет файл и
+    // уплотняет арену; при ошибке сохранения пакет остается открытым.
+    // rollback возвращает записи, отметки удаления и часы за O(изменений).
+    // Изменения через указатель findRecord в журнал не попадают.
+    // Сохранение, применение дельты и очистка отметок удаления внутри пакета
+    // запрещены; блокировка отменяет незафиксированный пакет.
+    void beginBatch();
+
+    // При неудаче (false или исключение) пакет остается открытым:
+    // можно повторить commit или вызвать rollback
+    bool commit(const std::string &master_password);
+
+    void rollback();
+
+    bool inBatch() const;
+
 // Поиск и фильтрация
     std::vector<CredentialRecord> searchRecords(const SearchFilter &filter) const;
 
     std::vector<CredentialRecord> getRecordsByCategory(const std::string &category) const;
 
+    // Записи, имя сервиса которых начинается с prefix, по порядку имен;
+    // limit == 0 - без ограничения. Стоимость - спуск по индексу и limit шагов.
+    std::vector<CredentialRecord> prefixSearch(std::string_view prefix, size_t limit = 0) const;
+
+    // Постраничный обход по порядку имен: записи с именем строго после cursor
+    // (пустой - с начала) и с префиксом prefix. Курсор - само имя, поэтому он
+    // остается верным между изменениями хранилища.
+    RecordPage getRecordPage(std::string_view cursor, size_t limit, std::string_view prefix = {}) const;
+
+    // Записи для автозаполнения на странице url: сначала с тем же хостом,
+    // затем с родительским доменом страницы, затем с другими поддоменами
+    // того же регистрируемого домена. Адреса записей разобраны заранее,
+    // поэтому стоимость зависит от числа совпадений, а не от размера хранилища.
+    std::vector<UrlMatch> findByUrl(std::string_view url, size_t limit = 0) const;
+
     std::vector<std::string> getAllCategories() const;
 
+    std::vector<std::string> getSealedCategories() const;
+
+    bool isCategorySealed(std::string_view category) const;
+
+    // Репликация. Каждое изменение через API хранилища получает отметку
+    // Лэмпорта; конфликт решается по паре (версия, реплика). Изменения,
+    // сделанные через указатель из findRecord, отметки не получают
+    // (имя сервиса через этот указатель менять нельзя - индекс его не увидит).
+    uint64_t getVersion() const;
+
+    uint64_t getReplicaId() const;
+
+    // Новый идентификатор реплики: вызывается после копирования файла хранилища
+    // на другой узел, иначе две копии будут ставить одинаковые отметки
+    uint64_t assignNewReplicaId();
+
+    // Дельта: записи и удаления, полученные этой репликой после ее часов
+    // since_version, - и свои изменения, и пришедшие от других реплик, так
+    // что изменения передаются по цепочке A -> B -> C. since_version - это
+    // source_version из результата предыдущего applyDelta от этой реплики.
+    // Шифруется ключом, производным от ключа хранилища (encrypt-then-MAC);
+    // соль ключа передается открыто. Хранилище должно быть открыто или
+    // сохранено в формате 2.x.
+    std::string exportDelta(uint64_t since_version) const;
+
+    // Пароль нужен для ключа дельты, если соль реплики-источника отличается
+    // от своей; такой ключ берется из кэша сессии или вычисляется KDF
+    DeltaApplyResult applyDelta(const std::string &delta, const std::string &master_password);
+
+    // Удаление отметок удаления, которые уже получили все реплики
+    size_t pruneTombstones(uint64_t up_to_version);
+
+    // Аудит паролей: расшифровка записей параллельно, оценка стойкости,
+    // повторы по HMAC со случайным ключом аудита (открытые пароли не
+    // накапливаются) и устаревшие записи по дате изменения
+    PasswordAuditReport auditPasswords(const std::string &master_password,
+                                       std::time_t max_age = DEFAULT_AUDIT_MAX_AGE,
+                                       size_t max_threads = 0) const;
+
     // Генерация паролей
-    std::string generatePassword(int length = 16,
+    secure_string generatePassword(int length = 16,
                                  bool use_uppercase = true,
                                  bool use_lowercase = true,
                                  bool use_digits = true,
@@ -66,6 +359,10 @@ public:
     // Статистика
     size_t getRecordCount() const;
 
+    // Число блоков ---RECORD--- в расшифрованных при загрузке данных; больше
+    // getRecordCount(), если часть блоков не стала записями
+    size_t getLoadedRecordMarkers() const;
+
     size_t getCategoryCount() const;
 
     std::time_t getLastModified() const;
@@ -78,29 +375,159 @@ public:
     std::vector<CredentialRecord> getAllRecords() const;
 
     // Валидация
-    bool isServiceNameUnique(const std::string &service_name) const;
+    bool isServiceNameUnique(std::string_view service_name) const;
 
     bool validateRecord(const CredentialRecord &record) const;
 
+    // Резервные копии: перед каждым сохранением текущий файл добавляется
+    // в хранилище копий <файл>.backups
+    void setBackupStore(std::shared_ptr<BackupStore> store);
+
+    std::shared_ptr<BackupStore> getBackupStore() const;
+
+    // Восстановление файла хранилища из поколения; затем нужна повторная загрузка
+    bool restoreBackup(uint64_t generation_id);
+
     // Импорт/экспорт
     bool exportToCsv(const std::string &file_path, const std::string &master_password) const;
 
     bool importFromCsv(const std::string &file_path, const std::string &master_password);
 
 private:
+    // Загрузка
+    bool loadVault(const std::string &master_password, const std::vector<std::string> *categories,
+                   const std::string &client_id);
+
+    // Загрузка делится на чтение файла (Io) и открытие прочитанного (Cpu).
+    // file_data == nullopt - файла нет или записи в памяти годятся без него.
+    std::optional<std::string> readVaultFile() const;
+
+    bool openVault(const std::string &master_password, const std::vector<std::string> *categories,
+                   const std::string &client_id, std::optional<std::string> &file_data);
+
+    // Записи, оставленные в памяти блокировкой, годятся без чтения файла
+    bool isResidentFresh(const std::vector<std::string> *categories) const;
+
+    // Резервная копия текущего файла и запись нового образа; исключение при ошибке записи
+    void writeVaultFile(const std::string &file_data);
+
+    bool decodeVault(const std::string &encrypted_data, const std::string &master_password,
+                     const std::vector<std::string> *categories, std::optional<UnlockGate::Permit> &permit);
+
+    void loadLegacyVault(const std::string &encrypted_data, const std::string &master_password,
+                         std::optional<UnlockGate::Permit> &permit);
+
+    void loadSegmentedVault(std::string_view file_data, const std::string &master_password,
+                            const std::vector<std::string> *categories,
+                            std::optional<UnlockGate::Permit> &permit);
+
+    void parseRecords(std::string_view data, std::vector<CredentialRecord> &out, bool legacy = false);
+
+    std::string buildSegmentedVault(const std::string &master_password);
+
+    static bool isSegmentedVault(std::string_view file_data);
+
+    void cacheSegment(std::string_view category, const unsigned char *digest, const unsigned char *data_key,
+                      VaultCompression::Codec codec, std::string_view ciphertext);
+
+    void ensureCategoryUnlocked(std::string_view category) const;
+
+    // Репликация
+    void initializeReplication();
+
+    static uint64_t generateReplicaId();
+
+    uint64_t nextVersion();
+
+    void stampRecord(CredentialRecord &record);
+
+    void addTombstone(std::string_view service_name, uint64_t version, uint64_t origin);
+
+    // Журнал пакета
+    void recordBatchChange(std::string_view service_name, const CredentialRecord *previous);
+
+    void recordTombstoneChange(std::string_view service_name);
+
+    void ensureNoBatch() const;
+
+    void ensureNoAsyncCall() const;
+
+    // Занимает флаг асинхронного вызова на время сопрограммы
+    class AsyncCallScope {
+        std::atomic<bool> &flag;
+
+    public:
+        explicit AsyncCallScope(std::atomic<bool> &active);
+
+        AsyncCallScope(const AsyncCallScope &) = delete;
+
+        AsyncCallScope &operator=(const AsyncCallScope &) = delete;
+
+        ~AsyncCallScope();
+    };
+
+    void ensureFullyUnlocked() const;
+
+    void clearUnlockedState();
+
+    // Блокировка и разблокировка с сохранением записей в памяти
+    void sealResident();
+
+    void unlockResident(const std::string &master_password);
+
+    static secure_vector<unsigned char> deriveResidentKey(const secure_vector<unsigned char> &vault_key);
+
+    static secure_vector<unsigned char> deriveDeltaKey(const secure_vector<unsigned char> &vault_key);
+
+    void setSessionKeys(const secure_vector<unsigned char> &vault_key);
+
+    void clearSessionKeys();
+
+    std::string fileStamp() const;
+
+    // Состояние хранилища в трассу вызовов, если оно еще не записано
+    void traceSnapshot();
+
     // Внутренние методы
     std::string encryptVaultData(const std::string &data, const std::string &master_password) const;
 
-    std::string decryptVaultData(const std::string &encrypted_data, const std::string &master_password) const;
+    secure_string decryptVaultData(const std::string &encrypted_data, const std::string &master_password) const;
 
     void initializePasswordGenerator();
 
-    bool validateVaultHeader(const std::string &data) const;
+    bool validateVaultHeader(std::string_view data) const;
 
     std::string createVaultHeader() const;
 
     // Вспомогательные методы
-    void sortRecords();
+    void rebuildIndexes();
+
+    // Номера ячеек records в порядке имен
+    std::vector<ServiceNameIndex::Slot> orderedSlots() const;
+
+    std::vector<CredentialRecord> orderedRecords() const;
+
+    // Тела поиска и генерации пароля без проверки асинхронного вызова:
+    // их выполняют и сопрограммы searchAsync и generatePasswordAsync
+    std::vector<CredentialRecord> filterRecords(const SearchFilter &filter) const;
+
+    secure_string runPasswordGenerator(int length, bool use_uppercase, bool use_lowercase,
+                                       bool use_digits, bool use_special);
+
+    CredentialRecord *findIndexedRecord(std::string_view service_name);
+
+    void appendRecord(CredentialRecord &&record);
+
+    // Удаление ячейки: на ее место переносится последняя запись
+    void eraseRecordAt(size_t slot);
+
+    void compactFieldArena();
+
+    void refreshMasterVerifier(const std::string &master_password);
+
+    void ensureAuthenticated() const;
+
+    bool adoptEmplacedRecord();
 
     void removeDuplicateRecords();
 
@@ -108,5 +535,15 @@ private:
 
 };
 
+// Создание записи на месте: запись конструируется в конце records,
+// затем проверяется; при ошибке проверки она удаляется
+template<typename... Args>
+bool CredentialVault::emplaceRecord(Args &&... args) {
+    ensureAuthenticated();
+    ensureNoAsyncCall();
+    records.emplace_back(std::forward<Args>(args)...);
+    return adoptEmplacedRecord();
+}
+
 
 #endif
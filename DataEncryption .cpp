@@ -1,9 +1,18 @@
 #include "DataEncryption .h"
+#include "CipherContextPool.h"
+#include "ParallelRunner.h"
+#include "Pbkdf2Lanes.h"
+#include "VaultMetrics.h"
+#include "VaultTrace.h"
 #include <openssl/evp.h>
 #include <openssl/kdf.h>
+#include <openssl/hmac.h>
+#include <openssl/crypto.h>
 #include <openssl/err.h>
 #include <openssl/bio.h>
 #include <openssl/buffer.h>
+#include <algorithm>
+#include <optional>
 #include <sstream>
 #include <stdexcept>
 #include <iostream>
@@ -14,136 +23,384 @@ const std::string DataEncryption::DIGEST_ALGORITHM = "sha256";
 
 // Основной метод шифрования
 std::string
-DataEncryption::encrypt(const std::string &plaintext, const std::string &password, const std::string &internal_key) {
+DataEncryption::encrypt(std::string_view plaintext, std::string_view password, std::string_view internal_key) {
     if (plaintext.empty()) {
         throw std::invalid_argument("Plaintext cannot be empty");
     }
     if (password.empty()) {
         throw std::invalid_argument("Password cannot be empty");
     }
+    IRONVAULT_METRIC_TIMER(MetricOperation::Encrypt);
+    IRONVAULT_TRACE_SPAN_ARG("crypto.encrypt", "bytes", plaintext.size());
+    IRONVAULT_METRIC_ADD(MetricCounter::BytesEncrypted, plaintext.size());
+    CipherContextPool &pool = CipherContextPool::local();
+
+    // Итоговый буфер: соль + IV + зашифрованные данные
+    std::vector<unsigned char> &result = pool.scratch();
+    result.resize(SALT_LENGTH + IV_LENGTH + plaintext.size() + EVP_MAX_BLOCK_LENGTH);
+    unsigned char *salt = result.data();
+    unsigned char *iv = salt + SALT_LENGTH;
+    unsigned char *ciphertext = iv + IV_LENGTH;
+
     // Генерируем соль и IV
-    std::vector<unsigned char> salt = generateSalt();
-    std::vector<unsigned char> iv = generateIV();
+    if (RAND_bytes(salt, SALT_LENGTH) != 1 || RAND_bytes(iv, IV_LENGTH) != 1) {
+        throw std::runtime_error("Failed to generate salt or IV");
+    }
 
     // Производим ключ из пароля
-    std::vector<unsigned char> key = deriveKey(password, salt, internal_key);
+    unsigned char key[KEY_LENGTH];
+    deriveKeyInto(password, salt, SALT_LENGTH, internal_key, key);
+
+    // Берем контекст из пула потока
+    CipherContextPool::Handle ctx = pool.acquire();
 
-    // Создаем контекст шифрования
-    EVP_CIPHER_CTX *ctx = createCipherContext();
-    if (!ctx) {
-        throw std::runtime_error("Failed to create cipher context");
-    }
     // Инициализируем шифрование
-    if (EVP_EncryptInit_ex(ctx, EVP_aes_256_cbc(), nullptr, key.data(), iv.data()) != 1) {
-        cleanupCipherContext(ctx);
+    int init_result = EVP_EncryptInit_ex(ctx.get(), pool.getCipher(), nullptr, key, iv);
+    OPENSSL_cleanse(key, KEY_LENGTH);
+    if (init_result != 1) {
         throw std::runtime_error("Failed to initialize encryption");
     }
+
     // Шифруем данные
-    std::vector<unsigned char> ciphertext(plaintext.size() + EVP_CIPHER_CTX_block_size(ctx));
     int len = 0;
     int ciphertext_len = 0;
 
-    if (EVP_EncryptUpdate(ctx, ciphertext.data(), &len,
+    if (EVP_EncryptUpdate(ctx.get(), ciphertext, &len,
                           reinterpret_cast<const unsigned char *>(plaintext.data()),
                           plaintext.size()) != 1) {
-        cleanupCipherContext(ctx);
         throw std::runtime_error("Failed to encrypt data");
     }
     ciphertext_len = len;
 
-    if (EVP_EncryptFinal_ex(ctx, ciphertext.data() + len, &len) != 1) {
-        cleanupCipherContext(ctx);
+    if (EVP_EncryptFinal_ex(ctx.get(), ciphertext + len, &len) != 1) {
         throw std::runtime_error("Failed to finalize encryption");
     }
     ciphertext_len += len;
 
-    cleanupCipherContext(ctx);
-
-    // Формируем итоговый результат: соль + IV + зашифрованные данные
-    std::vector<unsigned char> result;
-    result.reserve(salt.size() + iv.size() + ciphertext_len);
-    result.insert(result.end(), salt.begin(), salt.end());
-    result.insert(result.end(), iv.begin(), iv.end());
-    result.insert(result.end(), ciphertext.begin(), ciphertext.begin() + ciphertext_len);
-
-    return encodeBase64(result);
+    return encodeBase64(result.data(), SALT_LENGTH + IV_LENGTH + ciphertext_len);
 }
 // Основной метод дешифрования
-std::string DataEncryption::decrypt(const std::string& ciphertext, const std::string& password, const std::string& internal_key) {
+secure_string DataEncryption::decrypt(std::string_view ciphertext, std::string_view password, std::string_view internal_key) {
     if (ciphertext.empty()) {
         throw std::invalid_argument("Ciphertext cannot be empty");
     }
     if (password.empty()) {
         throw std::invalid_argument("Password cannot be empty");
     }
+    IRONVAULT_METRIC_TIMER(MetricOperation::Decrypt);
+    IRONVAULT_TRACE_SPAN_ARG("crypto.decrypt", "bytes", ciphertext.size());
+    CipherContextPool &pool = CipherContextPool::local();
 
-    // Декодируем из Base64
-    std::vector<unsigned char> data = decodeBase64(ciphertext);
+    // Декодируем из Base64 в рабочий буфер потока
+    std::vector<unsigned char> &data = pool.scratch();
+    decodeBase64(ciphertext, data);
 
     // Проверяем минимальный размер данных
     if (data.size() < SALT_LENGTH + IV_LENGTH) {
         throw std::runtime_error("Invalid ciphertext format");
     }
 
-    // Извлекаем соль и IV
-    std::vector<unsigned char> salt(data.begin(), data.begin() + SALT_LENGTH);
-    std::vector<unsigned char> iv(data.begin() + SALT_LENGTH, data.begin() + SALT_LENGTH + IV_LENGTH);
-    std::vector<unsigned char> encrypted_data(data.begin() + SALT_LENGTH + IV_LENGTH, data.end());
+    // Соль, IV и зашифрованные данные лежат подряд
+    const unsigned char *salt = data.data();
+    const unsigned char *iv = salt + SALT_LENGTH;
+    const unsigned char *encrypted_data = iv + IV_LENGTH;
+    size_t encrypted_size = data.size() - SALT_LENGTH - IV_LENGTH;
 
     // Производим ключ из пароля
-    std::vector<unsigned char> key = deriveKey(password, salt, internal_key);
+    unsigned char key[KEY_LENGTH];
+    deriveKeyInto(password, salt, SALT_LENGTH, internal_key, key);
+    try {
+        secure_string plaintext = decryptCbc(key, iv, encrypted_data, encrypted_size);
+        OPENSSL_cleanse(key, KEY_LENGTH);
+        return plaintext;
+    } catch (...) {
+        OPENSSL_cleanse(key, KEY_LENGTH);
+        throw;
+    }
+}
 
-    // Создаем контекст дешифрования
-    EVP_CIPHER_CTX* ctx = createCipherContext();
-    if (!ctx) {
-        throw std::runtime_error("Failed to create cipher context");
+// Пакетное дешифрование: ключи группы выводятся вместе, затем
+// шифртексты группы дешифруются и по одному отдаются consumer
+void DataEncryption::decryptBatch(const std::vector<BatchItem> &items, std::string_view password,
+                                  const std::function<void(size_t, const secure_string *)> &consumer,
+                                  size_t max_threads) {
+    if (password.empty()) {
+        throw std::invalid_argument("Password cannot be empty");
+    }
+    if (items.empty()) {
+        return;
     }
+    IRONVAULT_TRACE_SPAN_ARG("crypto.decrypt_batch", "items", items.size());
+
+    // Группа - полная ширина ядра, пока групп хватает на все потоки
+    size_t thread_count = max_threads ? max_threads : ParallelRunner::defaultThreadCount();
+    size_t group_size = std::min(Pbkdf2Lanes::laneCount(), (items.size() + thread_count - 1) / thread_count);
+    size_t group_count = (items.size() + group_size - 1) / group_size;
+
+    ParallelRunner::forEach(group_count, thread_count, [&](size_t group) {
+        size_t begin = group * group_size;
+        size_t end = std::min(items.size(), begin + group_size);
+        std::vector<std::vector<unsigned char>> decoded(end - begin);
+        std::vector<secure_string> passwords(end - begin);
+        secure_vector<unsigned char> keys((end - begin) * KEY_LENGTH);
+        std::vector<Pbkdf2Lanes::Job> jobs;
+        jobs.reserve(end - begin);
+
+        // Соль каждого шифртекста; поврежденные в вывод не попадают
+        for (size_t i = begin; i < end; ++i) {
+            std::vector<unsigned char> &data = decoded[i - begin];
+            try {
+                decodeBase64(items[i].ciphertext, data);
+            } catch (const std::exception &) {
+                data.clear();
+            }
+            if (data.size() < SALT_LENGTH + IV_LENGTH) {
+                data.clear();
+                continue;
+            }
+            secure_string &combined_password = passwords[i - begin];
+            combined_password.reserve(password.size() + items[i].internal_key.size());
+            combined_password.append(password);
+            combined_password.append(items[i].internal_key);
+            jobs.push_back(Pbkdf2Lanes::Job{combined_password.view(), data.data(), SALT_LENGTH,
+                                            keys.data() + (i - begin) * KEY_LENGTH});
+        }
+        {
+            IRONVAULT_METRIC_TIMER(MetricOperation::DeriveKey);
+            IRONVAULT_TRACE_SPAN_ARG("crypto.derive_key_lanes", "keys", jobs.size());
+            IRONVAULT_METRIC_ADD(MetricCounter::KdfCalls, jobs.size());
+            Pbkdf2Lanes::derive(jobs.data(), jobs.size(), ITERATIONS);
+        }
+
+        for (size_t i = begin; i < end; ++i) {
+            const std::vector<unsigned char> &data = decoded[i - begin];
+            std::optional<secure_string> plaintext;
+            if (!data.empty()) {
+                const unsigned char *iv = data.data() + SALT_LENGTH;
+                try {
+                    plaintext = decryptCbc(keys.data() + (i - begin) * KEY_LENGTH, iv, iv + IV_LENGTH,
+                                           data.size() - SALT_LENGTH - IV_LENGTH);
+                } catch (const std::exception &) {
+                    plaintext.reset();
+                }
+            }
+            consumer(i, plaintext ? &*plaintext : nullptr);
+        }
+    });
+}
+
+// AES-256-CBC ключом из PBKDF2
+secure_string DataEncryption::decryptCbc(const unsigned char *key, const unsigned char *iv,
+                                         const unsigned char *encrypted_data, size_t encrypted_size) {
+    CipherContextPool &pool = CipherContextPool::local();
+
+    // Берем контекст из пула потока
+    CipherContextPool::Handle ctx = pool.acquire();
 
     // Инициализируем дешифрование
-    if (EVP_DecryptInit_ex(ctx, EVP_aes_256_cbc(), nullptr, key.data(), iv.data()) != 1) {
-        cleanupCipherContext(ctx);
+    int init_result = EVP_DecryptInit_ex(ctx.get(), pool.getCipher(), nullptr, key, iv);
+    if (init_result != 1) {
         throw std::runtime_error("Failed to initialize decryption");
     }
 
-    // Дешифруем данные
-    std::vector<unsigned char> plaintext(encrypted_data.size() + EVP_CIPHER_CTX_block_size(ctx));
+    // Дешифруем данные прямо в выходную строку из защищенной памяти
+    secure_string plaintext(encrypted_size + EVP_MAX_BLOCK_LENGTH, '\0');
+    unsigned char *out = reinterpret_cast<unsigned char *>(plaintext.data());
     int len = 0;
     int plaintext_len = 0;
 
-    if (EVP_DecryptUpdate(ctx, plaintext.data(), &len, encrypted_data.data(), encrypted_data.size()) != 1) {
-        cleanupCipherContext(ctx);
+    if (EVP_DecryptUpdate(ctx.get(), out, &len, encrypted_data, encrypted_size) != 1) {
         throw std::runtime_error("Failed to decrypt data");
     }
     plaintext_len = len;
 
-    if (EVP_DecryptFinal_ex(ctx, plaintext.data() + len, &len) != 1) {
-        cleanupCipherContext(ctx);
+    if (EVP_DecryptFinal_ex(ctx.get(), out + len, &len) != 1) {
+        IRONVAULT_METRIC_ADD(MetricCounter::DecryptFailures, 1);
         throw std::runtime_error("Failed to finalize decryption - possible wrong password");
     }
     plaintext_len += len;
 
-    cleanupCipherContext(ctx);
+    plaintext.resize(plaintext_len);
+    IRONVAULT_METRIC_ADD(MetricCounter::BytesDecrypted, plaintext_len);
+    return plaintext;
+}
+// Шифрование готовым ключом (encrypt-then-MAC)
+std::string DataEncryption::encryptWithKey(std::string_view plaintext, const unsigned char *key) {
+    if (!key) {
+        throw std::invalid_argument("Key cannot be null");
+    }
+    IRONVAULT_METRIC_TIMER(MetricOperation::Encrypt);
+    IRONVAULT_TRACE_SPAN_ARG("crypto.encrypt_with_key", "bytes", plaintext.size());
+    IRONVAULT_METRIC_ADD(MetricCounter::BytesEncrypted, plaintext.size());
+    CipherContextPool &pool = CipherContextPool::local();
+
+    // Итоговый буфер: IV + зашифрованные данные + MAC
+    std::vector<unsigned char> &result = pool.scratch();
+    result.resize(IV_LENGTH + plaintext.size() + EVP_MAX_BLOCK_LENGTH + MAC_LENGTH);
+    unsigned char *iv = result.data();
+    unsigned char *ciphertext = iv + IV_LENGTH;
+
+    if (RAND_bytes(iv, IV_LENGTH) != 1) {
+        throw std::runtime_error("Failed to generate IV");
+    }
+
+    unsigned char encryption_key[KEY_LENGTH];
+    unsigned char mac_key[KEY_LENGTH];
+    splitKey(key, encryption_key, mac_key);
+
+    CipherContextPool::Handle ctx = pool.acquire();
+    int init_result = EVP_EncryptInit_ex(ctx.get(), pool.getCipher(), nullptr, encryption_key, iv);
+    OPENSSL_cleanse(encryption_key, KEY_LENGTH);
+    if (init_result != 1) {
+        OPENSSL_cleanse(mac_key, KEY_LENGTH);
+        throw std::runtime_error("Failed to initialize encryption");
+    }
+
+    int len = 0;
+    int ciphertext_len = 0;
+    if (EVP_EncryptUpdate(ctx.get(), ciphertext, &len,
+                          reinterpret_cast<const unsigned char *>(plaintext.data()),
+                          plaintext.size()) != 1) {
+        OPENSSL_cleanse(mac_key, KEY_LENGTH);
+        throw std::runtime_error("Failed to encrypt data");
+    }
+    ciphertext_len = len;
+    if (EVP_EncryptFinal_ex(ctx.get(), ciphertext + len, &len) != 1) {
+        OPENSSL_cleanse(mac_key, KEY_LENGTH);
+        throw std::runtime_error("Failed to finalize encryption");
+    }
+    ciphertext_len += len;
+
+    // MAC по IV и шифртексту
+    size_t authenticated_len = IV_LENGTH + ciphertext_len;
+    unsigned int mac_len = 0;
+    unsigned char *mac = HMAC(EVP_sha256(), mac_key, KEY_LENGTH, result.data(), authenticated_len,
+                              result.data() + authenticated_len, &mac_len);
+    OPENSSL_cleanse(mac_key, KEY_LENGTH);
+    if (!mac || mac_len != MAC_LENGTH) {
+        throw std::runtime_error("Failed to authenticate ciphertext");
+    }
 
-    return std::string(plaintext.begin(), plaintext.begin() + plaintext_len);
+    return encodeBase64(result.data(), authenticated_len + MAC_LENGTH);
 }
-// Генерация ключа из пароля с использованием PBKDF2
-std::vector<unsigned char> DataEncryption::deriveKey(const std::string& password, const std::vector<unsigned char>& salt, const std::string& internal_key) {
-    std::vector<unsigned char> key(KEY_LENGTH);
 
-    // Комбинируем пароль с internal_key для усиления безопасности
-    std::string combined_password = password + internal_key;
+// Дешифрование готовым ключом: MAC проверяется до дешифрования
+secure_string DataEncryption::decryptWithKey(std::string_view ciphertext, const unsigned char *key) {
+    if (!key) {
+        throw std::invalid_argument("Key cannot be null");
+    }
+    if (ciphertext.empty()) {
+        throw std::invalid_argument("Ciphertext cannot be empty");
+    }
+    IRONVAULT_METRIC_TIMER(MetricOperation::Decrypt);
+    IRONVAULT_TRACE_SPAN_ARG("crypto.decrypt_with_key", "bytes", ciphertext.size());
+    CipherContextPool &pool = CipherContextPool::local();
 
-    if (PKCS5_PBKDF2_HMAC(combined_password.c_str(), combined_password.length(),
-                          salt.data(), salt.size(),
-                          ITERATIONS,
-                          EVP_sha256(),
-                          KEY_LENGTH, key.data()) != 1) {
-        throw std::runtime_error("Failed to derive key from password");
+    std::vector<unsigned char> &data = pool.scratch();
+    decodeBase64(ciphertext, data);
+    if (data.size() < IV_LENGTH + MAC_LENGTH) {
+        throw std::runtime_error("Invalid ciphertext format");
+    }
+
+    const unsigned char *iv = data.data();
+    const unsigned char *encrypted_data = iv + IV_LENGTH;
+    size_t authenticated_len = data.size() - MAC_LENGTH;
+    size_t encrypted_size = authenticated_len - IV_LENGTH;
+
+    unsigned char encryption_key[KEY_LENGTH];
+    unsigned char mac_key[KEY_LENGTH];
+    splitKey(key, encryption_key, mac_key);
+
+    unsigned char expected_mac[MAC_LENGTH];
+    unsigned int mac_len = 0;
+    unsigned char *mac = HMAC(EVP_sha256(), mac_key, KEY_LENGTH, data.data(), authenticated_len,
+                              expected_mac, &mac_len);
+    OPENSSL_cleanse(mac_key, KEY_LENGTH);
+    if (!mac || mac_len != MAC_LENGTH ||
+        CRYPTO_memcmp(expected_mac, data.data() + authenticated_len, MAC_LENGTH) != 0) {
+        OPENSSL_cleanse(encryption_key, KEY_LENGTH);
+        IRONVAULT_METRIC_ADD(MetricCounter::DecryptFailures, 1);
+        throw std::runtime_error("Authentication failed - wrong key or corrupted data");
+    }
+
+    CipherContextPool::Handle ctx = pool.acquire();
+    int init_result = EVP_DecryptInit_ex(ctx.get(), pool.getCipher(), nullptr, encryption_key, iv);
+    OPENSSL_cleanse(encryption_key, KEY_LENGTH);
+    if (init_result != 1) {
+        throw std::runtime_error("Failed to initialize decryption");
+    }
+
+    secure_string plaintext(encrypted_size + EVP_MAX_BLOCK_LENGTH, '\0');
+    unsigned char *out = reinterpret_cast<unsigned char *>(plaintext.data());
+    int len = 0;
+    int plaintext_len = 0;
+    if (EVP_DecryptUpdate(ctx.get(), out, &len, encrypted_data, encrypted_size) != 1) {
+        throw std::runtime_error("Failed to decrypt data");
+    }
+    plaintext_len = len;
+    if (EVP_DecryptFinal_ex(ctx.get(), out + len, &len) != 1) {
+        IRONVAULT_METRIC_ADD(MetricCounter::DecryptFailures, 1);
+        throw std::runtime_error("Failed to finalize decryption");
+    }
+    plaintext_len += len;
+
+    plaintext.resize(plaintext_len);
+    IRONVAULT_METRIC_ADD(MetricCounter::BytesDecrypted, plaintext_len);
+    return plaintext;
+}
+
+// Случайный ключ данных
+secure_vector<unsigned char> DataEncryption::generateKey() {
+    secure_vector<unsigned char> key(KEY_LENGTH);
+    if (RAND_bytes(key.data(), KEY_LENGTH) != 1) {
+        throw std::runtime_error("Failed to generate key");
+    }
+    return key;
+}
+
+// Раздельные ключи шифрования и MAC из одного ключа
+void DataEncryption::splitKey(const unsigned char *key, unsigned char *encryption_key, unsigned char *mac_key) {
+    static const unsigned char ENCRYPTION_LABEL[] = "ironvault-encryption";
+    static const unsigned char MAC_LABEL[] = "ironvault-mac";
+    unsigned int length = 0;
+    if (!HMAC(EVP_sha256(), key, KEY_LENGTH, ENCRYPTION_LABEL, sizeof(ENCRYPTION_LABEL) - 1,
+              encryption_key, &length) ||
+        !HMAC(EVP_sha256(), key, KEY_LENGTH, MAC_LABEL, sizeof(MAC_LABEL) - 1, mac_key, &length)) {
+        OPENSSL_cleanse(encryption_key, KEY_LENGTH);
+        throw std::runtime_error("Failed to derive subkeys");
     }
+}
 
+// Генерация ключа из пароля с использованием PBKDF2
+secure_vector<unsigned char> DataEncryption::deriveKey(std::string_view password, const std::vector<unsigned char>& salt, std::string_view internal_key) {
+    secure_vector<unsigned char> key(KEY_LENGTH);
+    deriveKeyInto(password, salt.data(), salt.size(), internal_key, key.data());
     return key;
 }
 
+// PBKDF2 в буфер вызывающей стороны (без выделения памяти под ключ)
+void DataEncryption::deriveKeyInto(std::string_view password, const unsigned char *salt, size_t salt_length,
+                                   std::string_view internal_key, unsigned char *key) {
+    IRONVAULT_METRIC_TIMER(MetricOperation::DeriveKey);
+    IRONVAULT_TRACE_SPAN("crypto.derive_key");
+    IRONVAULT_METRIC_ADD(MetricCounter::KdfCalls, 1);
+
+    // Комбинируем пароль с internal_key для усиления безопасности
+    secure_string combined_password;
+    combined_password.reserve(password.size() + internal_key.size());
+    combined_password.append(password);
+    combined_password.append(internal_key);
+
+    int result = PKCS5_PBKDF2_HMAC(combined_password.c_str(), combined_password.length(),
+                                   salt, salt_length,
+                                   ITERATIONS,
+                                   EVP_sha256(),
+                                   KEY_LENGTH, key);
+    if (result != 1) {
+        throw std::runtime_error("Failed to derive key from password");
+    }
+}
+
 // Генерация случайной соли
 std::vector<unsigned char> DataEncryption::generateSalt() {
     std::vector<unsigned char> salt(SALT_LENGTH);
@@ -161,64 +418,73 @@ std::vector<unsigned char> DataEncryption::generateIV() {
     }
     return iv;
 }
-// Создание контекста шифрования
-EVP_CIPHER_CTX* DataEncryption::createCipherContext() {
-    EVP_CIPHER_CTX* ctx = EVP_CIPHER_CTX_new();
-    if (!ctx) {
-        throw std::runtime_error("Failed to create cipher context");
+// SHA-256
+void DataEncryption::sha256(std::string_view data, unsigned char *digest) {
+    unsigned int length = 0;
+    if (EVP_Digest(data.data(), data.size(), digest, &length, EVP_sha256(), nullptr) != 1 ||
+        length != DIGEST_LENGTH) {
+        throw std::runtime_error("Failed to compute SHA-256");
     }
-    return ctx;
 }
 
-// Очистка контекста шифрования
-void DataEncryption::cleanupCipherContext(EVP_CIPHER_CTX* ctx) {
-    if (ctx) {
-        EVP_CIPHER_CTX_free(ctx);
+// Потоковый SHA-256
+DataEncryption::Sha256::Sha256()
+        : ctx(EVP_MD_CTX_new()) {
+    if (!ctx || EVP_DigestInit_ex(ctx, EVP_sha256(), nullptr) != 1) {
+        EVP_MD_CTX_free(ctx);
+        throw std::runtime_error("Failed to initialize SHA-256");
     }
 }
-// Кодирование в Base64
-std::string DataEncryption::encodeBase64(const std::vector<unsigned char>& data) {
-    BIO* b64 = BIO_new(BIO_f_base64());
-    BIO* bio = BIO_new(BIO_s_mem());
-    bio = BIO_push(b64, bio);
 
-    BIO_set_flags(bio, BIO_FLAGS_BASE64_NO_NL);
-    BIO_write(bio, data.data(), data.size());
-    BIO_flush(bio);
+DataEncryption::Sha256::~Sha256() {
+    EVP_MD_CTX_free(ctx);
+}
 
-    BUF_MEM* bufferPtr;
-    BIO_get_mem_ptr(bio, &bufferPtr);
+void DataEncryption::Sha256::update(std::string_view data) {
+    if (EVP_DigestUpdate(ctx, data.data(), data.size()) != 1) {
+        throw std::runtime_error("Failed to compute SHA-256");
+    }
+}
 
-    std::string result(bufferPtr->data, bufferPtr->length);
+void DataEncryption::Sha256::finish(unsigned char *digest) {
+    unsigned int length = 0;
+    if (EVP_DigestFinal_ex(ctx, digest, &length) != 1 || length != DIGEST_LENGTH) {
+        throw std::runtime_error("Failed to compute SHA-256");
+    }
+}
 
-    BIO_free_all(bio);
+// Кодирование в Base64
+std::string DataEncryption::encodeBase64(const unsigned char *data, size_t length) {
+    std::string result(4 * ((length + 2) / 3), '\0');
+    int written = EVP_EncodeBlock(reinterpret_cast<unsigned char *>(result.data()), data, length);
+    if (written < 0) {
+        throw std::runtime_error("Failed to encode Base64 data");
+    }
+    result.resize(written);
     return result;
 }
 
 // Декодирование из Base64
-std::vector<unsigned char> DataEncryption::decodeBase64(const std::string& data) {
-    BIO* b64 = BIO_new(BIO_f_base64());
-    BIO* bio = BIO_new_mem_buf(data.data(), data.length());
-    bio = BIO_push(b64, bio);
-
-    BIO_set_flags(bio, BIO_FLAGS_BASE64_NO_NL);
-
-    std::vector<unsigned char> result(data.length());
-    int length = BIO_read(bio, result.data(), data.length());
-
-    BIO_free_all(bio);
+void DataEncryption::decodeBase64(std::string_view data, std::vector<unsigned char> &out) {
+    if (data.empty() || data.size() % 4 != 0) {
+        throw std::runtime_error("Failed to decode Base64 data");
+    }
 
-    if (length > 0) {
-        result.resize(length);
-    } else {
+    out.resize(3 * (data.size() / 4));
+    int length = EVP_DecodeBlock(out.data(), reinterpret_cast<const unsigned char *>(data.data()), data.size());
+    if (length <= 0) {
         throw std::runtime_error("Failed to decode Base64 data");
     }
 
-    return result;
+    // EVP_DecodeBlock учитывает символы '=' как нулевые байты
+    size_t padding = 0;
+    if (data[data.size() - 1] == '=') padding++;
+    if (data[data.size() - 2] == '=') padding++;
+    out.resize(length - padding);
 }
 
 // Проверка целостности данных
-bool DataEncryption::verifyIntegrity(const std::string& ciphertext, const std::string& password, const std::string& internal_key) {
+bool DataEncryption::verifyIntegrity(std::string_view ciphertext, std::string_view password, std::string_view internal_key) {
     try {
         // Пытаемся расшифровать данные
         decrypt(ciphertext, password, internal_key);
@@ -1,29 +1,63 @@
 #ifndef DATAENCRYPTION_H
 #define DATAENCRYPTION_H
 
+#include <functional>
 #include <string>
+#include <string_view>
 #include <vector>
 #include <openssl/evp.h>
 #include <openssl/rand.h>
+#include "SecureMemory.h"
 
 class DataEncryption {
 private:
-    static const size_t KEY_LENGTH = 32;
     static const size_t IV_LENGTH = 16;
-    static const size_t SALT_LENGTH = 16;
+    static const size_t MAC_LENGTH = 32;
     static const int ITERATIONS = 100000;
 
 public:
-    // Основные методы шифрования/дешифрования
-    static std::string
-    encrypt(const std::string &plaintext, const std::string &password, const std::string &internal_key = "");
+    // Константы
+    static const size_t KEY_LENGTH = 32;
+    static const size_t SALT_LENGTH = 16;
+    static const size_t DIGEST_LENGTH = 32;
 
+    // Основные методы шифрования/дешифрования
     static std::string
-    decrypt(const std::string &ciphertext, const std::string &password, const std::string &internal_key = "");
+    encrypt(std::string_view plaintext, std::string_view password, std::string_view internal_key = "");
+
+    static secure_string
+    decrypt(std::string_view ciphertext, std::string_view password, std::string_view internal_key = "");
+
+    // Элемент пакетного дешифрования: шифртекст encrypt() и internal_key записи
+    struct BatchItem {
+        std::string_view ciphertext;
+        std::string_view internal_key;
+    };
+
+    // Пакетное дешифрование шифртекстов encrypt() одним паролем. У каждого
+    // шифртекста своя соль, поэтому PBKDF2 считается для каждого, но группами
+    // по несколько полос SIMD (Pbkdf2Lanes) на max_threads потоках (0 - по
+    // числу ядер). consumer(i, plaintext) вызывается из рабочего потока;
+    // plaintext == nullptr - шифртекст поврежден или пароль не подходит.
+    // Открытый текст обнуляется сразу после вызова consumer.
+    static void decryptBatch(const std::vector<BatchItem> &items, std::string_view password,
+                             const std::function<void(size_t, const secure_string *)> &consumer,
+                             size_t max_threads = 0);
+
+    // Шифрование готовым ключом KEY_LENGTH байт, без KDF.
+    // Формат: Base64(IV | шифртекст | HMAC-SHA256(IV | шифртекст)), encrypt-then-MAC;
+    // ключи шифрования и MAC выводятся из key через HMAC.
+    static std::string encryptWithKey(std::string_view plaintext, const unsigned char *key);
+
+    // Сначала проверяет MAC, затем дешифрует; при несовпадении бросает исключение
+    static secure_string decryptWithKey(std::string_view ciphertext, const unsigned char *key);
+
+    // Случайный ключ данных
+    static secure_vector<unsigned char> generateKey();
 
     // Генерация ключа пароля
-    static std::vector<unsigned char> deriveKey(const std::string &password, const std::vector<unsigned char> &salt,
-                                                const std::string &internal_key = "");
+    static secure_vector<unsigned char> deriveKey(std::string_view password, const std::vector<unsigned char> &salt,
+                                                  std::string_view internal_key = "");
 
     // Вспомогательные методы
     static std::vector<unsigned char> generateSalt();
@@ -34,20 +68,48 @@ public:
 
     static void cleanupCrypto();
 
+    // SHA-256 в буфер DIGEST_LENGTH байт
+    static void sha256(std::string_view data, unsigned char *digest);
+
+    // Потоковый SHA-256 для данных, поступающих частями
+    class Sha256 {
+    private:
+        EVP_MD_CTX *ctx;
+
+    public:
+        Sha256();
+
+        Sha256(const Sha256 &) = delete;
+
+        Sha256 &operator=(const Sha256 &) = delete;
+
+        ~Sha256();
+
+        void update(std::string_view data);
+
+        void finish(unsigned char *digest);
+    };
+
+    // Base64
+    static std::string encodeBase64(const unsigned char *data, size_t length);
+
+    static void decodeBase64(std::string_view data, std::vector<unsigned char> &out);
+
     // Проверка целостности данных
     static bool
-    verifyIntegrity(const std::string &ciphertext, const std::string &password, const std::string &internal_key = "");
+    verifyIntegrity(std::string_view ciphertext, std::string_view password, std::string_view internal_key = "");
 
 private:
     // Внутренние методы для работы с OpenSSL
-    static EVP_CIPHER_CTX *createCipherContext();
-
-    static void cleanupCipherContext(EVP_CIPHER_CTX *ctx);
+    static void deriveKeyInto(std::string_view password, const unsigned char *salt, size_t salt_length,
+                              std::string_view internal_key, unsigned char *key);
 
-    // Методы для работы с данными
-    static std::string encodeBase64(const std::vector<unsigned char> &data);
+    // AES-256-CBC для decrypt и decryptBatch
+    static secure_string decryptCbc(const unsigned char *key, const unsigned char *iv,
+                                    const unsigned char *encrypted_data, size_t encrypted_size);
 
-    static std::vector<unsigned char> decodeBase64(const std::string &data);
+    // Ключи шифрования и MAC для encryptWithKey
+    static void splitKey(const unsigned char *key, unsigned char *encryption_key, unsigned char *mac_key);
 
     // Константы
     static const std::string CIPHER_ALGORITHM;
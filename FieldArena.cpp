@@ -0,0 +1,172 @@
+#include "FieldArena.h"
+#include <openssl/crypto.h>
+#include <openssl/evp.h>
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+
+// Конструктор
+FieldArena::FieldArena(size_t chunk_size)
+        : chunk_size(chunk_size), used_bytes(0), allocated_bytes(0) {
+    if (chunk_size == 0) {
+        throw std::invalid_argument("Arena chunk size must be positive");
+    }
+}
+
+// Деструктор: данные записей обнуляются перед освобождением
+FieldArena::~FieldArena() {
+    release();
+}
+
+// Копирование строки в арену
+std::string_view FieldArena::store(std::string_view value) {
+    if (value.empty()) {
+        return std::string_view();
+    }
+    char *destination = allocate(value.size());
+    std::memcpy(destination, value.data(), value.size());
+    return std::string_view(destination, value.size());
+}
+
+// Резервирование места: следующие store() попадут в один блок
+void FieldArena::reserve(size_t bytes) {
+    if (!chunks.empty() && chunks.back().capacity - chunks.back().used >= bytes) {
+        return;
+    }
+    addChunk(bytes);
+}
+
+// Выделение участка под параллельное заполнение
+FieldArena::Region FieldArena::carve(size_t bytes) {
+    if (bytes == 0) {
+        return Region();
+    }
+    char *begin = allocate(bytes);
+    return Region(begin, begin + bytes);
+}
+
+// Участок арены
+FieldArena::Region::Region()
+        : next(nullptr), end(nullptr) {}
+
+FieldArena::Region::Region(char *begin, char *end)
+        : next(begin), end(end) {}
+
+std::string_view FieldArena::Region::store(std::string_view value) {
+    if (value.empty()) {
+        return std::string_view();
+    }
+    if (value.size() > remaining()) {
+        throw std::length_error("Arena region is exhausted");
+    }
+    char *destination = next;
+    std::memcpy(destination, value.data(), value.size());
+    next += value.size();
+    return std::string_view(destination, value.size());
+}
+
+FieldArena::Region FieldArena::Region::slice(size_t offset, size_t length) const {
+    if (offset > remaining() || length > remaining() - offset) {
+        throw std::out_of_range("Arena region slice is out of range");
+    }
+    return Region(next + offset, next + offset + length);
+}
+
+size_t FieldArena::Region::remaining() const {
+    return static_cast<size_t>(end - next);
+}
+
+// Обнуление всех блоков
+void FieldArena::wipe() {
+    for (Chunk &chunk: chunks) {
+        OPENSSL_cleanse(chunk.data.get(), chunk.used);
+        chunk.used = 0;
+    }
+    used_bytes = 0;
+}
+
+// Обнуление и освобождение
+void FieldArena::release() {
+    wipe();
+    chunks.clear();
+    allocated_bytes = 0;
+}
+
+// Гамма по блокам: счетчик блока i начинается с i << 64, поэтому
+// диапазоны счетчиков разных блоков не пересекаются
+void FieldArena::applyKeystream(const unsigned char *key) {
+    if (!key) {
+        throw std::invalid_argument("Key cannot be null");
+    }
+    EVP_CIPHER_CTX *ctx = EVP_CIPHER_CTX_new();
+    if (!ctx) {
+        throw std::runtime_error("Failed to create cipher context");
+    }
+    for (size_t i = 0; i < chunks.size(); ++i) {
+        Chunk &chunk = chunks[i];
+        if (chunk.used == 0) {
+            continue;
+        }
+        unsigned char iv[16] = {};
+        for (size_t byte = 0; byte < 8; ++byte) {
+            iv[7 - byte] = static_cast<unsigned char>(static_cast<uint64_t>(i) >> (8 * byte));
+        }
+        if (EVP_EncryptInit_ex(ctx, EVP_aes_256_ctr(), nullptr, key, iv) != 1) {
+            EVP_CIPHER_CTX_free(ctx);
+            throw std::runtime_error("Failed to apply arena keystream");
+        }
+        // EVP принимает длину в int: крупные блоки обрабатываются частями
+        unsigned char *data = reinterpret_cast<unsigned char *>(chunk.data.get());
+        for (size_t offset = 0; offset < chunk.used;) {
+            int part = static_cast<int>(std::min<size_t>(chunk.used - offset, 1u << 30));
+            int len = 0;
+            if (EVP_EncryptUpdate(ctx, data + offset, &len, data + offset, part) != 1) {
+                EVP_CIPHER_CTX_free(ctx);
+                throw std::runtime_error("Failed to apply arena keystream");
+            }
+            offset += static_cast<size_t>(part);
+        }
+    }
+    EVP_CIPHER_CTX_free(ctx);
+}
+
+// Статистика
+size_t FieldArena::getUsedBytes() const {
+    return used_bytes;
+}
+
+size_t FieldArena::getAllocatedBytes() const {
+    return allocated_bytes;
+}
+
+size_t FieldArena::getChunkCount() const {
+    return chunks.size();
+}
+
+// Выделение из текущего блока или нового
+char *FieldArena::allocate(size_t size) {
+    if (chunks.empty() || chunks.back().capacity - chunks.back().used < size) {
+        // После wipe() пустые блоки переиспользуются
+        auto reusable = std::find_if(chunks.begin(), chunks.end(), [size](const Chunk &chunk) {
+            return chunk.used == 0 && chunk.capacity >= size;
+        });
+        if (reusable != chunks.end()) {
+            std::iter_swap(reusable, chunks.end() - 1);
+        } else {
+            addChunk(size);
+        }
+    }
+
+    Chunk &chunk = chunks.back();
+    char *result = chunk.data.get() + chunk.used;
+    chunk.used += size;
+    used_bytes += size;
+    return result;
+}
+
+void FieldArena::addChunk(size_t min_capacity) {
+    size_t capacity = std::max(min_capacity, chunk_size);
+    chunks.push_back(Chunk{std::make_unique<char[]>(capacity), capacity, 0});
+    allocated_bytes += capacity;
+}
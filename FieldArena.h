@@ -0,0 +1,97 @@
+#ifndef IRONVAULT_MANAGER_FIELDARENA_H
+#define IRONVAULT_MANAGER_FIELDARENA_H
+
+#include <cstddef>
+#include <memory>
+#include <string_view>
+#include <vector>
+
+// Bump-арена для строковых полей записей.
+// Поля копируются в крупные блоки и больше не перемещаются, поэтому
+// std::string_view на них остаются действительными, пока жива арена.
+// Освобождение отдельных полей не поддерживается: освобождается или
+// обнуляется вся арена целиком. Арена не потокобезопасна.
+class FieldArena {
+private:
+    struct Chunk {
+        std::unique_ptr<char[]> data;
+        size_t capacity;
+        size_t used;
+    };
+
+    std::vector<Chunk> chunks;
+    size_t chunk_size;
+    size_t used_bytes;
+    size_t allocated_bytes;
+
+public:
+    // Константы
+    static const size_t DEFAULT_CHUNK_SIZE = 64 * 1024;
+
+    // Непрерывный участок, выделенный заранее (carve). Участки и их части
+    // не пересекаются, поэтому разные потоки могут заполнять свои части
+    // одновременно, не трогая саму арену.
+    class Region {
+    private:
+        char *next;
+        char *end;
+
+    public:
+        Region();
+
+        Region(char *begin, char *end);
+
+        // Копирование строки в участок; бросает исключение при нехватке места
+        std::string_view store(std::string_view value);
+
+        // Часть участка [offset, offset + length)
+        Region slice(size_t offset, size_t length) const;
+
+        size_t remaining() const;
+    };
+
+    // Конструкторы
+    explicit FieldArena(size_t chunk_size = DEFAULT_CHUNK_SIZE);
+
+    FieldArena(const FieldArena &) = delete;
+
+    FieldArena &operator=(const FieldArena &) = delete;
+
+    ~FieldArena();
+
+    // Копирование строки в арену
+    std::string_view store(std::string_view value);
+
+    // Резервирование непрерывного места под ожидаемый объем данных
+    void reserve(size_t bytes);
+
+    // Выделение непрерывного участка; неиспользованный остаток участка
+    // считается занятым до обнуления арены
+    Region carve(size_t bytes);
+
+    // Обнуление всех блоков одним проходом (блоки остаются выделенными)
+    void wipe();
+
+    // Обнуление и освобождение всех блоков
+    void release();
+
+    // Наложение гаммы AES-256-CTR на занятые байты всех блоков на месте.
+    // Повторный вызов с тем же ключом возвращает исходные данные; адреса
+    // полей не меняются, поэтому string_view на них остаются действительными.
+    void applyKeystream(const unsigned char *key);
+
+    // Статистика
+    size_t getUsedBytes() const;
+
+    size_t getAllocatedBytes() const;
+
+    size_t getChunkCount() const;
+
+private:
+    char *allocate(size_t size);
+
+    void addChunk(size_t min_capacity);
+};
+
+
+#endif //IRONVAULT_MANAGER_FIELDARENA_H
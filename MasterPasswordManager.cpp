@@ -1,4 +1,5 @@
 #include "MasterPasswordManager.h"
+#include "PasswordVerifier.h"
 #include <openssl/evp.h>
 #include <openssl/kdf.h>
 #include <openssl/rand.h>
@@ -9,6 +10,12 @@
 #include <cctype>
 #include <map>
 #include <cmath>
+#include <mutex>
+
+namespace {
+    std::mutex estimator_mutex;
+    std::shared_ptr<const PasswordStrengthEstimator> strength_estimator;
+}
 
 // Конструктор по умолчанию
 MasterPasswordManager::MasterPasswordManager()
@@ -32,8 +39,7 @@ std::string MasterPasswordManager::hashPassword(const std::string &password) {
         throw std::invalid_argument("Password cannot be empty");
     }
 
-    std::vector<unsigned char> new_salt = generateSalt();
-    return hashWithSalt(password, new_salt);
+    return PasswordVerifier::create(password).encode();
 }
 
 // Проверка пароля
@@ -43,20 +49,8 @@ bool MasterPasswordManager::verifyPassword(const std::string &password, const st
     }
 
     try {
-        // Парсим сохраненный хэш (формат: salt:hash)
-        size_t separator_pos = stored_hash.find(':');
-        if (separator_pos == std::string::npos) {
-            return false;
-        }
-
-        std::string salt_str = stored_hash.substr(0, separator_pos);
-        std::string expected_hash = stored_hash.substr(separator_pos + 1);
-
-        std::vector<unsigned char> salt_vec = stringToVector(salt_str);
-        std::string computed_hash = hashWithSalt(password, salt_vec);
-
-        // Сравнение с постоянным временем для защиты от timing-атак
-        return constantTimeCompare(computed_hash, expected_hash);
+        // Для повторных проверок лучше разобрать хэш один раз через PasswordVerifier::parse
+        return PasswordVerifier::parse(stored_hash).verify(password);
 
     } catch (const std::exception &e) {
         return false;
@@ -93,7 +87,7 @@ void MasterPasswordManager::forceSetNewPassword(const std::string &new_password)
 
     // Генерируем новую соль и хэшируем пароль
     salt = generateSalt();
-    password_hash = hashWithSalt(new_password, salt);
+    password_hash = PasswordVerifier::create(new_password, salt.data()).encode();
 }
 
 // Проверка сложности пароля
@@ -157,6 +151,27 @@ std::string MasterPasswordManager::getPasswordStrengthFeedback(const std::string
     return result;
 }
 
+// Оценка стойкости
+StrengthEstimate MasterPasswordManager::estimateStrength(const std::string &password) {
+    return getStrengthEstimator()->estimate(password);
+}
+
+// Замена оценщика, например на отображенный в память полный словарь
+void MasterPasswordManager::setStrengthEstimator(std::shared_ptr<const PasswordStrengthEstimator> estimator) {
+    std::lock_guard<std::mutex> lock(estimator_mutex);
+    strength_estimator = std::move(estimator);
+}
+
+std::shared_ptr<const PasswordStrengthEstimator> MasterPasswordManager::getStrengthEstimator() {
+    std::lock_guard<std::mutex> lock(estimator_mutex);
+    if (strength_estimator) {
+        return strength_estimator;
+    }
+    // Встроенный оценщик живет до конца программы: владелец не нужен
+    return std::shared_ptr<const PasswordStrengthEstimator>(std::shared_ptr<void>(),
+                                                            &PasswordStrengthEstimator::builtin());
+}
+
 // Геттеры
 std::string MasterPasswordManager::getPasswordHash() const {
     return password_hash;
@@ -283,61 +298,16 @@ bool MasterPasswordManager::hasSpecialChars(const std::string &password) {
 }
 
 bool MasterPasswordManager::hasNoCommonPatterns(const std::string &password) {
-    // Список common passwords и patterns
-    static const std::vector<std::string> COMMON_PATTERNS = {
-            "password", "123456", "qwerty", "admin", "welcome",
-            "monkey", "letmein", "dragon", "baseball", "iloveyou",
-            "trustno1", "sunshine", "master", "hello", "freedom"
-    };
-
-    std::string lower_password = password;
-    std::transform(lower_password.begin(), lower_password.end(), lower_password.begin(), ::tolower);
-
-    for (const auto &pattern: COMMON_PATTERNS) {
-        if (lower_password.find(pattern) != std::string::npos) {
-            return false;
-        }
-    }
-
-    // Проверка на последовательности
-    for (size_t i = 0; i < password.length() - 2; ++i) {
-        if (std::isalpha(password[i]) && std::isalpha(password[i + 1]) && std::isalpha(password[i + 2])) {
-            // Проверка последовательных букв (abc, def, etc.)
-            if (password[i] + 1 == password[i + 1] && password[i + 1] + 1 == password[i + 2]) {
-                return false;
-            }
-        }
-        if (std::isdigit(password[i]) && std::isdigit(password[i + 1]) && std::isdigit(password[i + 2])) {
-            // Проверка последовательных цифр (123, 456, etc.)
-            if (password[i] + 1 == password[i + 1] && password[i + 1] + 1 == password[i + 2]) {
-                return false;
-            }
-        }
-    }
-
-    return true;
+    // Частые пароли, клавиатурные дорожки и последовательности (abc, 123)
+    // ищутся автоматом словаря за один проход
+    return !getStrengthEstimator()->hasCommonPattern(password);
 }
 
-// Расчет энтропии пароля
+// Расчет энтропии пароля: log2 числа попыток с учетом словарных слов,
+// последовательностей, повторов и годов; остальные символы перебираются
+// по алфавиту пароля
 int MasterPasswordManager::calculateEntropy(const std::string &password) {
     if (password.empty()) return 0;
 
-    // Определяем набор символов
-    bool has_upper = hasUppercase(password);
-    bool has_lower = hasLowercase(password);
-    bool has_digit = hasDigits(password);
-    bool has_special = hasSpecialChars(password);
-
-    int charset_size = 0;
-    if (has_upper) charset_size += 26;
-    if (has_lower) charset_size += 26;
-    if (has_digit) charset_size += 10;
-    if (has_special) charset_size += 32; // Примерное количество специальных символов
-
-    if (charset_size == 0) return 0;
-
-    // Энтропия = log2(charset_size) * length
-    double entropy = std::log2(charset_size) * password.length();
-    return static_cast<int>(entropy);
-
-}
\ No newline at end of file
+    return static_cast<int>(estimateStrength(password).log2_guesses);
+}
@@ -1,6 +1,8 @@
 #ifndef IRONVAULT_MANAGER_MASTERPASSWORDMANAGER_H
 #define IRONVAULT_MANAGER_MASTERPASSWORDMANAGER_H
 
+#include "PasswordStrengthEstimator.h"
+#include <memory>
 #include <string>
 #include <vector>
 #include <openssl/evp.h>
@@ -37,6 +39,14 @@ public:
 
     static std::string getPasswordStrengthFeedback(const std::string &password);
 
+    // Оценка по словарю и шаблонам (число попыток подбора, балл 0-4)
+    static StrengthEstimate estimateStrength(const std::string &password);
+
+    // Оценщик для всех проверок; nullptr - встроенный словарь
+    static void setStrengthEstimator(std::shared_ptr<const PasswordStrengthEstimator> estimator);
+
+    static std::shared_ptr<const PasswordStrengthEstimator> getStrengthEstimator();
+
     // Геттеры
     std::string getPasswordHash() const;
 
@@ -0,0 +1,88 @@
+#include "ParallelRunner.h"
+#include "VaultExecutor.h"
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+namespace {
+    // Состояние одного forEach. Помощники из пула держат его через
+    // shared_ptr: помощник, запущенный после возврата forEach, находит
+    // все индексы розданными и к задаче не обращается.
+    struct ForEachState {
+        const std::function<void(size_t)> *task;
+        size_t count;
+        std::atomic<size_t> next{0};
+        std::mutex mutex;
+        std::condition_variable idle;
+        size_t running = 0; // помощники внутри цикла раздачи
+        std::exception_ptr error;
+
+        void work() {
+            for (size_t i = next.fetch_add(1); i < count; i = next.fetch_add(1)) {
+                try {
+                    (*task)(i);
+                } catch (...) {
+                    std::lock_guard<std::mutex> lock(mutex);
+                    if (!error) {
+                        error = std::current_exception();
+                    }
+                    next.store(count);
+                }
+            }
+        }
+
+        void help() {
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                ++running;
+            }
+            work();
+            std::lock_guard<std::mutex> lock(mutex);
+            if (--running == 0) {
+                idle.notify_all();
+            }
+        }
+    };
+}
+
+size_t ParallelRunner::defaultThreadCount() {
+    return std::max(1u, std::thread::hardware_concurrency());
+}
+
+// Выполнение task(i) для i из [0, count). Вызывающий поток раздает индексы
+// наравне с помощниками и ждет только тех, кто уже взял индекс, поэтому
+// вложенный вызов из потока пула не ждет занятый пул
+void ParallelRunner::forEach(size_t count, size_t max_threads, const std::function<void(size_t)> &task) {
+    size_t thread_count = std::min(count, max_threads ? max_threads : defaultThreadCount());
+    if (thread_count <= 1) {
+        for (size_t i = 0; i < count; ++i) {
+            task(i);
+        }
+        return;
+    }
+
+    auto state = std::make_shared<ForEachState>();
+    state->task = &task;
+    state->count = count;
+    std::shared_ptr<VaultExecutor> executor = VaultExecutor::shared();
+    for (size_t t = 1; t < thread_count; ++t) {
+        try {
+            executor->execute(VaultWork::Cpu, [state] { state->help(); });
+        } catch (...) {
+            // Пул останавливается: оставшееся выполнят уже запущенные потоки
+            break;
+        }
+    }
+    state->work();
+    {
+        std::unique_lock<std::mutex> lock(state->mutex);
+        state->idle.wait(lock, [&state] { return state->running == 0; });
+    }
+    if (state->error) {
+        std::rethrow_exception(state->error);
+    }
+}
@@ -0,0 +1,28 @@
+#ifndef IRONVAULT_MANAGER_PARALLELRUNNER_H
+#define IRONVAULT_MANAGER_PARALLELRUNNER_H
+
+#include <cstddef>
+#include <functional>
+
+// Выполнение независимых задач на ограниченном числе потоков.
+// Индексы раздаются через атомарный счетчик, так что неравные по времени
+// задачи распределяются сами; вызывающий поток работает наравне с остальными.
+// Помощники берутся из пула Cpu общего VaultExecutor, а не создаются на
+// каждый вызов: потоков не больше, чем ядер, плюс вызывающие, а их
+// thread_local-кэши (контексты шифра, кольца ввода-вывода, шарды метрик)
+// живут между вызовами. Если пул занят, задачи выполняют те, кто свободен,
+// в худшем случае - один вызывающий поток.
+class ParallelRunner {
+public:
+    // Число потоков по умолчанию: по числу ядер
+    static size_t defaultThreadCount();
+
+    // task(i) для i из [0, count); max_threads == 0 - по числу ядер
+    // (включая вызывающий поток; сверх размера пула не добавляет потоков).
+    // Первое исключение из задачи останавливает раздачу новых индексов
+    // и пробрасывается после завершения всех потоков.
+    static void forEach(size_t count, size_t max_threads, const std::function<void(size_t)> &task);
+};
+
+
+#endif //IRONVAULT_MANAGER_PARALLELRUNNER_H
@@ -1,5 +1,6 @@
 #include "iostream"
 #include "PasswordGenerator.h"
+#include "VaultMetrics.h"
 #include "stdexcept"
 
 PasswordGenerator::PasswordGenerator(int len, bool uppercase, bool lowercase,
@@ -18,14 +19,16 @@ PasswordGenerator::PasswordGenerator(int len, bool uppercase, bool lowercase,
 }
 
 // Основной метод генерации пароля
-std::string PasswordGenerator::generate() {
+secure_string PasswordGenerator::generate() {
+    IRONVAULT_METRIC_TIMER(MetricOperation::GeneratePassword);
     validateSettings();
     std::string available_chars = getAllAvailableChars();
     if (available_chars.empty()) {
         throw std::runtime_error("No character sets selected"
                                  " for password generation");
     }
-    std::string password;
+    secure_string password;
+    password.reserve(length);
     std::uniform_int_distribution<int> dist(0, available_chars.size() - 1);
 
     for (int i = 0; i < length; ++i) {
@@ -91,6 +94,16 @@ std::string PasswordGenerator::getSpecialCharsSet() const {
     return "!@#$%^&*()_+-=[]{}|;:,.<>?";
 }
 
+// Все символы включенных наборов
+std::string PasswordGenerator::getAllAvailableChars() const {
+    std::string chars;
+    if (use_uppercase) chars += getUpperChars();
+    if (use_lowercase) chars += getLowercaseChars();
+    if (use_digits) chars += getDigitChars();
+    if (use_special_chars) chars += getSpecialCharsSet();
+    return chars;
+}
+
 void PasswordGenerator::validateSettings() const {
     if (length <= 0) {
         throw std::invalid_argument("Password length must be positive");
@@ -3,6 +3,7 @@
 
 #include "string"
 #include <random>
+#include "SecureMemory.h"
 
 class PasswordGenerator {
 private:
@@ -20,7 +21,7 @@ public:
                       bool digits = true,
                       bool special = false);
 
-    std::string generate();
+    secure_string generate();
 
     // Настройка параметров
     void setLength(int len);
@@ -0,0 +1,595 @@
+#include "PasswordStrengthEstimator.h"
+#include "VaultTrace.h"
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <cstring>
+#include <ctime>
+#include <fstream>
+#include <limits>
+#include <sstream>
+#include <stdexcept>
+
+#ifdef _WIN32
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace {
+    // Заголовок образа: magic, версия, число узлов, ребер и слов, резерв
+    const size_t HEADER_WORDS = 8;
+    const size_t HEADER_SIZE = HEADER_WORDS * sizeof(uint32_t);
+
+    // Нижняя граница попыток для одного фрагмента, как в zxcvbn
+    const double MIN_MATCH_GUESSES = 50.0;
+    // Минимальный разброс для годов
+    const int MIN_YEAR_SPACE = 20;
+
+    // Встроенный словарь: самые частые пароли в порядке убывания частоты,
+    // затем клавиатурные дорожки. Полный словарь загружается через mapImage.
+    const char *const BUILTIN_WORDS[] = {
+            "123456", "password", "12345678", "qwerty", "123456789", "12345", "1234", "111111",
+            "1234567", "dragon", "123123", "baseball", "abc123", "football", "monkey", "letmein",
+            "696969", "shadow", "master", "666666", "qwertyuiop", "123321", "mustang", "1234567890",
+            "michael", "654321", "superman", "1qaz2wsx", "7777777", "121212", "000000", "qazwsx",
+            "123qwe", "killer", "trustno1", "jordan", "jennifer", "zxcvbnm", "asdfgh", "hunter",
+            "buster", "soccer", "harley", "batman", "andrew", "tigger", "sunshine", "iloveyou",
+            "2000", "charlie", "robert", "thomas", "hockey", "ranger", "daniel", "starwars",
+            "112233", "george", "computer", "michelle", "jessica", "pepper", "1111",
+            "zxcvbn", "555555", "11111111", "131313", "freedom", "777777", "pass", "maggie",
+            "159753", "aaaaaa", "ginger", "princess", "joshua", "cheese", "amanda", "summer",
+            "love", "ashley", "nicole", "chelsea", "biteme", "matthew", "access", "yankees",
+            "987654321", "dallas", "austin", "thunder", "taylor", "matrix", "admin", "welcome",
+            "hello", "login", "passw0rd", "password1", "qwerty123", "secret", "whatever", "flower",
+            "hottie", "lovely", "zaq12wsx", "internet", "samsung", "google", "azerty",
+            "letmein1", "changeme", "default", "root", "toor", "guest", "test", "administrator",
+            // Клавиатурные дорожки
+            "asdfghjkl", "1q2w3e4r", "1q2w3e", "q1w2e3r4", "qweasd",
+            "qweasdzxc", "asdf", "zxcv", "qwer", "poiuyt", "lkjhgf", "mnbvcx", "1qazxsw2",
+            "zaq1xsw2", "!qaz2wsx", "qazxsw", "wasd", "asdasd", "qweqwe", "ytrewq", "0987654321"
+    };
+
+    unsigned char lowerAscii(unsigned char c) {
+        return (c >= 'A' && c <= 'Z') ? static_cast<unsigned char>(c - 'A' + 'a') : c;
+    }
+
+    // Обратная замена "l33t": 4 -> a, 3 -> e, 0 -> o и т.д.
+    unsigned char unleet(unsigned char c) {
+        switch (c) {
+            case '4':
+            case '@':
+                return 'a';
+            case '3':
+                return 'e';
+            case '1':
+            case '!':
+                return 'i';
+            case '0':
+                return 'o';
+            case '$':
+            case '5':
+                return 's';
+            case '7':
+            case '+':
+                return 't';
+            case '|':
+                return 'l';
+            case '8':
+                return 'b';
+            default:
+                return lowerAscii(c);
+        }
+    }
+
+    // Класс символа для последовательностей и повторов
+    int charClass(unsigned char c) {
+        if (c >= 'a' && c <= 'z') return 0;
+        if (c >= 'A' && c <= 'Z') return 1;
+        if (c >= '0' && c <= '9') return 2;
+        return 3;
+    }
+
+    // Мощность класса: строчные, прописные, цифры, прочие
+    const int CLASS_CARDINALITY[] = {26, 26, 10, 32};
+
+    int classCardinality(unsigned char c) {
+        return CLASS_CARDINALITY[charClass(c)];
+    }
+
+    double binomial(unsigned n, unsigned k) {
+        if (k > n) return 0;
+        double result = 1;
+        for (unsigned i = 1; i <= k; ++i) {
+            result = result * (n - k + i) / i;
+        }
+        return result;
+    }
+
+    int currentYear() {
+        std::time_t now = std::time(nullptr);
+        std::tm parts{};
+#ifdef _WIN32
+        gmtime_s(&parts, &now);
+#else
+        gmtime_r(&now, &parts);
+#endif
+        return parts.tm_year + 1900;
+    }
+
+    // Временный trie для построения автомата
+    struct BuildNode {
+        std::vector<std::pair<unsigned char, uint32_t>> children;
+        uint32_t rank = 0;
+        uint32_t depth = 0;
+    };
+}
+
+// Пустой автомат: только корень
+PasswordStrengthEstimator::PasswordStrengthEstimator()
+        : nodes(nullptr), edge_targets(nullptr), edge_labels(nullptr),
+          node_count(0), edge_count(0), word_count(0) {}
+
+// Встроенный словарь
+const PasswordStrengthEstimator &PasswordStrengthEstimator::builtin() {
+    static const PasswordStrengthEstimator instance = fromWordList(
+            std::vector<std::string>(std::begin(BUILTIN_WORDS), std::end(BUILTIN_WORDS)));
+    return instance;
+}
+
+// Построение автомата: trie по словам, перенумерация в порядке обхода в
+// ширину (ребра узла становятся непрерывными), затем суффиксные ссылки
+PasswordStrengthEstimator PasswordStrengthEstimator::fromWordList(const std::vector<std::string> &words) {
+    IRONVAULT_TRACE_SPAN_ARG("strength.build", "words", words.size());
+    std::vector<BuildNode> trie(1);
+    uint32_t words_added = 0;
+
+    for (const auto &word: words) {
+        if (word.size() < MIN_WORD_LENGTH) {
+            continue;
+        }
+        uint32_t node = 0;
+        for (unsigned char c: word) {
+            c = lowerAscii(c);
+            auto &children = trie[node].children;
+            auto it = std::find_if(children.begin(), children.end(),
+                                   [c](const auto &child) { return child.first == c; });
+            if (it != children.end()) {
+                node = it->second;
+                continue;
+            }
+            uint32_t child = static_cast<uint32_t>(trie.size());
+            if (child == NONE) {
+                throw std::runtime_error("Dictionary is too large");
+            }
+            uint32_t depth = trie[node].depth + 1;
+            children.emplace_back(c, child);
+            trie.emplace_back();
+            trie.back().depth = depth;
+            node = child;
+        }
+        // Повтор слова сохраняет первый (меньший) ранг
+        if (trie[node].rank == 0) {
+            trie[node].rank = ++words_added;
+        }
+    }
+
+    // Плоский образ: заголовок, узлы (+ ограничитель), цели ребер, метки ребер
+    uint32_t nodes_total = static_cast<uint32_t>(trie.size());
+    uint32_t edges_total = nodes_total - 1;
+    size_t image_size = HEADER_SIZE + (nodes_total + 1) * sizeof(Node) + edges_total * sizeof(uint32_t) + edges_total;
+    auto buffer = std::make_shared<std::vector<uint32_t>>((image_size + sizeof(uint32_t) - 1) / sizeof(uint32_t));
+    unsigned char *base = reinterpret_cast<unsigned char *>(buffer->data());
+
+    Node *out_nodes = reinterpret_cast<Node *>(base + HEADER_SIZE);
+    uint32_t *out_targets = reinterpret_cast<uint32_t *>(out_nodes + nodes_total + 1);
+    unsigned char *out_labels = reinterpret_cast<unsigned char *>(out_targets + edges_total);
+
+    std::vector<uint32_t> order; // новый номер -> старый
+    order.reserve(nodes_total);
+    order.push_back(0);
+    uint32_t edge = 0;
+    for (uint32_t id = 0; id < order.size(); ++id) {
+        BuildNode &node = trie[order[id]];
+        std::sort(node.children.begin(), node.children.end());
+        out_nodes[id] = Node{edge, 0, node.rank, node.depth, NONE};
+        for (const auto &[label, child]: node.children) {
+            out_labels[edge] = label;
+            out_targets[edge] = static_cast<uint32_t>(order.size());
+            order.push_back(child);
+            ++edge;
+        }
+        std::vector<std::pair<unsigned char, uint32_t>>().swap(node.children);
+    }
+    out_nodes[nodes_total] = Node{edge, 0, 0, 0, NONE};
+
+    uint32_t *header = buffer->data();
+    header[0] = IMAGE_MAGIC;
+    header[1] = IMAGE_VERSION;
+    header[2] = nodes_total;
+    header[3] = edges_total;
+    header[4] = words_added;
+
+    PasswordStrengthEstimator estimator;
+    estimator.bindStorage(std::shared_ptr<const void>(buffer, buffer->data()), image_size);
+
+    // Суффиксные ссылки по уровням: родитель обработан раньше ребенка
+    for (uint32_t id = 0; id < nodes_total; ++id) {
+        for (uint32_t e = out_nodes[id].first_edge; e < out_nodes[id + 1].first_edge; ++e) {
+            uint32_t child = out_targets[e];
+            uint32_t fail = 0;
+            if (id != 0) {
+                fail = estimator.nextState(out_nodes[id].fail, out_labels[e]);
+            }
+            out_nodes[child].fail = fail;
+            out_nodes[child].dict_link = out_nodes[fail].rank ? fail : out_nodes[fail].dict_link;
+        }
+    }
+    return estimator;
+}
+
+// Список слов из потока: первое слово строки, самые частые первыми
+PasswordStrengthEstimator PasswordStrengthEstimator::fromWordList(std::istream &input) {
+    std::vector<std::string> words;
+    std::string line;
+    while (std::getline(input, line)) {
+        std::istringstream line_stream(line);
+        std::string word;
+        if (line_stream >> word) {
+            words.push_back(std::move(word));
+        }
+    }
+    return fromWordList(words);
+}
+
+// Сохранение образа (в порядке байтов этой машины)
+void PasswordStrengthEstimator::saveImage(const std::string &file_path) const {
+    size_t image_size = HEADER_SIZE + (node_count + 1) * sizeof(Node) + edge_count * sizeof(uint32_t) + edge_count;
+    std::ofstream file(file_path, std::ios::binary | std::ios::trunc);
+    if (!file.is_open()) {
+        throw std::runtime_error("Failed to open file for writing: " + file_path);
+    }
+    file.write(static_cast<const char *>(storage.get()), static_cast<std::streamsize>(image_size));
+    if (!file) {
+        throw std::runtime_error("Failed to write file: " + file_path);
+    }
+}
+
+// Отображение образа в память только для чтения
+PasswordStrengthEstimator PasswordStrengthEstimator::mapImage(const std::string &file_path) {
+    IRONVAULT_TRACE_SPAN("strength.map_image");
+    PasswordStrengthEstimator estimator;
+#ifdef _WIN32
+    std::ifstream file(file_path, std::ios::binary);
+    if (!file.is_open()) {
+        throw std::runtime_error("Failed to open dictionary image: " + file_path);
+    }
+    std::stringstream content;
+    content << file.rdbuf();
+    std::string data = content.str();
+    auto buffer = std::make_shared<std::vector<uint32_t>>((data.size() + sizeof(uint32_t) - 1) / sizeof(uint32_t));
+    std::memcpy(buffer->data(), data.data(), data.size());
+    estimator.bindStorage(std::shared_ptr<const void>(buffer, buffer->data()), data.size());
+#else
+    int fd = open(file_path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        throw std::runtime_error("Failed to open dictionary image: " + file_path);
+    }
+    struct stat info{};
+    if (fstat(fd, &info) != 0 || info.st_size < static_cast<off_t>(HEADER_SIZE)) {
+        close(fd);
+        throw std::runtime_error("Invalid dictionary image: " + file_path);
+    }
+    size_t size = static_cast<size_t>(info.st_size);
+    void *region = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (region == MAP_FAILED) {
+        throw std::runtime_error("Failed to map dictionary image: " + file_path);
+    }
+    std::shared_ptr<const void> mapping(region, [size](const void *address) {
+        munmap(const_cast<void *>(address), size);
+    });
+    estimator.bindStorage(std::move(mapping), size);
+#endif
+    return estimator;
+}
+
+// Привязка массивов к образу с проверкой: поврежденный файл не должен
+// приводить к чтению за пределами отображения
+void PasswordStrengthEstimator::bindStorage(std::shared_ptr<const void> memory, size_t size) {
+    const unsigned char *base = static_cast<const unsigned char *>(memory.get());
+    if (size < HEADER_SIZE) {
+        throw std::runtime_error("Invalid dictionary image");
+    }
+    uint32_t header[HEADER_WORDS];
+    std::memcpy(header, base, HEADER_SIZE);
+    if (header[0] != IMAGE_MAGIC || header[1] != IMAGE_VERSION) {
+        throw std::runtime_error("Unsupported dictionary image");
+    }
+    uint64_t nodes_total = header[2];
+    uint64_t edges_total = header[3];
+    uint64_t expected = HEADER_SIZE + (nodes_total + 1) * sizeof(Node) + edges_total * sizeof(uint32_t) + edges_total;
+    if (nodes_total == 0 || nodes_total >= NONE || edges_total != nodes_total - 1 || size < expected) {
+        throw std::runtime_error("Dictionary image is truncated or corrupted");
+    }
+
+    const Node *image_nodes = reinterpret_cast<const Node *>(base + HEADER_SIZE);
+    const uint32_t *image_targets = reinterpret_cast<const uint32_t *>(image_nodes + nodes_total + 1);
+    for (uint64_t i = 0; i < nodes_total; ++i) {
+        const Node &node = image_nodes[i];
+        if (node.first_edge > image_nodes[i + 1].first_edge || node.fail >= nodes_total ||
+            (node.dict_link != NONE && node.dict_link >= nodes_total)) {
+            throw std::runtime_error("Dictionary image is corrupted");
+        }
+    }
+    if (image_nodes[nodes_total].first_edge != edges_total) {
+        throw std::runtime_error("Dictionary image is corrupted");
+    }
+    for (uint64_t e = 0; e < edges_total; ++e) {
+        if (image_targets[e] == 0 || image_targets[e] >= nodes_total) {
+            throw std::runtime_error("Dictionary image is corrupted");
+        }
+    }
+
+    storage = std::move(memory);
+    nodes = image_nodes;
+    edge_targets = image_targets;
+    edge_labels = reinterpret_cast<const unsigned char *>(image_targets + edges_total);
+    node_count = static_cast<uint32_t>(nodes_total);
+    edge_count = static_cast<uint32_t>(edges_total);
+    word_count = header[4];
+}
+
+// Переход автомата по символу с откатом по суффиксным ссылкам
+uint32_t PasswordStrengthEstimator::nextState(uint32_t state, unsigned char c) const {
+    while (true) {
+        const unsigned char *begin = edge_labels + nodes[state].first_edge;
+        const unsigned char *end = edge_labels + nodes[state + 1].first_edge;
+        const unsigned char *found = std::lower_bound(begin, end, c);
+        if (found != end && *found == c) {
+            return edge_targets[found - edge_labels];
+        }
+        if (state == 0) {
+            return 0;
+        }
+        state = nodes[state].fail;
+    }
+}
+
+// Оценка: минимальное число попыток по всем разбиениям пароля.
+// Каждый символ вне фрагментов перебирается по алфавиту пароля.
+StrengthEstimate PasswordStrengthEstimator::estimate(std::string_view password) const {
+    StrengthEstimate result{1.0, 0.0, 0, {}};
+    if (password.empty()) {
+        return result;
+    }
+
+    std::vector<StrengthMatch> matches = findMatches(password);
+    std::sort(matches.begin(), matches.end(), [](const StrengthMatch &a, const StrengthMatch &b) {
+        return a.end < b.end;
+    });
+
+    // Динамика в log10: best[i] - лучший префикс длины i
+    const double char_cost = std::log10(static_cast<double>(charsetSize(password)));
+    std::vector<double> best(password.size() + 1, 0.0);
+    std::vector<ptrdiff_t> choice(password.size() + 1, -1);
+    size_t next_match = 0;
+    for (size_t i = 1; i <= password.size(); ++i) {
+        best[i] = best[i - 1] + char_cost;
+        choice[i] = -1;
+        for (; next_match < matches.size() && matches[next_match].end == i; ++next_match) {
+            const StrengthMatch &match = matches[next_match];
+            double cost = best[match.begin] + std::log10(std::max(match.guesses, MIN_MATCH_GUESSES));
+            if (cost < best[i]) {
+                best[i] = cost;
+                choice[i] = static_cast<ptrdiff_t>(next_match);
+            }
+        }
+    }
+
+    for (size_t i = password.size(); i > 0;) {
+        if (choice[i] < 0) {
+            --i;
+            continue;
+        }
+        const StrengthMatch &match = matches[static_cast<size_t>(choice[i])];
+        result.matches.push_back(match);
+        i = match.begin;
+    }
+    std::reverse(result.matches.begin(), result.matches.end());
+
+    double log10_guesses = best[password.size()];
+    result.guesses = std::pow(10.0, std::min(log10_guesses, static_cast<double>(std::numeric_limits<double>::max_exponent10)));
+    result.log2_guesses = log10_guesses * std::log2(10.0);
+    result.score = scoreForGuesses(result.guesses);
+    return result;
+}
+
+// Все фрагменты: словарь (как есть и после обратной замены l33t),
+// последовательности, повторы, годы
+std::vector<StrengthMatch> PasswordStrengthEstimator::findMatches(std::string_view password) const {
+    std::vector<StrengthMatch> matches;
+    std::string text(password.size(), '\0');
+    bool has_leet = false;
+    for (size_t i = 0; i < password.size(); ++i) {
+        unsigned char c = static_cast<unsigned char>(password[i]);
+        text[i] = static_cast<char>(lowerAscii(c));
+        has_leet = has_leet || unleet(c) != lowerAscii(c);
+    }
+    findDictionaryMatches(text, password, false, matches);
+    if (has_leet) {
+        for (size_t i = 0; i < password.size(); ++i) {
+            text[i] = static_cast<char>(unleet(static_cast<unsigned char>(password[i])));
+        }
+        findDictionaryMatches(text, password, true, matches);
+    }
+    findSequenceMatches(password, matches);
+    findRepeatMatches(password, matches);
+    findYearMatches(password, matches);
+    return matches;
+}
+
+// Частое слово или последовательность
+bool PasswordStrengthEstimator::hasCommonPattern(std::string_view password, size_t min_length) const {
+    for (const auto &match: findMatches(password)) {
+        if (match.kind == StrengthMatch::Kind::Sequence) {
+            return true;
+        }
+        if (match.kind == StrengthMatch::Kind::Dictionary && match.rank <= COMMON_RANK_LIMIT &&
+            match.end - match.begin >= min_length) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// Геттеры
+uint32_t PasswordStrengthEstimator::getWordCount() const {
+    return word_count;
+}
+
+uint32_t PasswordStrengthEstimator::getNodeCount() const {
+    return node_count;
+}
+
+// Пороги zxcvbn
+int PasswordStrengthEstimator::scoreForGuesses(double guesses) {
+    if (guesses < 1e3 + 5) return 0;
+    if (guesses < 1e6 + 5) return 1;
+    if (guesses < 1e8 + 5) return 2;
+    if (guesses < 1e10 + 5) return 3;
+    return 4;
+}
+
+int PasswordStrengthEstimator::charsetSize(std::string_view password) {
+    bool present[4] = {false, false, false, false};
+    for (unsigned char c: password) {
+        if (!std::isspace(c)) {
+            present[charClass(c)] = true;
+        }
+    }
+    int size = 0;
+    for (int cls = 0; cls < 4; ++cls) {
+        if (present[cls]) {
+            size += CLASS_CARDINALITY[cls];
+        }
+    }
+    return std::max(size, 1);
+}
+
+// Один проход автомата по тексту; substituted - текст после обратной замены l33t
+void PasswordStrengthEstimator::findDictionaryMatches(std::string_view text, std::string_view original,
+                                                      bool substituted, std::vector<StrengthMatch> &out) const {
+    uint32_t state = 0;
+    for (size_t i = 0; i < text.size(); ++i) {
+        state = nextState(state, static_cast<unsigned char>(text[i]));
+        for (uint32_t node = nodes[state].rank ? state : nodes[state].dict_link;
+             node != NONE; node = nodes[node].dict_link) {
+            size_t begin = i + 1 - nodes[node].depth;
+            std::string_view word = original.substr(begin, nodes[node].depth);
+
+            double guesses = nodes[node].rank * uppercaseVariations(word);
+            if (substituted) {
+                // Совпадения без замен уже найдены первым проходом
+                unsigned substitutions = 0;
+                for (size_t j = begin; j <= i; ++j) {
+                    substitutions += lowerAscii(static_cast<unsigned char>(original[j])) !=
+                                     static_cast<unsigned char>(text[j]);
+                }
+                if (substitutions == 0) {
+                    continue;
+                }
+                guesses *= std::pow(2.0, substitutions);
+            }
+            out.push_back(StrengthMatch{StrengthMatch::Kind::Dictionary, begin, i + 1, guesses, nodes[node].rank});
+        }
+    }
+}
+
+// Последовательности длиной от 3 с шагом +1 или -1 внутри одного класса символов
+void PasswordStrengthEstimator::findSequenceMatches(std::string_view password, std::vector<StrengthMatch> &out) {
+    size_t i = 0;
+    while (i + 2 < password.size()) {
+        unsigned char first = static_cast<unsigned char>(password[i]);
+        int delta = static_cast<unsigned char>(password[i + 1]) - first;
+        size_t end = i + 1;
+        if ((delta == 1 || delta == -1) && charClass(first) != 3) {
+            while (end < password.size() &&
+                   static_cast<unsigned char>(password[end]) - static_cast<unsigned char>(password[end - 1]) == delta &&
+                   charClass(static_cast<unsigned char>(password[end])) == charClass(first)) {
+                ++end;
+            }
+        }
+        if (end - i >= 3) {
+            double base = std::strchr("aAzZ019", first) ? 4 : charClass(first) == 2 ? 10 : 26;
+            if (delta < 0) {
+                base *= 2;
+            }
+            out.push_back(StrengthMatch{StrengthMatch::Kind::Sequence, i, end, base * (end - i), 0});
+            i = end - 1;
+        } else {
+            ++i;
+        }
+    }
+}
+
+// Повторы одного символа длиной от 3
+void PasswordStrengthEstimator::findRepeatMatches(std::string_view password, std::vector<StrengthMatch> &out) {
+    size_t i = 0;
+    while (i < password.size()) {
+        size_t end = i + 1;
+        while (end < password.size() && password[end] == password[i]) {
+            ++end;
+        }
+        if (end - i >= 3) {
+            double guesses = static_cast<double>(classCardinality(static_cast<unsigned char>(password[i]))) * (end - i);
+            out.push_back(StrengthMatch{StrengthMatch::Kind::Repeat, i, end, guesses, 0});
+        }
+        i = end;
+    }
+}
+
+// Годы 1900-2099: попыток столько, сколько лет до текущего (не меньше 20)
+void PasswordStrengthEstimator::findYearMatches(std::string_view password, std::vector<StrengthMatch> &out) {
+    static const int reference_year = currentYear();
+    for (size_t i = 0; i + 4 <= password.size(); ++i) {
+        std::string_view candidate = password.substr(i, 4);
+        if (!std::all_of(candidate.begin(), candidate.end(), [](char c) { return c >= '0' && c <= '9'; })) {
+            continue;
+        }
+        if (candidate.substr(0, 2) != "19" && candidate.substr(0, 2) != "20") {
+            continue;
+        }
+        int year = std::stoi(std::string(candidate));
+        double guesses = std::max(std::abs(year - reference_year), MIN_YEAR_SPACE);
+        out.push_back(StrengthMatch{StrengthMatch::Kind::Year, i, i + 4, guesses, 0});
+    }
+}
+
+// Варианты регистра слова: Password, PASSWORD - 2, смешанный - по числу сочетаний
+double PasswordStrengthEstimator::uppercaseVariations(std::string_view word) {
+    unsigned upper = 0;
+    unsigned lower = 0;
+    for (unsigned char c: word) {
+        upper += c >= 'A' && c <= 'Z';
+        lower += c >= 'a' && c <= 'z';
+    }
+    if (upper == 0) {
+        return 1;
+    }
+    if (lower == 0) {
+        return 2;
+    }
+    bool edge_only = upper == 1 && (std::isupper(static_cast<unsigned char>(word.front())) ||
+                                    std::isupper(static_cast<unsigned char>(word.back())));
+    if (edge_only) {
+        return 2;
+    }
+    double variations = 0;
+    for (unsigned k = 1; k <= std::min(upper, lower); ++k) {
+        variations += binomial(upper + lower, k);
+    }
+    return variations;
+}
@@ -0,0 +1,128 @@
+#ifndef IRONVAULT_MANAGER_PASSWORDSTRENGTHESTIMATOR_H
+#define IRONVAULT_MANAGER_PASSWORDSTRENGTHESTIMATOR_H
+
+#include <cstdint>
+#include <istream>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Фрагмент пароля, распознанный как предсказуемый
+struct StrengthMatch {
+    enum class Kind {
+        Dictionary, // слово из словаря (частый пароль, клавиатурная дорожка)
+        Sequence,   // abc, 987
+        Repeat,     // aaa
+        Year        // 1900-2099
+    };
+
+    Kind kind;
+    size_t begin;
+    size_t end;       // не включая
+    double guesses;   // число попыток перебора для фрагмента
+    uint32_t rank;    // ранг слова в словаре (1 - самое частое), иначе 0
+};
+
+// Оценка пароля
+struct StrengthEstimate {
+    double guesses;       // ожидаемое число попыток подбора
+    double log2_guesses;  // то же в битах
+    int score;            // 0 (очень слабый) - 4 (сильный)
+    std::vector<StrengthMatch> matches; // фрагменты лучшего разбиения
+};
+
+// Оценка стойкости паролей в духе zxcvbn.
+// Словарь (частые пароли в порядке убывания частоты и клавиатурные дорожки)
+// хранится как автомат Ахо-Корасик в плоских массивах: все вхождения слов
+// находятся за один проход по паролю. Автомат можно сохранить в файл-образ
+// и затем отобразить в память (mmap) без разбора и выделений - словарь из
+// миллионов слов загружается мгновенно и делится между процессами.
+// Оценка - минимальное число попыток по всем разбиениям пароля на
+// распознанные фрагменты и перебираемые символы. Объект неизменяем после
+// построения, поэтому безопасен для одновременного использования.
+class PasswordStrengthEstimator {
+private:
+    // Узел автомата; узлы идут в порядке обхода в ширину, ребра узла
+    // занимают [first_edge, следующий.first_edge) и отсортированы по символу
+    struct Node {
+        uint32_t first_edge;
+        uint32_t fail;      // суффиксная ссылка
+        uint32_t rank;      // ранг слова, оканчивающегося в узле (0 - нет)
+        uint32_t depth;     // длина строки узла
+        uint32_t dict_link; // ближайший узел со словом по цепочке fail (NONE - нет)
+    };
+
+    std::shared_ptr<const void> storage; // владеет памятью массивов (вектор или отображение)
+    const Node *nodes;
+    const uint32_t *edge_targets;
+    const unsigned char *edge_labels;
+    uint32_t node_count;
+    uint32_t edge_count;
+    uint32_t word_count;
+
+    // Константы
+    static const uint32_t IMAGE_MAGIC = 0x45535649; // "IVSE"
+    static const uint32_t IMAGE_VERSION = 1;
+    static const uint32_t NONE = 0xffffffffu;
+
+    PasswordStrengthEstimator();
+
+public:
+    // Слова короче не попадают в словарь: иначе совпадает почти все
+    static const size_t MIN_WORD_LENGTH = 3;
+    // Словарные совпадения с рангом не выше этого считаются "частыми"
+    static const uint32_t COMMON_RANK_LIMIT = 10000;
+
+    // Встроенный небольшой словарь; создается один раз
+    static const PasswordStrengthEstimator &builtin();
+
+    // Построение из списка слов (одно слово в строке, самые частые первыми)
+    static PasswordStrengthEstimator fromWordList(const std::vector<std::string> &words);
+
+    static PasswordStrengthEstimator fromWordList(std::istream &input);
+
+    // Образ автомата: сохранение и отображение в память
+    void saveImage(const std::string &file_path) const;
+
+    static PasswordStrengthEstimator mapImage(const std::string &file_path);
+
+    // Оценка пароля
+    StrengthEstimate estimate(std::string_view password) const;
+
+    // Все распознанные фрагменты пароля (не только лучшего разбиения)
+    std::vector<StrengthMatch> findMatches(std::string_view password) const;
+
+    // Есть ли в пароле частое слово длиной не менее min_length или последовательность
+    bool hasCommonPattern(std::string_view password, size_t min_length = 4) const;
+
+    // Геттеры
+    uint32_t getWordCount() const;
+
+    uint32_t getNodeCount() const;
+
+    // Оценка 0-4 по числу попыток
+    static int scoreForGuesses(double guesses);
+
+    // Мощность алфавита пароля (26 строчных, 26 прописных, 10 цифр, 32 прочих)
+    static int charsetSize(std::string_view password);
+
+private:
+    void bindStorage(std::shared_ptr<const void> memory, size_t size);
+
+    uint32_t nextState(uint32_t state, unsigned char c) const;
+
+    void findDictionaryMatches(std::string_view text, std::string_view original, bool substituted,
+                               std::vector<StrengthMatch> &out) const;
+
+    static void findSequenceMatches(std::string_view password, std::vector<StrengthMatch> &out);
+
+    static void findRepeatMatches(std::string_view password, std::vector<StrengthMatch> &out);
+
+    static void findYearMatches(std::string_view password, std::vector<StrengthMatch> &out);
+
+    static double uppercaseVariations(std::string_view word);
+};
+
+
+#endif //IRONVAULT_MANAGER_PASSWORDSTRENGTHESTIMATOR_H
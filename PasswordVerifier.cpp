@@ -0,0 +1,163 @@
+#include "PasswordVerifier.h"
+#include <openssl/crypto.h>
+#include <openssl/evp.h>
+#include <openssl/rand.h>
+#include <cstring>
+#include <stdexcept>
+
+namespace {
+    const char MAGIC[4] = {'I', 'V', 'P', 'V'};
+    const char HEX_DIGITS[] = "0123456789abcdef";
+
+    int hexValue(char c) {
+        if (c >= '0' && c <= '9') return c - '0';
+        if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+        if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+        return -1;
+    }
+}
+
+// Конструктор по умолчанию
+PasswordVerifier::PasswordVerifier()
+        : kdf(Kdf::Pbkdf2HmacSha256), iterations(DEFAULT_ITERATIONS), salt{}, hash{} {}
+
+// Создание верификатора со случайной солью
+PasswordVerifier PasswordVerifier::create(std::string_view password) {
+    unsigned char new_salt[SALT_LENGTH];
+    if (RAND_bytes(new_salt, SALT_LENGTH) != 1) {
+        throw std::runtime_error("Failed to generate salt");
+    }
+    return create(password, new_salt);
+}
+
+// Создание верификатора с заданной солью
+PasswordVerifier PasswordVerifier::create(std::string_view password, const unsigned char *salt_data,
+                                          uint32_t iterations) {
+    if (password.empty()) {
+        throw std::invalid_argument("Password cannot be empty");
+    }
+    if (iterations == 0 || iterations > MAX_ITERATIONS) {
+        throw std::invalid_argument("Invalid KDF iteration count");
+    }
+
+    PasswordVerifier verifier;
+    verifier.iterations = iterations;
+    std::memcpy(verifier.salt.data(), salt_data, SALT_LENGTH);
+    computeHash(password, verifier.salt.data(), iterations, verifier.hash.data());
+    return verifier;
+}
+
+// Разбор сохраненного значения
+PasswordVerifier PasswordVerifier::parse(std::string_view stored) {
+    if (stored.size() != ENCODED_LENGTH * 2) {
+        return parseLegacy(stored);
+    }
+
+    unsigned char header[ENCODED_LENGTH];
+    for (size_t i = 0; i < ENCODED_LENGTH; ++i) {
+        int high = hexValue(stored[2 * i]);
+        int low = hexValue(stored[2 * i + 1]);
+        if (high < 0 || low < 0) {
+            throw std::invalid_argument("Invalid password hash encoding");
+        }
+        header[i] = static_cast<unsigned char>((high << 4) | low);
+    }
+
+    if (std::memcmp(header, MAGIC, sizeof(MAGIC)) != 0 || header[4] != FORMAT_VERSION) {
+        throw std::invalid_argument("Unsupported password hash format");
+    }
+    if (header[5] != static_cast<uint8_t>(Kdf::Pbkdf2HmacSha256)) {
+        throw std::invalid_argument("Unsupported password KDF");
+    }
+
+    PasswordVerifier verifier;
+    verifier.kdf = Kdf::Pbkdf2HmacSha256;
+    verifier.iterations = (uint32_t(header[8]) << 24) | (uint32_t(header[9]) << 16) |
+                          (uint32_t(header[10]) << 8) | uint32_t(header[11]);
+    if (verifier.iterations == 0 || verifier.iterations > MAX_ITERATIONS) {
+        throw std::invalid_argument("Invalid KDF iteration count");
+    }
+    std::memcpy(verifier.salt.data(), header + 12, SALT_LENGTH);
+    std::memcpy(verifier.hash.data(), header + 12 + SALT_LENGTH, HASH_LENGTH);
+    OPENSSL_cleanse(header, sizeof(header));
+    return verifier;
+}
+
+// Устаревший формат: 16 байт соли, ':' и 32 байта хэша без кодирования.
+// Разбираем по фиксированным позициям, так как соль может содержать ':'.
+PasswordVerifier PasswordVerifier::parseLegacy(std::string_view stored) {
+    if (stored.size() != SALT_LENGTH + 1 + HASH_LENGTH || stored[SALT_LENGTH] != ':') {
+        throw std::invalid_argument("Invalid password hash format");
+    }
+
+    PasswordVerifier verifier;
+    std::memcpy(verifier.salt.data(), stored.data(), SALT_LENGTH);
+    std::memcpy(verifier.hash.data(), stored.data() + SALT_LENGTH + 1, HASH_LENGTH);
+    return verifier;
+}
+
+// Проверка пароля
+bool PasswordVerifier::verify(std::string_view password) const {
+    if (password.empty()) {
+        return false;
+    }
+
+    unsigned char computed[HASH_LENGTH];
+    try {
+        computeHash(password, salt.data(), iterations, computed);
+    } catch (const std::exception &e) {
+        return false;
+    }
+
+    // Сравнение с постоянным временем для защиты от timing-атак
+    bool equal = CRYPTO_memcmp(computed, hash.data(), HASH_LENGTH) == 0;
+    OPENSSL_cleanse(computed, HASH_LENGTH);
+    return equal;
+}
+
+// Кодирование заголовка в hex
+std::string PasswordVerifier::encode() const {
+    unsigned char header[ENCODED_LENGTH] = {};
+    std::memcpy(header, MAGIC, sizeof(MAGIC));
+    header[4] = FORMAT_VERSION;
+    header[5] = static_cast<uint8_t>(kdf);
+    header[8] = static_cast<unsigned char>(iterations >> 24);
+    header[9] = static_cast<unsigned char>(iterations >> 16);
+    header[10] = static_cast<unsigned char>(iterations >> 8);
+    header[11] = static_cast<unsigned char>(iterations);
+    std::memcpy(header + 12, salt.data(), SALT_LENGTH);
+    std::memcpy(header + 12 + SALT_LENGTH, hash.data(), HASH_LENGTH);
+
+    std::string result(ENCODED_LENGTH * 2, '0');
+    for (size_t i = 0; i < ENCODED_LENGTH; ++i) {
+        result[2 * i] = HEX_DIGITS[header[i] >> 4];
+        result[2 * i + 1] = HEX_DIGITS[header[i] & 0x0F];
+    }
+    OPENSSL_cleanse(header, sizeof(header));
+    return result;
+}
+
+// Геттеры
+PasswordVerifier::Kdf PasswordVerifier::getKdf() const { return kdf; }
+
+uint32_t PasswordVerifier::getIterations() const { return iterations; }
+
+const std::array<unsigned char, PasswordVerifier::SALT_LENGTH> &PasswordVerifier::getSalt() const { return salt; }
+
+// Очистка чувствительных данных
+void PasswordVerifier::clear() {
+    OPENSSL_cleanse(salt.data(), salt.size());
+    OPENSSL_cleanse(hash.data(), hash.size());
+}
+
+// PBKDF2-HMAC-SHA256 в буфер вызывающей стороны
+void PasswordVerifier::computeHash(std::string_view password, const unsigned char *salt_data, uint32_t iterations,
+                                   unsigned char *out) {
+    if (PKCS5_PBKDF2_HMAC(password.data(), password.size(),
+                          salt_data, SALT_LENGTH,
+                          iterations,
+                          EVP_sha256(),
+                          HASH_LENGTH, out) != 1) {
+        throw std::runtime_error("Failed to derive key from password");
+    }
+}
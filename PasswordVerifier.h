@@ -0,0 +1,72 @@
+#ifndef IRONVAULT_MANAGER_PASSWORDVERIFIER_H
+#define IRONVAULT_MANAGER_PASSWORDVERIFIER_H
+
+#include <array>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+// Разобранный хэш мастер-пароля.
+// Бинарный заголовок фиксированного размера (64 байта):
+//   magic "IVPV" | версия (1) | KDF (1) | резерв (2) | итерации (4, big-endian)
+//   | соль (16) | хэш (32) | резерв (4)
+// В файле хранилища записывается в hex, поэтому не содержит ':' и '\n'.
+class PasswordVerifier {
+public:
+    // Константы
+    static const size_t SALT_LENGTH = 16;
+    static const size_t HASH_LENGTH = 32;
+    static const size_t ENCODED_LENGTH = 64;
+    static const uint32_t DEFAULT_ITERATIONS = 100000;
+
+    enum class Kdf : uint8_t {
+        Pbkdf2HmacSha256 = 1
+    };
+
+private:
+    Kdf kdf;
+    uint32_t iterations;
+    std::array<unsigned char, SALT_LENGTH> salt;
+    std::array<unsigned char, HASH_LENGTH> hash;
+
+    static const uint8_t FORMAT_VERSION = 1;
+    static const uint32_t MAX_ITERATIONS = 10000000;
+
+public:
+    // Конструкторы
+    PasswordVerifier();
+
+    // Создание нового верификатора для пароля
+    static PasswordVerifier create(std::string_view password);
+
+    static PasswordVerifier create(std::string_view password, const unsigned char *salt_data,
+                                   uint32_t iterations = DEFAULT_ITERATIONS);
+
+    // Разбор сохраненного значения (hex-заголовок или устаревший формат salt:hash)
+    static PasswordVerifier parse(std::string_view stored);
+
+    // Проверка пароля: PBKDF2 в буфер на стеке и сравнение за постоянное время
+    bool verify(std::string_view password) const;
+
+    // Кодирование в hex для записи в хранилище
+    std::string encode() const;
+
+    // Геттеры
+    Kdf getKdf() const;
+
+    uint32_t getIterations() const;
+
+    const std::array<unsigned char, SALT_LENGTH> &getSalt() const;
+
+    // Очистка чувствительных данных
+    void clear();
+
+private:
+    static PasswordVerifier parseLegacy(std::string_view stored);
+
+    static void computeHash(std::string_view password, const unsigned char *salt_data, uint32_t iterations,
+                            unsigned char *out);
+};
+
+
+#endif //IRONVAULT_MANAGER_PASSWORDVERIFIER_H
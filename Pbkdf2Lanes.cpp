@@ -0,0 +1,328 @@
+#include "Pbkdf2Lanes.h"
+#include <openssl/crypto.h>
+#include <openssl/evp.h>
+#include <openssl/hmac.h>
+#include <algorithm>
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+// Векторные ядра: расширения векторов GCC/Clang и выбор target на x86
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#include <cpuid.h>
+#define IRONVAULT_PBKDF2_VECTOR 1
+#define IRONVAULT_ALWAYS_INLINE inline __attribute__((always_inline))
+#endif
+
+namespace {
+    using Job = Pbkdf2Lanes::Job;
+
+    const size_t BLOCK_LENGTH = 64;
+    const size_t STATE_WORDS = 8;
+    const size_t BLOCK_WORDS = 16;
+
+    // Итераций в проверке ядра: достаточно, чтобы пройти цикл U2..Uc
+    const int SELF_TEST_ITERATIONS = 3;
+
+    // Одиночный вывод через OpenSSL
+    void deriveOpenssl(const Job &job, int iterations) {
+        if (PKCS5_PBKDF2_HMAC(job.password.data(), static_cast<int>(job.password.size()),
+                              job.salt, static_cast<int>(job.salt_length), iterations, EVP_sha256(),
+                              Pbkdf2Lanes::KEY_LENGTH, job.key) != 1) {
+            throw std::runtime_error("Failed to derive key from password");
+        }
+    }
+
+    void deriveGroupOpenssl(const Job *jobs, size_t count, int iterations) {
+        for (size_t i = 0; i < count; ++i) {
+            deriveOpenssl(jobs[i], iterations);
+        }
+    }
+
+#ifdef IRONVAULT_PBKDF2_VECTOR
+    const uint32_t ROUND_CONSTANTS[64] = {
+            0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+            0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+            0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+            0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+            0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+            0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+            0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+            0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2
+    };
+    const uint32_t INITIAL_STATE[STATE_WORDS] = {
+            0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a, 0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19
+    };
+
+    // Слово SHA-256 по N полосам
+    template<size_t N>
+    struct Lanes {
+        typedef uint32_t Vec __attribute__((vector_size(N * sizeof(uint32_t))));
+    };
+
+    // Циклический сдвиг всех полос; макрос, а не функция: вектор как
+    // значение вне функции с нужным target меняет ABI
+#define IRONVAULT_ROTR(x, n) (((x) >> (n)) | ((x) << (32 - (n))))
+
+    uint32_t loadBigEndian(const unsigned char *p) {
+        return (uint32_t(p[0]) << 24) | (uint32_t(p[1]) << 16) | (uint32_t(p[2]) << 8) | uint32_t(p[3]);
+    }
+
+    void storeBigEndian(uint32_t value, unsigned char *p) {
+        p[0] = static_cast<unsigned char>(value >> 24);
+        p[1] = static_cast<unsigned char>(value >> 16);
+        p[2] = static_cast<unsigned char>(value >> 8);
+        p[3] = static_cast<unsigned char>(value);
+    }
+
+    // Сжатие одного блока во всех полосах; w портится
+    template<typename V>
+    IRONVAULT_ALWAYS_INLINE void compress(V *state, V *w) {
+        V a = state[0], b = state[1], c = state[2], d = state[3];
+        V e = state[4], f = state[5], g = state[6], h = state[7];
+#pragma GCC unroll 64
+        for (size_t i = 0; i < 64; ++i) {
+            if (i >= BLOCK_WORDS) {
+                V w15 = w[(i + 1) & 15];
+                V w2 = w[(i + 14) & 15];
+                w[i & 15] += (IRONVAULT_ROTR(w15, 7) ^ IRONVAULT_ROTR(w15, 18) ^ (w15 >> 3)) +
+                             (IRONVAULT_ROTR(w2, 17) ^ IRONVAULT_ROTR(w2, 19) ^ (w2 >> 10)) + w[(i + 9) & 15];
+            }
+            V t1 = h + (IRONVAULT_ROTR(e, 6) ^ IRONVAULT_ROTR(e, 11) ^ IRONVAULT_ROTR(e, 25)) +
+                   ((e & f) ^ (~e & g)) + ROUND_CONSTANTS[i] + w[i & 15];
+            V t2 = (IRONVAULT_ROTR(a, 2) ^ IRONVAULT_ROTR(a, 13) ^ IRONVAULT_ROTR(a, 22)) +
+                   ((a & b) ^ (a & c) ^ (b & c));
+            h = g;
+            g = f;
+            f = e;
+            e = d + t1;
+            d = c;
+            c = b;
+            b = a;
+            a = t1 + t2;
+        }
+        state[0] += a;
+        state[1] += b;
+        state[2] += c;
+        state[3] += d;
+        state[4] += e;
+        state[5] += f;
+        state[6] += g;
+        state[7] += h;
+    }
+
+    // Блок из 32-байтового дайджеста после 64 байт ключа HMAC: паддинг и длина 768 бит
+    template<typename V>
+    IRONVAULT_ALWAYS_INLINE void digestBlock(const V *digest, V *w) {
+        for (size_t j = 0; j < STATE_WORDS; ++j) {
+            w[j] = digest[j];
+        }
+        w[8] = V{} + 0x80000000u;
+        for (size_t j = 9; j < BLOCK_WORDS - 1; ++j) {
+            w[j] = V{};
+        }
+        w[15] = V{} + uint32_t((BLOCK_LENGTH + Pbkdf2Lanes::KEY_LENGTH) * 8);
+    }
+
+    // До N выводов. Внутреннее и внешнее состояния HMAC считаются один раз,
+    // U1 - через HMAC OpenSSL (соль произвольной длины), дальше на каждую
+    // итерацию приходится два сжатия в каждой полосе. Пустые полосы
+    // повторяют первый вывод и отбрасываются.
+    template<size_t N>
+    IRONVAULT_ALWAYS_INLINE void deriveGroup(const Job *jobs, size_t count, int iterations) {
+        using V = typename Lanes<N>::Vec;
+        V inner[STATE_WORDS], outer[STATE_WORDS], u[STATE_WORDS], t[STATE_WORDS], s[STATE_WORDS];
+        V w[BLOCK_WORDS];
+        unsigned char keys[N][BLOCK_LENGTH] = {};
+        unsigned char first[N][Pbkdf2Lanes::KEY_LENGTH];
+        std::vector<unsigned char> message;
+
+        for (size_t lane = 0; lane < N; ++lane) {
+            const Job &job = jobs[lane < count ? lane : 0];
+            // Ключ HMAC длиннее блока заменяется своим хешем
+            if (job.password.size() > BLOCK_LENGTH) {
+                if (EVP_Digest(job.password.data(), job.password.size(), keys[lane], nullptr, EVP_sha256(),
+                               nullptr) != 1) {
+                    throw std::runtime_error("Failed to derive key from password");
+                }
+            } else {
+                std::copy(job.password.begin(), job.password.end(), keys[lane]);
+            }
+
+            // U1 = HMAC(P, S || INT(1))
+            message.assign(job.salt, job.salt + job.salt_length);
+            message.insert(message.end(), {0, 0, 0, 1});
+            unsigned int length = 0;
+            if (!HMAC(EVP_sha256(), job.password.data(), static_cast<int>(job.password.size()),
+                      message.data(), message.size(), first[lane], &length)) {
+                throw std::runtime_error("Failed to derive key from password");
+            }
+        }
+
+        // Состояния после блоков K ^ ipad и K ^ opad
+        for (size_t j = 0; j < BLOCK_WORDS; ++j) {
+            for (size_t lane = 0; lane < N; ++lane) {
+                w[j][lane] = loadBigEndian(keys[lane] + j * 4) ^ 0x36363636u;
+            }
+        }
+        for (size_t j = 0; j < STATE_WORDS; ++j) {
+            inner[j] = V{} + INITIAL_STATE[j];
+            outer[j] = inner[j];
+        }
+        compress(inner, w);
+        for (size_t j = 0; j < BLOCK_WORDS; ++j) {
+            for (size_t lane = 0; lane < N; ++lane) {
+                w[j][lane] = loadBigEndian(keys[lane] + j * 4) ^ 0x5c5c5c5cu;
+            }
+        }
+        compress(outer, w);
+
+        for (size_t j = 0; j < STATE_WORDS; ++j) {
+            for (size_t lane = 0; lane < N; ++lane) {
+                u[j][lane] = loadBigEndian(first[lane] + j * 4);
+            }
+            t[j] = u[j];
+        }
+
+        // U_i = HMAC(P, U_{i-1}), T = U1 ^ ... ^ Uc
+        for (int iteration = 1; iteration < iterations; ++iteration) {
+            digestBlock(u, w);
+            for (size_t j = 0; j < STATE_WORDS; ++j) {
+                s[j] = inner[j];
+            }
+            compress(s, w);
+            digestBlock(s, w);
+            for (size_t j = 0; j < STATE_WORDS; ++j) {
+                u[j] = outer[j];
+            }
+            compress(u, w);
+            for (size_t j = 0; j < STATE_WORDS; ++j) {
+                t[j] ^= u[j];
+            }
+        }
+
+        for (size_t lane = 0; lane < count; ++lane) {
+            for (size_t j = 0; j < STATE_WORDS; ++j) {
+                storeBigEndian(t[j][lane], jobs[lane].key + j * 4);
+            }
+        }
+
+        OPENSSL_cleanse(inner, sizeof(inner));
+        OPENSSL_cleanse(outer, sizeof(outer));
+        OPENSSL_cleanse(u, sizeof(u));
+        OPENSSL_cleanse(t, sizeof(t));
+        OPENSSL_cleanse(s, sizeof(s));
+        OPENSSL_cleanse(w, sizeof(w));
+        OPENSSL_cleanse(keys, sizeof(keys));
+        OPENSSL_cleanse(first, sizeof(first));
+    }
+
+    // Ядра под каждый набор инструкций; deriveGroup встраивается в них
+    __attribute__((target("avx512f")))
+    void deriveGroupAvx512(const Job *jobs, size_t count, int iterations) {
+        deriveGroup<16>(jobs, count, iterations);
+    }
+
+    __attribute__((target("avx2")))
+    void deriveGroupAvx2(const Job *jobs, size_t count, int iterations) {
+        deriveGroup<8>(jobs, count, iterations);
+    }
+
+    void deriveGroupVector4(const Job *jobs, size_t count, int iterations) {
+        deriveGroup<4>(jobs, count, iterations);
+    }
+
+    // SHA-NI: CPUID.(EAX=7, ECX=0):EBX[29]
+    bool hasShaExtensions() {
+        unsigned int eax = 0, ebx = 0, ecx = 0, edx = 0;
+        return __get_cpuid_count(7, 0, &eax, &ebx, &ecx, &edx) && (ebx & (1u << 29));
+    }
+#endif
+
+    // Ядро: число полос и функция для группы не больше lanes выводов.
+    // Группа меньше min_group быстрее считается OpenSSL по одному
+    // (полная группа AVX-512 стоит около двух одиночных выводов, AVX2 - трех)
+    struct Backend {
+        size_t lanes;
+        size_t min_group;
+        const char *name;
+        void (*derive_group)(const Job *, size_t, int);
+    };
+
+    // Сверка ядра с OpenSSL на полной группе: разные длины паролей
+    // (включая длиннее блока) и солей
+    bool matchesOpenssl(const Backend &backend) {
+        std::vector<std::string> passwords(backend.lanes);
+        std::vector<std::vector<unsigned char>> salts(backend.lanes);
+        std::vector<unsigned char> actual(backend.lanes * Pbkdf2Lanes::KEY_LENGTH);
+        std::vector<unsigned char> expected(backend.lanes * Pbkdf2Lanes::KEY_LENGTH);
+        std::vector<Job> jobs(backend.lanes);
+        std::vector<Job> reference(backend.lanes);
+        for (size_t lane = 0; lane < backend.lanes; ++lane) {
+            passwords[lane].assign(lane * 11 % 97 + 1, static_cast<char>('a' + lane));
+            salts[lane].assign(lane * 7 % 40 + 1, static_cast<unsigned char>(0xa5 ^ lane));
+            jobs[lane] = Job{passwords[lane], salts[lane].data(), salts[lane].size(),
+                             actual.data() + lane * Pbkdf2Lanes::KEY_LENGTH};
+            reference[lane] = jobs[lane];
+            reference[lane].key = expected.data() + lane * Pbkdf2Lanes::KEY_LENGTH;
+        }
+        backend.derive_group(jobs.data(), jobs.size(), SELF_TEST_ITERATIONS);
+        deriveGroupOpenssl(reference.data(), reference.size(), SELF_TEST_ITERATIONS);
+        return actual == expected;
+    }
+
+    // Четыре полосы SSE2 медленнее одиночного SHA-256 на SHA-NI, поэтому
+    // без AVX2 ядро берется только на x86 без SHA-NI; на других архитектурах
+    // OpenSSL использует аппаратные инструкции SHA-256
+    Backend selectBackend() {
+        const Backend openssl{1, 1, "openssl", deriveGroupOpenssl};
+        std::vector<Backend> candidates;
+#ifdef IRONVAULT_PBKDF2_VECTOR
+        if (__builtin_cpu_supports("avx512f")) {
+            candidates.push_back(Backend{16, 3, "avx512", deriveGroupAvx512});
+        }
+        if (__builtin_cpu_supports("avx2")) {
+            candidates.push_back(Backend{8, 4, "avx2", deriveGroupAvx2});
+        }
+        if (!hasShaExtensions()) {
+            candidates.push_back(Backend{4, 2, "vector4", deriveGroupVector4});
+        }
+#endif
+        for (const Backend &candidate: candidates) {
+            if (matchesOpenssl(candidate)) {
+                return candidate;
+            }
+        }
+        return openssl;
+    }
+
+    const Backend &backend() {
+        static const Backend selected = selectBackend();
+        return selected;
+    }
+}
+
+size_t Pbkdf2Lanes::laneCount() {
+    return backend().lanes;
+}
+
+const char *Pbkdf2Lanes::backendName() {
+    return backend().name;
+}
+
+// Выводы группами по ширине ядра
+void Pbkdf2Lanes::derive(const Job *jobs, size_t count, int iterations) {
+    if (iterations < 1) {
+        throw std::invalid_argument("PBKDF2 iteration count must be positive");
+    }
+    const Backend &selected = backend();
+    for (size_t i = 0; i < count; i += selected.lanes) {
+        size_t group = std::min(selected.lanes, count - i);
+        if (group < selected.min_group) {
+            deriveGroupOpenssl(jobs + i, group, iterations);
+        } else {
+            selected.derive_group(jobs + i, group, iterations);
+        }
+    }
+}
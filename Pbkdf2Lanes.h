@@ -0,0 +1,40 @@
+#ifndef IRONVAULT_MANAGER_PBKDF2LANES_H
+#define IRONVAULT_MANAGER_PBKDF2LANES_H
+
+#include <cstddef>
+#include <string_view>
+
+// Многополосный PBKDF2-HMAC-SHA256 с ключом в один блок SHA-256 (32 байта).
+// Независимые выводы (разные пароли и соли) считаются вместе: каждое слово
+// состояния SHA-256 - вектор, полоса которого принадлежит своему выводу.
+// Ширина выбирается по процессору при первом вызове: 16 полос AVX-512,
+// 8 полос AVX2, 4 полосы SSE2 на x86 без SHA-NI, иначе только OpenSSL.
+// Одиночный вывод выгоднее отдавать OpenSSL (он использует SHA-NI),
+// выигрыш здесь - на пачках.
+// Перед первым использованием ядро сверяется с PKCS5_PBKDF2_HMAC;
+// при расхождении все выводы идут через OpenSSL.
+class Pbkdf2Lanes {
+public:
+    // Длина ключа
+    static const size_t KEY_LENGTH = 32;
+
+    // Один вывод: key получает KEY_LENGTH байт
+    struct Job {
+        std::string_view password;
+        const unsigned char *salt;
+        size_t salt_length;
+        unsigned char *key;
+    };
+
+    // Число полос выбранного ядра (1 - только OpenSSL)
+    static size_t laneCount();
+
+    // Название ядра: "avx512", "avx2", "vector4" или "openssl"
+    static const char *backendName();
+
+    // Выводы для jobs[0, count) группами по laneCount() в вызывающем потоке
+    static void derive(const Job *jobs, size_t count, int iterations);
+};
+
+
+#endif //IRONVAULT_MANAGER_PBKDF2LANES_H
@@ -0,0 +1,19 @@
+#ifndef IRONVAULT_MANAGER_PUBLICSUFFIXLIST_H
+#define IRONVAULT_MANAGER_PUBLICSUFFIXLIST_H
+
+#include <string_view>
+
+// Встроенный Public Suffix List (https://publicsuffix.org/list/), разделы
+// ICANN и PRIVATE. Правила с метками Unicode хранятся и в UTF-8, и в
+// Punycode (xn--), поэтому хосты в любой из форм разбираются одинаково.
+class PublicSuffixList {
+public:
+    // Публичный суффикс хоста в нижнем регистре по алгоритму списка:
+    // исключение важнее остальных правил, иначе побеждает самое длинное.
+    // Неявное правило "*" не применяется - если ни одно правило не
+    // подошло, суффикс неизвестен и результат пустой.
+    static std::string_view publicSuffix(std::string_view host);
+};
+
+
+#endif //IRONVAULT_MANAGER_PUBLICSUFFIXLIST_H
@@ -1,4 +1,5 @@
 #include "SearchFilter.h"
+#include "VaultTrace.h"
 #include <algorithm>
 #include <cctype>
 #include <ctime>
@@ -36,13 +37,26 @@ bool SearchFilter::matches(const CredentialRecord &record) const {
     return true;
 }
 
+// Отбор подходящих записей из списка
+std::vector<CredentialRecord> SearchFilter::filterRecords(const std::vector<CredentialRecord> &records) const {
+    IRONVAULT_TRACE_SPAN_ARG("search.filter", "records", records.size());
+
+    std::vector<CredentialRecord> results;
+    for (const auto &record: records) {
+        if (matches(record)) {
+            results.push_back(record);
+        }
+    }
+    return results;
+}
+
 // Проверка соответствия имени сервиса
 bool SearchFilter::matchesServiceName(const CredentialRecord &record) const {
     if (service_name_query.empty()) {
         return true;
     }
 
-    std::string service_name = record.getServiceName();
+    std::string_view service_name = record.getServiceName();
     return matchesText(service_name, service_name_query);
 }
 
@@ -52,7 +66,7 @@ bool SearchFilter::matchesLogin(const CredentialRecord &record) const {
         return true;
     }
 
-    std::string login = record.getLogin();
+    std::string_view login = record.getLogin();
     return matchesText(login, login_query);
 }
 
@@ -62,7 +76,7 @@ bool SearchFilter::matchesUrl(const CredentialRecord &record) const {
         return true;
     }
 
-    std::string url = record.getUrl();
+    std::string_view url = record.getUrl();
     return matchesText(url, url_query);
 }
 
@@ -72,18 +86,19 @@ bool SearchFilter::matchesCategory(const CredentialRecord &record) const {
         return true;
     }
 
-    std::string category = record.getCategory();
+    std::string_view category = record.getCategory();
     return matchesText(category, category_query);
 }
 
-// Проверка соответствия заметок
+// Проверка соответствия заметок; у записей хранилища заметок нет,
+// поэтому запрос сравнивается с пустым текстом
 bool SearchFilter::matchesNotes(const CredentialRecord &record) const {
     if (notes_query.empty() || !search_in_notes) {
         return true;
     }
 
-    std::string notes = record.getNotes();
-    return matchesText(notes, notes_query);
+    (void) record;
+    return matchesText(std::string_view(), notes_query);
 }
 
 // Проверка соответствия временному диапазону
@@ -107,7 +122,7 @@ bool SearchFilter::matchesDateRange(const CredentialRecord &record) const {
 
 // Проверка соответствия списку категорий
 bool SearchFilter::matchesCategories(const CredentialRecord &record) const {
-    std::string category = record.getCategory();
+    std::string_view category = record.getCategory();
 
     // Проверка включенных категорий
     if (!categories.empty() && !isInCategories(category)) {
@@ -143,6 +158,19 @@ void SearchFilter::setNotesQuery(const std::string &query) {
     notes_query = query;
 }
 
+// Сеттеры для параметров поиска
+void SearchFilter::setCaseSensitive(bool sensitive) {
+    case_sensitive = sensitive;
+}
+
+void SearchFilter::setExactMatch(bool exact) {
+    exact_match = exact;
+}
+
+void SearchFilter::setSearchInNotes(bool search_notes) {
+    search_in_notes = search_notes;
+}
+
 // Сеттеры для временного диапазона
 void SearchFilter::setDateRange(std::time_t from, std::time_t to) {
     date_from = from;
@@ -304,13 +332,13 @@ SearchFilter SearchFilter::createTextSearchFilter(const std::string &text) {
 }
 
 // Вспомогательные методы для работы со строками
-std::string SearchFilter::toLower(const std::string &str) const {
-    std::string result = str;
+std::string SearchFilter::toLower(std::string_view str) const {
+    std::string result(str);
     std::transform(result.begin(), result.end(), result.begin(), ::tolower);
     return result;
 }
 
-bool SearchFilter::containsText(const std::string &text, const std::string &query) const {
+bool SearchFilter::containsText(std::string_view text, std::string_view query) const {
     if (case_sensitive) {
         return text.find(query) != std::string::npos;
     } else {
@@ -320,7 +348,7 @@ bool SearchFilter::containsText(const std::string &text, const std::string &quer
     }
 }
 
-bool SearchFilter::matchesText(const std::string &text, const std::string &query) const {
+bool SearchFilter::matchesText(std::string_view text, std::string_view query) const {
     if (exact_match) {
         if (case_sensitive) {
             return text == query;
@@ -333,7 +361,7 @@ bool SearchFilter::matchesText(const std::string &text, const std::string &query
 }
 
 // Вспомогательные методы для работы с категориями
-bool SearchFilter::isInCategories(const std::string &category) const {
+bool SearchFilter::isInCategories(std::string_view category) const {
     if (case_sensitive) {
         return std::find(categories.begin(), categories.end(), category) != categories.end();
     } else {
@@ -347,7 +375,7 @@ bool SearchFilter::isInCategories(const std::string &category) const {
     }
 }
 
-bool SearchFilter::isExcludedCategory(const std::string &category) const {
+bool SearchFilter::isExcludedCategory(std::string_view category) const {
     if (case_sensitive) {
         return std::find(excluded_categories.begin(), excluded_categories.end(), category) != excluded_categories.end();
     } else {
@@ -3,6 +3,7 @@
 
 #include "CredentialRecord.h"
 #include <string>
+#include <string_view>
 #include <vector>
 #include <memory>
 #include <ctime>
@@ -31,6 +32,9 @@ public:
     // Основной метод проверки соответствия
     bool matches(const CredentialRecord &record) const;
 
+    // Отбор подходящих записей из списка
+    std::vector<CredentialRecord> filterRecords(const std::vector<CredentialRecord> &records) const;
+
     // Сеттеры для критериев поиска
     void setServiceNameQuery(const std::string &query);
 
@@ -144,16 +148,16 @@ private:
     bool matchesCategories(const CredentialRecord &record) const;
 
     // Вспомогательные методы для работы со строками
-    std::string toLower(const std::string &str) const;
+    std::string toLower(std::string_view str) const;
 
-    bool containsText(const std::string &text, const std::string &query) const;
+    bool containsText(std::string_view text, std::string_view query) const;
 
-    bool matchesText(const std::string &text, const std::string &query) const;
+    bool matchesText(std::string_view text, std::string_view query) const;
 
     // Вспомогательные методы для работы с категориями
-    bool isInCategories(const std::string &category) const;
+    bool isInCategories(std::string_view category) const;
 
-    bool isExcludedCategory(const std::string &category) const;
+    bool isExcludedCategory(std::string_view category) const;
 };
 
 
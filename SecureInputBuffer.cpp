@@ -123,13 +123,13 @@ void SecureInputBuffer::resize(size_t new_size) {
 }
 
 // Получение данных как строки
-std::string SecureInputBuffer::getString() const {
-    return std::string(buffer.data(), position);
+secure_string SecureInputBuffer::getString() const {
+    return secure_string(buffer.data(), position);
 }
 
 // Получение буфера
-std::vector<char> SecureInputBuffer::getBuffer() const {
-    return std::vector<char>(buffer.begin(), buffer.begin() + position);
+secure_vector<char> SecureInputBuffer::getBuffer() const {
+    return secure_vector<char>(buffer.begin(), buffer.begin() + position);
 }
 
 // Получение размера данных
@@ -188,20 +188,20 @@ bool SecureInputBuffer::isValidUtf8() const {
 }
 
 // Статические методы
-std::string SecureInputBuffer::readSecureString(bool hide_input) {
+secure_string SecureInputBuffer::readSecureString(bool hide_input) {
     SecureInputBuffer buffer;
     if (buffer.readFromStdin(hide_input)) {
         return buffer.getString();
     }
-    return "";
+    return secure_string();
 }
 
-std::string SecureInputBuffer::readSecureStringWithSize(size_t max_size, bool hide_input) {
+secure_string SecureInputBuffer::readSecureStringWithSize(size_t max_size, bool hide_input) {
     SecureInputBuffer buffer(max_size);
     if (buffer.readFromStdin(hide_input)) {
         return buffer.getString();
     }
-    return "";
+    return secure_string();
 }
 
 void SecureInputBuffer::secureStringClear(std::string &str) {
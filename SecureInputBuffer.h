@@ -4,11 +4,12 @@
 #include <vector>
 #include <string>
 #include <functional>
+#include "SecureMemory.h"
 
 class SecureInputBuffer {
 
 private:
-    std::vector<char> buffer;
+    secure_vector<char> buffer;
     size_t position;
     bool echo_enabled;
     char mask_char;
@@ -39,9 +40,9 @@ public:
     void resize(size_t new_size);
 
     // Методы доступа к данным
-    std::string getString() const;
+    secure_string getString() const;
 
-    std::vector<char> getBuffer() const;
+    secure_vector<char> getBuffer() const;
 
     size_t getSize() const;
 
@@ -66,9 +67,9 @@ public:
     bool isValidUtf8() const;
 
     // Статические методы для удобства
-    static std::string readSecureString(bool hide_input = true);
+    static secure_string readSecureString(bool hide_input = true);
 
-    static std::string readSecureStringWithSize(size_t max_size, bool hide_input = true);
+    static secure_string readSecureStringWithSize(size_t max_size, bool hide_input = true);
 
     static void secureStringClear(std::string &str);
 
@@ -0,0 +1,165 @@
+#include "SecureMemory.h"
+#include <stdexcept>
+
+#ifdef _WIN32
+
+#include <windows.h>
+
+#else
+#include <sys/mman.h>
+#endif
+
+size_t SecureArena::configured_size = SecureArena::DEFAULT_ARENA_SIZE;
+
+// Конструктор: резервируем и блокируем всю арену один раз
+SecureArena::SecureArena(size_t size)
+        : base(nullptr), capacity(0), slot_count(0), used_slots(0), locked(false) {
+    size = (size + SLOT_SIZE - 1) / SLOT_SIZE * SLOT_SIZE;
+
+#ifdef _WIN32
+    void *region = VirtualAlloc(nullptr, size, MEM_COMMIT | MEM_RESERVE, PAGE_READWRITE);
+    if (!region) {
+        throw std::runtime_error("Failed to reserve secure memory");
+    }
+    locked = VirtualLock(region, size) != 0;
+#else
+    void *region = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (region == MAP_FAILED) {
+        throw std::runtime_error("Failed to reserve secure memory");
+    }
+    // Без mlock (например, из-за RLIMIT_MEMLOCK) арена все равно обнуляется при освобождении
+    locked = mlock(region, size) == 0;
+#ifdef MADV_DONTDUMP
+    madvise(region, size, MADV_DONTDUMP);
+#endif
+#endif
+
+    base = static_cast<unsigned char *>(region);
+    capacity = size;
+    slot_count = size / SLOT_SIZE;
+    bitmap.assign((slot_count + 63) / 64, 0);
+}
+
+// Деструктор: обнуляем и возвращаем память системе
+SecureArena::~SecureArena() {
+    if (!base) {
+        return;
+    }
+    OPENSSL_cleanse(base, capacity);
+#ifdef _WIN32
+    if (locked) {
+        VirtualUnlock(base, capacity);
+    }
+    VirtualFree(base, 0, MEM_RELEASE);
+#else
+    if (locked) {
+        munlock(base, capacity);
+    }
+    munmap(base, capacity);
+#endif
+}
+
+// Глобальная арена процесса
+SecureArena &SecureArena::instance() {
+    // Намеренно не разрушается: секретные строки в статических объектах
+    // могут освобождаться уже после завершения main
+    static SecureArena *arena = new SecureArena(configured_size);
+    return *arena;
+}
+
+void SecureArena::configure(size_t size) {
+    if (size == 0) {
+        throw std::invalid_argument("Secure arena size must be positive");
+    }
+    configured_size = size;
+}
+
+// Выделение: первый подходящий непрерывный участок слотов
+void *SecureArena::allocate(size_t size) {
+    if (size == 0) {
+        return nullptr;
+    }
+    size_t needed = slotsFor(size);
+
+    std::lock_guard<std::mutex> lock(mutex);
+    if (needed > slot_count - used_slots) {
+        return nullptr;
+    }
+
+    size_t run_start = 0;
+    size_t run_length = 0;
+    for (size_t slot = 0; slot < slot_count; ++slot) {
+        // Целое слово занято - пропускаем 64 слота сразу
+        if (slot % 64 == 0 && bitmap[slot / 64] == ~uint64_t(0)) {
+            slot += 63;
+            run_length = 0;
+            continue;
+        }
+        if (isSlotUsed(slot)) {
+            run_length = 0;
+            continue;
+        }
+        if (run_length == 0) {
+            run_start = slot;
+        }
+        if (++run_length == needed) {
+            markSlots(run_start, needed, true);
+            used_slots += needed;
+            return base + run_start * SLOT_SIZE;
+        }
+    }
+    return nullptr;
+}
+
+// Освобождение слотов
+bool SecureArena::deallocate(void *ptr, size_t size) {
+    if (!owns(ptr)) {
+        return false;
+    }
+    size_t first = (static_cast<unsigned char *>(ptr) - base) / SLOT_SIZE;
+    size_t count = slotsFor(size);
+
+    std::lock_guard<std::mutex> lock(mutex);
+    markSlots(first, count, false);
+    used_slots -= count;
+    return true;
+}
+
+bool SecureArena::owns(const void *ptr) const {
+    const unsigned char *p = static_cast<const unsigned char *>(ptr);
+    return base && p >= base && p < base + capacity;
+}
+
+// Статистика
+bool SecureArena::isLocked() const {
+    return locked;
+}
+
+size_t SecureArena::getCapacity() const {
+    return capacity;
+}
+
+size_t SecureArena::getUsedBytes() {
+    std::lock_guard<std::mutex> lock(mutex);
+    return used_slots * SLOT_SIZE;
+}
+
+// Вспомогательные методы
+size_t SecureArena::slotsFor(size_t size) const {
+    return (size + SLOT_SIZE - 1) / SLOT_SIZE;
+}
+
+bool SecureArena::isSlotUsed(size_t slot) const {
+    return (bitmap[slot / 64] >> (slot % 64)) & 1;
+}
+
+void SecureArena::markSlots(size_t first, size_t count, bool used) {
+    for (size_t slot = first; slot < first + count; ++slot) {
+        uint64_t mask = uint64_t(1) << (slot % 64);
+        if (used) {
+            bitmap[slot / 64] |= mask;
+        } else {
+            bitmap[slot / 64] &= ~mask;
+        }
+    }
+}
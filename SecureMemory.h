@@ -0,0 +1,172 @@
+#ifndef IRONVAULT_MANAGER_SECUREMEMORY_H
+#define IRONVAULT_MANAGER_SECUREMEMORY_H
+
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <new>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <openssl/crypto.h>
+
+// Заблокированная в памяти (mlock) арена для секретных данных.
+// Память резервируется один раз при первом обращении, дальше выделение
+// идет слотами из битовой карты без вызовов mmap/mlock.
+class SecureArena {
+private:
+    unsigned char *base;
+    size_t capacity;
+    size_t slot_count;
+    size_t used_slots;
+    bool locked;
+    std::vector<uint64_t> bitmap; // занятые слоты
+    std::mutex mutex;
+
+    // Константы
+    static const size_t SLOT_SIZE = 32;
+    static const size_t DEFAULT_ARENA_SIZE = 256 * 1024;
+
+    static size_t configured_size;
+
+    explicit SecureArena(size_t size);
+
+public:
+    ~SecureArena();
+
+    SecureArena(const SecureArena &) = delete;
+
+    SecureArena &operator=(const SecureArena &) = delete;
+
+    // Глобальная арена процесса
+    static SecureArena &instance();
+
+    // Размер арены; вызывать до первого выделения секретной памяти
+    static void configure(size_t size);
+
+    // Выделение; nullptr, если арена исчерпана
+    void *allocate(size_t size);
+
+    // Освобождение (память уже должна быть обнулена)
+    bool deallocate(void *ptr, size_t size);
+
+    bool owns(const void *ptr) const;
+
+    // Статистика
+    bool isLocked() const;
+
+    size_t getCapacity() const;
+
+    size_t getUsedBytes();
+
+private:
+    size_t slotsFor(size_t size) const;
+
+    bool isSlotUsed(size_t slot) const;
+
+    void markSlots(size_t first, size_t count, bool used);
+};
+
+// Аллокатор, который берет память из SecureArena и обнуляет ее при освобождении.
+// Если арена исчерпана, используется обычная куча (также с обнулением).
+template<typename T>
+class SecureAllocator {
+public:
+    using value_type = T;
+
+    SecureAllocator() noexcept = default;
+
+    template<typename U>
+    SecureAllocator(const SecureAllocator<U> &) noexcept {}
+
+    T *allocate(size_t n) {
+        size_t bytes = n * sizeof(T);
+        if (alignof(T) <= 32) {
+            if (void *ptr = SecureArena::instance().allocate(bytes)) {
+                return static_cast<T *>(ptr);
+            }
+        }
+        return static_cast<T *>(::operator new(bytes));
+    }
+
+    void deallocate(T *ptr, size_t n) noexcept {
+        if (!ptr) {
+            return;
+        }
+        size_t bytes = n * sizeof(T);
+        OPENSSL_cleanse(ptr, bytes);
+        if (!SecureArena::instance().deallocate(ptr, bytes)) {
+            ::operator delete(ptr);
+        }
+    }
+
+    template<typename U>
+    bool operator==(const SecureAllocator<U> &) const noexcept { return true; }
+
+    template<typename U>
+    bool operator!=(const SecureAllocator<U> &) const noexcept { return false; }
+};
+
+template<typename T>
+using secure_vector = std::vector<T, SecureAllocator<T>>;
+
+using secure_basic_string = std::basic_string<char, std::char_traits<char>, SecureAllocator<char>>;
+
+// Строка для паролей. Дополнительно обнуляет встроенный буфер короткой
+// строки (SSO), который не проходит через аллокатор.
+class secure_string : public secure_basic_string {
+public:
+    using secure_basic_string::secure_basic_string;
+
+    secure_string() = default;
+
+    secure_string(const secure_string &other) = default;
+
+    secure_string(secure_string &&other) noexcept
+            : secure_basic_string(std::move(static_cast<secure_basic_string &>(other))) {
+        other.wipe();
+    }
+
+    secure_string(const secure_basic_string &other)
+            : secure_basic_string(other) {}
+
+    explicit secure_string(std::string_view view)
+            : secure_basic_string(view.data(), view.size()) {}
+
+    secure_string &operator=(const secure_string &other) {
+        if (this != &other) {
+            wipe();
+            secure_basic_string::operator=(other);
+        }
+        return *this;
+    }
+
+    secure_string &operator=(secure_string &&other) noexcept {
+        if (this != &other) {
+            wipe();
+            secure_basic_string::operator=(std::move(static_cast<secure_basic_string &>(other)));
+            other.wipe();
+        }
+        return *this;
+    }
+
+    ~secure_string() {
+        wipe();
+    }
+
+    // Обнуление содержимого с сохранением емкости
+    void wipe() noexcept {
+        OPENSSL_cleanse(data(), capacity());
+        clear();
+    }
+
+    std::string_view view() const noexcept {
+        return std::string_view(data(), size());
+    }
+};
+
+using secure_istringstream = std::basic_istringstream<char, std::char_traits<char>, SecureAllocator<char>>;
+
+
+#endif //IRONVAULT_MANAGER_SECUREMEMORY_H
@@ -0,0 +1,433 @@
+#include "ServiceNameIndex.h"
+#include <algorithm>
+#include <stdexcept>
+
+// Курсор
+ServiceNameIndex::Cursor::Cursor(const ServiceNameIndex *index, uint32_t leaf, uint32_t position)
+        : index(index), leaf(leaf), position(position) {
+    // Позиция за концом листа переносится в начало следующего
+    while (this->leaf != NO_NODE && this->position >= index->leaves[this->leaf].count) {
+        this->leaf = index->leaves[this->leaf].next;
+        this->position = 0;
+    }
+}
+
+bool ServiceNameIndex::Cursor::valid() const {
+    return leaf != NO_NODE;
+}
+
+std::string_view ServiceNameIndex::Cursor::key() const {
+    return index->leaves[leaf].keys[position];
+}
+
+ServiceNameIndex::Slot ServiceNameIndex::Cursor::slot() const {
+    return index->leaves[leaf].slots[position];
+}
+
+void ServiceNameIndex::Cursor::next() {
+    if (++position >= index->leaves[leaf].count) {
+        leaf = index->leaves[leaf].next;
+        position = 0;
+    }
+}
+
+// Конструктор: пустой лист-корень
+ServiceNameIndex::ServiceNameIndex()
+        : root(NO_NODE), height(0), first_leaf(NO_NODE), entry_count(0) {
+    clear();
+}
+
+// Вставка
+bool ServiceNameIndex::insert(std::string_view key, Slot slot) {
+    Path path;
+    uint32_t leaf_id = descend(key, &path);
+    Leaf *leaf = &leaves[leaf_id];
+    auto keys_end = leaf->keys.begin() + leaf->count;
+    uint32_t position = static_cast<uint32_t>(std::lower_bound(leaf->keys.begin(), keys_end, key) - leaf->keys.begin());
+    if (position < leaf->count && leaf->keys[position] == key) {
+        return false;
+    }
+
+    if (leaf->count == NODE_CAPACITY) {
+        // Расщепление пополам; новый лист справа
+        uint32_t right_id = allocateLeaf();
+        leaf = &leaves[leaf_id];
+        Leaf &right = leaves[right_id];
+        uint32_t half = NODE_CAPACITY / 2;
+        right.count = static_cast<uint32_t>(NODE_CAPACITY) - half;
+        std::copy(leaf->keys.begin() + half, leaf->keys.end(), right.keys.begin());
+        std::copy(leaf->slots.begin() + half, leaf->slots.end(), right.slots.begin());
+        leaf->count = half;
+        right.prev = leaf_id;
+        right.next = leaf->next;
+        if (leaf->next != NO_NODE) {
+            leaves[leaf->next].prev = right_id;
+        }
+        leaf->next = right_id;
+
+        insertIntoParent(path, right.keys[0], right_id);
+        if (position > half) {
+            leaf_id = right_id;
+            position -= half;
+        }
+        leaf = &leaves[leaf_id];
+    }
+
+    std::copy_backward(leaf->keys.begin() + position, leaf->keys.begin() + leaf->count,
+                       leaf->keys.begin() + leaf->count + 1);
+    std::copy_backward(leaf->slots.begin() + position, leaf->slots.begin() + leaf->count,
+                       leaf->slots.begin() + leaf->count + 1);
+    leaf->keys[position] = key;
+    leaf->slots[position] = slot;
+    ++leaf->count;
+    ++entry_count;
+    return true;
+}
+
+// Удаление
+bool ServiceNameIndex::erase(std::string_view key) {
+    Path path;
+    uint32_t leaf_id = descend(key, &path);
+    Leaf &leaf = leaves[leaf_id];
+    auto keys_end = leaf.keys.begin() + leaf.count;
+    auto it = std::lower_bound(leaf.keys.begin(), keys_end, key);
+    if (it == keys_end || *it != key) {
+        return false;
+    }
+    size_t position = it - leaf.keys.begin();
+    std::copy(leaf.keys.begin() + position + 1, keys_end, leaf.keys.begin() + position);
+    std::copy(leaf.slots.begin() + position + 1, leaf.slots.begin() + leaf.count, leaf.slots.begin() + position);
+    --leaf.count;
+    --entry_count;
+
+    // Опустевший лист (кроме корня) исключается из списка и из родителя
+    if (leaf.count == 0 && height > 0) {
+        if (leaf.prev != NO_NODE) {
+            leaves[leaf.prev].next = leaf.next;
+        } else {
+            first_leaf = leaf.next;
+        }
+        if (leaf.next != NO_NODE) {
+            leaves[leaf.next].prev = leaf.prev;
+        }
+        free_leaves.push_back(leaf_id);
+        removeChild(path, path.size() - 1);
+    }
+    return true;
+}
+
+// Поиск
+bool ServiceNameIndex::find(std::string_view key, Slot &slot) const {
+    const Leaf &leaf = leaves[descend(key, nullptr)];
+    auto keys_end = leaf.keys.begin() + leaf.count;
+    auto it = std::lower_bound(leaf.keys.begin(), keys_end, key);
+    if (it == keys_end || *it != key) {
+        return false;
+    }
+    slot = leaf.slots[it - leaf.keys.begin()];
+    return true;
+}
+
+bool ServiceNameIndex::contains(std::string_view key) const {
+    Slot slot;
+    return find(key, slot);
+}
+
+bool ServiceNameIndex::assign(std::string_view key, Slot slot) {
+    Leaf &leaf = leaves[descend(key, nullptr)];
+    auto keys_end = leaf.keys.begin() + leaf.count;
+    auto it = std::lower_bound(leaf.keys.begin(), keys_end, key);
+    if (it == keys_end || *it != key) {
+        return false;
+    }
+    leaf.slots[it - leaf.keys.begin()] = slot;
+    return true;
+}
+
+// Построение снизу вверх: листья заполняются целиком, затем уровни узлов
+void ServiceNameIndex::build(const std::vector<std::pair<std::string_view, Slot>> &sorted_entries) {
+    clear();
+    if (sorted_entries.empty()) {
+        return;
+    }
+    leaves.clear();
+    size_t leaf_count = (sorted_entries.size() + NODE_CAPACITY - 1) / NODE_CAPACITY;
+    leaves.resize(leaf_count);
+
+    // Уровень: (наименьший ключ поддерева, номер узла)
+    std::vector<std::pair<std::string_view, uint32_t>> level;
+    level.reserve(leaf_count);
+    for (size_t i = 0; i < leaf_count; ++i) {
+        Leaf &leaf = leaves[i];
+        size_t begin = i * NODE_CAPACITY;
+        size_t end = std::min(begin + NODE_CAPACITY, sorted_entries.size());
+        for (size_t j = begin; j < end; ++j) {
+            if (j > 0 && !(sorted_entries[j - 1].first < sorted_entries[j].first)) {
+                throw std::invalid_argument("Index entries must be sorted and unique");
+            }
+            leaf.keys[j - begin] = sorted_entries[j].first;
+            leaf.slots[j - begin] = sorted_entries[j].second;
+        }
+        leaf.count = static_cast<uint32_t>(end - begin);
+        leaf.prev = i == 0 ? NO_NODE : static_cast<uint32_t>(i - 1);
+        leaf.next = i + 1 == leaf_count ? NO_NODE : static_cast<uint32_t>(i + 1);
+        level.emplace_back(leaf.keys[0], static_cast<uint32_t>(i));
+    }
+
+    // Узлы уровня получают детей поровну, так что ни один не остается
+    // с единственным ребенком
+    height = 0;
+    while (level.size() > 1) {
+        size_t group_count = (level.size() + NODE_CAPACITY) / (NODE_CAPACITY + 1);
+        std::vector<std::pair<std::string_view, uint32_t>> parents;
+        parents.reserve(group_count);
+        size_t begin = 0;
+        for (size_t group = 0; group < group_count; ++group) {
+            size_t end = level.size() * (group + 1) / group_count;
+            uint32_t inner_id = allocateInner();
+            Inner &inner = inners[inner_id];
+            inner.count = static_cast<uint32_t>(end - begin);
+            for (size_t j = begin; j < end; ++j) {
+                inner.children[j - begin] = level[j].second;
+                if (j > begin) {
+                    inner.keys[j - begin - 1] = level[j].first;
+                }
+            }
+            parents.emplace_back(level[begin].first, inner_id);
+            begin = end;
+        }
+        level = std::move(parents);
+        ++height;
+    }
+    root = level.front().second;
+    first_leaf = 0;
+    entry_count = sorted_entries.size();
+}
+
+void ServiceNameIndex::clear() {
+    leaves.assign(1, Leaf());
+    inners.clear();
+    free_leaves.clear();
+    free_inners.clear();
+    root = 0;
+    height = 0;
+    first_leaf = 0;
+    entry_count = 0;
+}
+
+size_t ServiceNameIndex::size() const {
+    return entry_count;
+}
+
+bool ServiceNameIndex::empty() const {
+    return entry_count == 0;
+}
+
+// Курсоры
+ServiceNameIndex::Cursor ServiceNameIndex::begin() const {
+    return Cursor(this, first_leaf, 0);
+}
+
+ServiceNameIndex::Cursor ServiceNameIndex::lowerBound(std::string_view key) const {
+    uint32_t leaf_id = descend(key, nullptr);
+    const Leaf &leaf = leaves[leaf_id];
+    auto position = std::lower_bound(leaf.keys.begin(), leaf.keys.begin() + leaf.count, key) - leaf.keys.begin();
+    return Cursor(this, leaf_id, static_cast<uint32_t>(position));
+}
+
+ServiceNameIndex::Cursor ServiceNameIndex::upperBound(std::string_view key) const {
+    uint32_t leaf_id = descend(key, nullptr);
+    const Leaf &leaf = leaves[leaf_id];
+    auto position = std::upper_bound(leaf.keys.begin(), leaf.keys.begin() + leaf.count, key) - leaf.keys.begin();
+    return Cursor(this, leaf_id, static_cast<uint32_t>(position));
+}
+
+// Префиксный поиск: спуск к первому ключу не меньше префикса и обход
+// по списку листьев, пока ключи начинаются с префикса
+std::vector<ServiceNameIndex::Slot> ServiceNameIndex::prefixSlots(std::string_view prefix, size_t limit) const {
+    std::vector<Slot> slots;
+    for (Cursor cursor = lowerBound(prefix); cursor.valid(); cursor.next()) {
+        if (cursor.key().substr(0, prefix.size()) != prefix || (limit && slots.size() == limit)) {
+            break;
+        }
+        slots.push_back(cursor.slot());
+    }
+    return slots;
+}
+
+// Проверка: ключи упорядочены, лежат в границах родителя, листья на одной
+// глубине, список листьев обходит все ключи
+bool ServiceNameIndex::checkInvariants() const {
+    size_t counted = 0;
+    if (!checkNode(root, height, std::string_view(), std::string_view(), false, false, counted) ||
+        counted != entry_count) {
+        return false;
+    }
+    size_t listed = 0;
+    std::string_view previous;
+    for (Cursor cursor = begin(); cursor.valid(); cursor.next()) {
+        if (listed > 0 && !(previous < cursor.key())) {
+            return false;
+        }
+        previous = cursor.key();
+        ++listed;
+    }
+    return listed == entry_count;
+}
+
+// Спуск к листу, который содержит или должен содержать ключ
+uint32_t ServiceNameIndex::descend(std::string_view key, Path *path) const {
+    uint32_t node = root;
+    for (uint32_t level = height; level > 0; --level) {
+        const Inner &inner = inners[node];
+        auto keys_end = inner.keys.begin() + (inner.count - 1);
+        uint32_t child = static_cast<uint32_t>(std::upper_bound(inner.keys.begin(), keys_end, key) - inner.keys.begin());
+        if (path) {
+            path->emplace_back(node, child);
+        }
+        node = inner.children[child];
+    }
+    return node;
+}
+
+uint32_t ServiceNameIndex::allocateLeaf() {
+    if (!free_leaves.empty()) {
+        uint32_t id = free_leaves.back();
+        free_leaves.pop_back();
+        leaves[id] = Leaf();
+        return id;
+    }
+    leaves.emplace_back();
+    return static_cast<uint32_t>(leaves.size() - 1);
+}
+
+uint32_t ServiceNameIndex::allocateInner() {
+    if (!free_inners.empty()) {
+        uint32_t id = free_inners.back();
+        free_inners.pop_back();
+        inners[id] = Inner();
+        return id;
+    }
+    inners.emplace_back();
+    return static_cast<uint32_t>(inners.size() - 1);
+}
+
+// Вставка разделителя и правого ребенка после расщепления; при переполнении
+// узел делится, средний ключ поднимается выше
+void ServiceNameIndex::insertIntoParent(Path &path, std::string_view separator, uint32_t right_child) {
+    while (!path.empty()) {
+        auto [inner_id, child] = path.back();
+        path.pop_back();
+        Inner *inner = &inners[inner_id];
+
+        if (inner->count <= NODE_CAPACITY) {
+            std::copy_backward(inner->keys.begin() + child, inner->keys.begin() + inner->count - 1,
+                               inner->keys.begin() + inner->count);
+            std::copy_backward(inner->children.begin() + child + 1, inner->children.begin() + inner->count,
+                               inner->children.begin() + inner->count + 1);
+            inner->keys[child] = separator;
+            inner->children[child + 1] = right_child;
+            ++inner->count;
+            return;
+        }
+
+        // Полный узел: собираем ключи и детей с новым элементом и делим
+        std::array<std::string_view, NODE_CAPACITY + 1> keys;
+        std::array<uint32_t, NODE_CAPACITY + 2> children;
+        std::copy(inner->keys.begin(), inner->keys.begin() + child, keys.begin());
+        keys[child] = separator;
+        std::copy(inner->keys.begin() + child, inner->keys.end(), keys.begin() + child + 1);
+        std::copy(inner->children.begin(), inner->children.begin() + child + 1, children.begin());
+        children[child + 1] = right_child;
+        std::copy(inner->children.begin() + child + 1, inner->children.end(), children.begin() + child + 2);
+
+        uint32_t right_id = allocateInner();
+        inner = &inners[inner_id];
+        Inner &right = inners[right_id];
+        size_t total_children = NODE_CAPACITY + 2;
+        size_t left_children = total_children / 2;
+        inner->count = static_cast<uint32_t>(left_children);
+        right.count = static_cast<uint32_t>(total_children - left_children);
+        std::copy(children.begin(), children.begin() + left_children, inner->children.begin());
+        std::copy(keys.begin(), keys.begin() + left_children - 1, inner->keys.begin());
+        std::copy(children.begin() + left_children, children.end(), right.children.begin());
+        std::copy(keys.begin() + left_children, keys.end(), right.keys.begin());
+
+        separator = keys[left_children - 1];
+        right_child = right_id;
+    }
+
+    // Расщепился корень: дерево растет на уровень
+    uint32_t new_root = allocateInner();
+    Inner &inner = inners[new_root];
+    inner.count = 2;
+    inner.children[0] = root;
+    inner.children[1] = right_child;
+    inner.keys[0] = separator;
+    root = new_root;
+    ++height;
+}
+
+// Удаление ребенка path[level] из его узла; опустевшие узлы удаляются выше,
+// корень с единственным ребенком заменяется этим ребенком
+void ServiceNameIndex::removeChild(Path &path, size_t level) {
+    while (true) {
+        auto [inner_id, child] = path[level];
+        Inner &inner = inners[inner_id];
+        if (child > 0) {
+            std::copy(inner.keys.begin() + child, inner.keys.begin() + inner.count - 1,
+                      inner.keys.begin() + child - 1);
+        } else if (inner.count > 1) {
+            std::copy(inner.keys.begin() + 1, inner.keys.begin() + inner.count - 1, inner.keys.begin());
+        }
+        std::copy(inner.children.begin() + child + 1, inner.children.begin() + inner.count,
+                  inner.children.begin() + child);
+        --inner.count;
+
+        if (inner.count > 0 || level == 0) {
+            break;
+        }
+        free_inners.push_back(inner_id);
+        --level;
+    }
+
+    while (height > 0 && inners[root].count == 1) {
+        free_inners.push_back(root);
+        root = inners[root].children[0];
+        --height;
+    }
+}
+
+bool ServiceNameIndex::checkNode(uint32_t node, uint32_t level, std::string_view low, std::string_view high,
+                                 bool has_low, bool has_high, size_t &counted) const {
+    auto in_range = [&](std::string_view key) {
+        return (!has_low || !(key < low)) && (!has_high || key < high);
+    };
+    if (level == 0) {
+        const Leaf &leaf = leaves[node];
+        for (uint32_t i = 0; i < leaf.count; ++i) {
+            if (!in_range(leaf.keys[i]) || (i > 0 && !(leaf.keys[i - 1] < leaf.keys[i]))) {
+                return false;
+            }
+        }
+        counted += leaf.count;
+        return true;
+    }
+    const Inner &inner = inners[node];
+    if (inner.count == 0 || (node == root && inner.count < 2)) {
+        return false;
+    }
+    for (uint32_t i = 0; i < inner.count; ++i) {
+        bool child_has_low = i > 0 || has_low;
+        bool child_has_high = i + 1 < inner.count || has_high;
+        std::string_view child_low = i > 0 ? inner.keys[i - 1] : low;
+        std::string_view child_high = i + 1 < inner.count ? inner.keys[i] : high;
+        if (i + 1 < inner.count && !in_range(inner.keys[i])) {
+            return false;
+        }
+        if (!checkNode(inner.children[i], level - 1, child_low, child_high, child_has_low, child_has_high, counted)) {
+            return false;
+        }
+    }
+    return true;
+}
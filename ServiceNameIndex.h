@@ -0,0 +1,134 @@
+#ifndef IRONVAULT_MANAGER_SERVICENAMEINDEX_H
+#define IRONVAULT_MANAGER_SERVICENAMEINDEX_H
+
+#include <array>
+#include <cstdint>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+// Упорядоченный индекс имен сервисов: B+-дерево, ключ -> номер ячейки записи.
+// Узлы лежат в пулах-векторах и ссылаются друг на друга номерами, ключи
+// узла - сплошной массив string_view, листья связаны в список для
+// диапазонных обходов. Поиск, вставка и удаление - O(log n).
+// Ключи не копируются: они указывают на поле имени записи в арене хранилища,
+// поэтому после переноса записей в другую арену индекс перестраивается (build).
+// Удаление не сливает соседние узлы, только освобождает опустевшие;
+// перестроение снова упаковывает листья плотно.
+class ServiceNameIndex {
+public:
+    using Slot = uint32_t;
+
+    // Ключей в узле
+    static const size_t NODE_CAPACITY = 32;
+
+private:
+    static const uint32_t NO_NODE = 0xffffffffu;
+
+    struct Leaf {
+        uint32_t count = 0;
+        uint32_t prev = NO_NODE;
+        uint32_t next = NO_NODE;
+        std::array<std::string_view, NODE_CAPACITY> keys;
+        std::array<Slot, NODE_CAPACITY> slots;
+    };
+
+    // keys[i] - наименьший ключ поддерева children[i + 1]
+    struct Inner {
+        uint32_t count = 0; // число детей
+        std::array<std::string_view, NODE_CAPACITY> keys;
+        std::array<uint32_t, NODE_CAPACITY + 1> children;
+    };
+
+    // Путь от корня до листа: узел и номер ребенка в нем
+    using Path = std::vector<std::pair<uint32_t, uint32_t>>;
+
+    std::vector<Leaf> leaves;
+    std::vector<Inner> inners;
+    std::vector<uint32_t> free_leaves;
+    std::vector<uint32_t> free_inners;
+    uint32_t root;
+    uint32_t height; // 0 - корень является листом
+    uint32_t first_leaf;
+    size_t entry_count;
+
+public:
+    // Позиция в индексе; становится недействительной после изменения индекса
+    class Cursor {
+    private:
+        const ServiceNameIndex *index;
+        uint32_t leaf;
+        uint32_t position;
+
+        friend class ServiceNameIndex;
+
+        Cursor(const ServiceNameIndex *index, uint32_t leaf, uint32_t position);
+
+    public:
+        bool valid() const;
+
+        std::string_view key() const;
+
+        Slot slot() const;
+
+        void next();
+    };
+
+    // Конструкторы
+    ServiceNameIndex();
+
+    // Вставка; false, если ключ уже есть
+    bool insert(std::string_view key, Slot slot);
+
+    // Удаление; false, если ключа нет
+    bool erase(std::string_view key);
+
+    // Поиск ячейки по ключу
+    bool find(std::string_view key, Slot &slot) const;
+
+    bool contains(std::string_view key) const;
+
+    // Замена ячейки существующего ключа (запись переехала)
+    bool assign(std::string_view key, Slot slot);
+
+    // Построение с нуля из пар, отсортированных по ключу без повторов
+    void build(const std::vector<std::pair<std::string_view, Slot>> &sorted_entries);
+
+    void clear();
+
+    size_t size() const;
+
+    bool empty() const;
+
+    // Обход по порядку
+    Cursor begin() const;
+
+    // Первый ключ не меньше key
+    Cursor lowerBound(std::string_view key) const;
+
+    // Первый ключ больше key
+    Cursor upperBound(std::string_view key) const;
+
+    // Ячейки ключей с префиксом по порядку, не более limit (0 - без ограничения)
+    std::vector<Slot> prefixSlots(std::string_view prefix, size_t limit = 0) const;
+
+    // Проверка инвариантов дерева (для отладки)
+    bool checkInvariants() const;
+
+private:
+    uint32_t descend(std::string_view key, Path *path) const;
+
+    uint32_t allocateLeaf();
+
+    uint32_t allocateInner();
+
+    void insertIntoParent(Path &path, std::string_view separator, uint32_t right_child);
+
+    void removeChild(Path &path, size_t level);
+
+    bool checkNode(uint32_t node, uint32_t level, std::string_view low, std::string_view high,
+                   bool has_low, bool has_high, size_t &counted) const;
+};
+
+
+#endif //IRONVAULT_MANAGER_SERVICENAMEINDEX_H
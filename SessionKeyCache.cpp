@@ -0,0 +1,107 @@
+#include "SessionKeyCache.h"
+#include "DataEncryption.h"
+#include <openssl/evp.h>
+#include <openssl/hmac.h>
+#include <openssl/rand.h>
+#include <algorithm>
+#include <stdexcept>
+
+// Конструктор: секрет для тегов генерируется заново в каждом процессе
+SessionKeyCache::SessionKeyCache(std::chrono::seconds ttl, size_t max_entries)
+        : ttl(ttl), max_entries(max_entries), secret(32) {
+    if (max_entries == 0) {
+        throw std::invalid_argument("Key cache must hold at least one entry");
+    }
+    if (RAND_bytes(secret.data(), static_cast<int>(secret.size())) != 1) {
+        throw std::runtime_error("Failed to generate key cache secret");
+    }
+}
+
+// Ключ из кэша или новый
+secure_vector<unsigned char> SessionKeyCache::getOrDerive(std::string_view password,
+                                                          const std::vector<unsigned char> &salt) {
+    secure_vector<unsigned char> key;
+    if (lookup(password, salt, key)) {
+        return key;
+    }
+    // KDF вычисляется без блокировки: параллельные хранилища не ждут друг друга
+    key = DataEncryption::deriveKey(password, salt);
+    store(password, salt, key);
+    return key;
+}
+
+// Поиск ключа
+bool SessionKeyCache::lookup(std::string_view password, const std::vector<unsigned char> &salt,
+                             secure_vector<unsigned char> &key) {
+    Tag tag = makeTag(password, salt);
+    std::lock_guard<std::mutex> lock(mutex);
+    Clock::time_point now = Clock::now();
+
+    auto it = entries.find(tag);
+    if (it == entries.end()) {
+        return false;
+    }
+    if (it->second.expires_at <= now) {
+        entries.erase(it);
+        return false;
+    }
+    key = it->second.key;
+    return true;
+}
+
+// Сохранение ключа; при переполнении вытесняется ключ, истекающий раньше всех
+void SessionKeyCache::store(std::string_view password, const std::vector<unsigned char> &salt,
+                            const secure_vector<unsigned char> &key) {
+    Tag tag = makeTag(password, salt);
+    std::lock_guard<std::mutex> lock(mutex);
+    Clock::time_point now = Clock::now();
+
+    evictExpired(now);
+    if (entries.size() >= max_entries && entries.find(tag) == entries.end()) {
+        auto oldest = std::min_element(entries.begin(), entries.end(), [](const auto &a, const auto &b) {
+            return a.second.expires_at < b.second.expires_at;
+        });
+        entries.erase(oldest);
+    }
+    entries[tag] = Entry{key, now + ttl};
+}
+
+// Очистка кэша
+void SessionKeyCache::clear() {
+    std::lock_guard<std::mutex> lock(mutex);
+    entries.clear();
+}
+
+size_t SessionKeyCache::size() {
+    std::lock_guard<std::mutex> lock(mutex);
+    evictExpired(Clock::now());
+    return entries.size();
+}
+
+// Тег записи: HMAC-SHA256(секрет, длина соли | соль | пароль)
+SessionKeyCache::Tag SessionKeyCache::makeTag(std::string_view password,
+                                              const std::vector<unsigned char> &salt) const {
+    secure_vector<unsigned char> message;
+    message.reserve(1 + salt.size() + password.size());
+    message.push_back(static_cast<unsigned char>(salt.size()));
+    message.insert(message.end(), salt.begin(), salt.end());
+    message.insert(message.end(), password.begin(), password.end());
+
+    Tag tag{};
+    unsigned int length = 0;
+    if (!HMAC(EVP_sha256(), secret.data(), static_cast<int>(secret.size()),
+              message.data(), message.size(), tag.data(), &length)) {
+        throw std::runtime_error("Failed to compute key cache tag");
+    }
+    return tag;
+}
+
+void SessionKeyCache::evictExpired(Clock::time_point now) {
+    for (auto it = entries.begin(); it != entries.end();) {
+        if (it->second.expires_at <= now) {
+            it = entries.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
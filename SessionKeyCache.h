@@ -0,0 +1,70 @@
+#ifndef IRONVAULT_MANAGER_SESSIONKEYCACHE_H
+#define IRONVAULT_MANAGER_SESSIONKEYCACHE_H
+
+#include "SecureMemory.h"
+#include <array>
+#include <chrono>
+#include <map>
+#include <mutex>
+#include <string_view>
+#include <vector>
+
+// Кэш ключей хранилищ, выведенных из мастер-пароля, на время сессии.
+// Повторная разблокировка или сохранение того же хранилища с той же солью
+// не вычисляет PBKDF2 заново. Записи ищутся по HMAC(секрет процесса,
+// соль | пароль), сам пароль в кэше не хранится. Кэш потокобезопасен
+// и может разделяться несколькими хранилищами.
+class SessionKeyCache {
+public:
+    using Clock = std::chrono::steady_clock;
+
+private:
+    using Tag = std::array<unsigned char, 32>;
+
+    struct Entry {
+        secure_vector<unsigned char> key;
+        Clock::time_point expires_at;
+    };
+
+    std::mutex mutex;
+    std::map<Tag, Entry> entries;
+    std::chrono::seconds ttl;
+    size_t max_entries;
+    secure_vector<unsigned char> secret; // случайный ключ процесса для тегов
+
+public:
+    // Константы
+    static const size_t DEFAULT_MAX_ENTRIES = 64;
+    static const int DEFAULT_TTL_SECONDS = 15 * 60;
+
+    // Конструкторы
+    explicit SessionKeyCache(std::chrono::seconds ttl = std::chrono::seconds(DEFAULT_TTL_SECONDS),
+                             size_t max_entries = DEFAULT_MAX_ENTRIES);
+
+    SessionKeyCache(const SessionKeyCache &) = delete;
+
+    SessionKeyCache &operator=(const SessionKeyCache &) = delete;
+
+    // Ключ из кэша или вычисленный DataEncryption::deriveKey (и сохраненный)
+    secure_vector<unsigned char> getOrDerive(std::string_view password, const std::vector<unsigned char> &salt);
+
+    // Поиск без вычисления; true, если ключ найден и скопирован в key
+    bool lookup(std::string_view password, const std::vector<unsigned char> &salt,
+                secure_vector<unsigned char> &key);
+
+    void store(std::string_view password, const std::vector<unsigned char> &salt,
+               const secure_vector<unsigned char> &key);
+
+    // Удаление всех ключей (с обнулением)
+    void clear();
+
+    size_t size();
+
+private:
+    Tag makeTag(std::string_view password, const std::vector<unsigned char> &salt) const;
+
+    void evictExpired(Clock::time_point now);
+};
+
+
+#endif //IRONVAULT_MANAGER_SESSIONKEYCACHE_H
@@ -0,0 +1,189 @@
+#include "UnlockGate.h"
+#include <algorithm>
+#include <thread>
+
+// Настройки по умолчанию: половина ядер под KDF, задержка от 250 мс до минуты
+UnlockGate::Config::Config()
+        : max_concurrent_kdf(std::max(1u, std::thread::hardware_concurrency() / 2)),
+          base_delay(250),
+          max_delay(60000),
+          max_tracked_clients(4096) {}
+
+// Конструкторы
+UnlockGate::UnlockGate()
+        : UnlockGate(Config()) {}
+
+UnlockGate::UnlockGate(const Config &config)
+        : config(config), active_kdf(0) {
+    if (config.max_concurrent_kdf == 0) {
+        throw std::invalid_argument("At least one KDF worker is required");
+    }
+}
+
+// Попытка получить слот KDF
+UnlockGate::Permit UnlockGate::tryAcquire(const std::string &client_id) {
+    std::lock_guard<std::mutex> lock(mutex);
+    Clock::time_point now = Clock::now();
+
+    // Клиент еще в периоде ожидания после неудач
+    auto it = clients.find(client_id);
+    if (it != clients.end() && now < it->second.next_allowed) {
+        return Permit(nullptr, client_id, Decision::BackedOff, it->second.next_allowed - now);
+    }
+
+    // Все слоты заняты - отклоняем сразу, не ставя в очередь
+    if (active_kdf >= config.max_concurrent_kdf) {
+        return Permit(nullptr, client_id, Decision::Busy, config.base_delay);
+    }
+
+    ++active_kdf;
+    return Permit(this, client_id, Decision::Allowed, Clock::duration::zero());
+}
+
+// Проверка пароля с учетом ограничений
+bool UnlockGate::verify(const std::string &client_id, const PasswordVerifier &verifier, std::string_view password) {
+    Permit permit = tryAcquire(client_id);
+    if (!permit) {
+        throw UnlockRejectedError(permit.getDecision(), permit.getRetryAfter());
+    }
+
+    bool success = verifier.verify(password);
+    permit.recordResult(success);
+    return success;
+}
+
+// Сброс истории неудач клиента
+void UnlockGate::resetClient(const std::string &client_id) {
+    std::lock_guard<std::mutex> lock(mutex);
+    eraseClient(client_id);
+}
+
+// Статистика
+size_t UnlockGate::getActiveCount() {
+    std::lock_guard<std::mutex> lock(mutex);
+    return active_kdf;
+}
+
+size_t UnlockGate::getTrackedClientCount() {
+    std::lock_guard<std::mutex> lock(mutex);
+    return clients.size();
+}
+
+const UnlockGate::Config &UnlockGate::getConfig() const {
+    return config;
+}
+
+// Освобождение слота и учет результата
+void UnlockGate::release(const std::string &client_id, bool counted, bool has_result, bool success) {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (counted && active_kdf > 0) {
+        --active_kdf;
+    }
+    if (!has_result) {
+        return;
+    }
+
+    if (success) {
+        eraseClient(client_id);
+        return;
+    }
+
+    auto [it, inserted] = clients.try_emplace(client_id);
+    ClientState &state = it->second;
+    if (inserted) {
+        state.failures = 0;
+        state.lru_position = client_lru.insert(client_lru.begin(), client_id);
+    } else {
+        client_lru.splice(client_lru.begin(), client_lru, state.lru_position);
+    }
+    state.failures++;
+    state.next_allowed = Clock::now() + backoffFor(state.failures);
+
+    if (clients.size() > config.max_tracked_clients) {
+        evictOldestClients();
+    }
+}
+
+void UnlockGate::eraseClient(const std::string &client_id) {
+    auto it = clients.find(client_id);
+    if (it != clients.end()) {
+        client_lru.erase(it->second.lru_position);
+        clients.erase(it);
+    }
+}
+
+// Вытеснение клиентов с самой давней неудачей до предела таблицы.
+// Вытесненный клиент теряет задержку, но память и время под мьютексом
+// ограничены при любом потоке новых идентификаторов.
+void UnlockGate::evictOldestClients() {
+    while (clients.size() > config.max_tracked_clients && !client_lru.empty()) {
+        clients.erase(client_lru.back());
+        client_lru.pop_back();
+    }
+}
+
+// Экспоненциальная задержка: base * 2^(failures - 1), не больше max_delay
+UnlockGate::Clock::duration UnlockGate::backoffFor(unsigned failures) const {
+    if (failures == 0) {
+        return Clock::duration::zero();
+    }
+    unsigned shift = failures - 1 < MAX_BACKOFF_SHIFT ? failures - 1 : MAX_BACKOFF_SHIFT;
+    auto delay = config.base_delay * (1LL << shift);
+    return std::min<Clock::duration>(delay, config.max_delay);
+}
+
+// Permit
+UnlockGate::Permit::Permit(UnlockGate *owner, std::string client, Decision decision, Clock::duration retry_after)
+        : gate(owner), client_id(std::move(client)), decision(decision), retry_after(retry_after),
+          result_recorded(false) {}
+
+UnlockGate::Permit::Permit(Permit &&other) noexcept
+        : gate(other.gate), client_id(std::move(other.client_id)), decision(other.decision),
+          retry_after(other.retry_after), result_recorded(other.result_recorded) {
+    other.gate = nullptr;
+}
+
+UnlockGate::Permit::~Permit() {
+    if (gate && !result_recorded) {
+        gate->release(client_id, true, false, false);
+    }
+}
+
+bool UnlockGate::Permit::isGranted() const {
+    return decision == Decision::Allowed;
+}
+
+UnlockGate::Permit::operator bool() const {
+    return isGranted();
+}
+
+UnlockGate::Decision UnlockGate::Permit::getDecision() const {
+    return decision;
+}
+
+UnlockGate::Clock::duration UnlockGate::Permit::getRetryAfter() const {
+    return retry_after;
+}
+
+void UnlockGate::Permit::recordResult(bool success) {
+    if (!gate || result_recorded) {
+        return;
+    }
+    result_recorded = true;
+    gate->release(client_id, true, true, success);
+}
+
+// UnlockRejectedError
+UnlockRejectedError::UnlockRejectedError(UnlockGate::Decision decision, UnlockGate::Clock::duration retry_after)
+        : std::runtime_error(decision == UnlockGate::Decision::Busy
+                             ? "Unlock rejected: too many concurrent attempts"
+                             : "Unlock rejected: too many failed attempts, retry later"),
+          decision(decision), retry_after(retry_after) {}
+
+UnlockGate::Decision UnlockRejectedError::getDecision() const {
+    return decision;
+}
+
+UnlockGate::Clock::duration UnlockRejectedError::getRetryAfter() const {
+    return retry_after;
+}
@@ -0,0 +1,135 @@
+#ifndef IRONVAULT_MANAGER_UNLOCKGATE_H
+#define IRONVAULT_MANAGER_UNLOCKGATE_H
+
+#include "PasswordVerifier.h"
+#include <chrono>
+#include <list>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+// Ограничитель попыток разблокировки перед вычислением KDF.
+// Ограничивает число одновременных вычислений PBKDF2 и применяет
+// экспоненциальную задержку к клиентам после неудачных попыток.
+// Лишние попытки отклоняются сразу, без вычисления ключа.
+class UnlockGate {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    enum class Decision {
+        Allowed,   // попытка допущена
+        Busy,      // все слоты KDF заняты
+        BackedOff  // клиент еще ждет после неудачных попыток
+    };
+
+    struct Config {
+        size_t max_concurrent_kdf;
+        std::chrono::milliseconds base_delay;
+        std::chrono::milliseconds max_delay;
+        size_t max_tracked_clients;
+
+        Config();
+    };
+
+    // Разрешение на одну попытку; при разрушении освобождает слот KDF
+    class Permit {
+    private:
+        UnlockGate *gate;
+        std::string client_id;
+        Decision decision;
+        Clock::duration retry_after;
+        bool result_recorded;
+
+        friend class UnlockGate;
+
+        Permit(UnlockGate *owner, std::string client, Decision decision, Clock::duration retry_after);
+
+    public:
+        Permit(Permit &&other) noexcept;
+
+        Permit(const Permit &) = delete;
+
+        Permit &operator=(const Permit &) = delete;
+
+        Permit &operator=(Permit &&) = delete;
+
+        ~Permit();
+
+        bool isGranted() const;
+
+        explicit operator bool() const;
+
+        Decision getDecision() const;
+
+        Clock::duration getRetryAfter() const;
+
+        // Результат попытки: успех сбрасывает счетчик неудач клиента
+        void recordResult(bool success);
+    };
+
+private:
+    struct ClientState {
+        unsigned failures;
+        Clock::time_point next_allowed;
+        std::list<std::string>::iterator lru_position;
+    };
+
+    Config config;
+    std::mutex mutex;
+    size_t active_kdf;
+    std::unordered_map<std::string, ClientState> clients;
+    std::list<std::string> client_lru; // клиенты по давности последней неудачи, новые в начале
+
+    // Константы
+    static const unsigned MAX_BACKOFF_SHIFT = 20;
+
+public:
+    // Конструкторы
+    UnlockGate();
+
+    explicit UnlockGate(const Config &config);
+
+    // Попытка получить слот KDF для клиента (не блокирует)
+    Permit tryAcquire(const std::string &client_id);
+
+    // Проверка пароля через верификатор с учетом ограничений
+    bool verify(const std::string &client_id, const PasswordVerifier &verifier, std::string_view password);
+
+    // Сброс истории неудач клиента
+    void resetClient(const std::string &client_id);
+
+    // Статистика
+    size_t getActiveCount();
+
+    size_t getTrackedClientCount();
+
+    const Config &getConfig() const;
+
+private:
+    void release(const std::string &client_id, bool counted, bool has_result, bool success);
+
+    void eraseClient(const std::string &client_id);
+
+    void evictOldestClients();
+
+    Clock::duration backoffFor(unsigned failures) const;
+};
+
+// Исключение для отклоненной попытки разблокировки
+class UnlockRejectedError : public std::runtime_error {
+private:
+    UnlockGate::Decision decision;
+    UnlockGate::Clock::duration retry_after;
+
+public:
+    UnlockRejectedError(UnlockGate::Decision decision, UnlockGate::Clock::duration retry_after);
+
+    UnlockGate::Decision getDecision() const;
+
+    UnlockGate::Clock::duration getRetryAfter() const;
+};
+
+
+#endif //IRONVAULT_MANAGER_UNLOCKGATE_H
@@ -0,0 +1,260 @@
+#include "UrlIndex.h"
+#include "PublicSuffixList.h"
+#include <algorithm>
+#include <cctype>
+#include <openssl/crypto.h>
+
+namespace {
+    const uint32_t NO_NODE = 0xffffffffu;
+
+    bool isHostChar(unsigned char c) {
+        return (c >= 'a' && c <= 'z') || (c >= '0' && c <= '9') || c == '-' || c == '.' || c == '_' || c >= 0x80;
+    }
+}
+
+// Конструктор
+UrlIndex::UrlIndex()
+        : entry_count(0) {
+    clear();
+}
+
+// Нормализация адреса до хоста
+bool UrlIndex::normalize(std::string_view url, NormalizedUrl &out) {
+    if (!parseHost(url, out.host, out.is_ip)) {
+        return false;
+    }
+    out.registrable.assign(out.is_ip ? std::string_view() : registrableDomain(out.host));
+    return true;
+}
+
+// Хост без регистрируемого домена: для вставки и удаления его не нужно вычислять
+bool UrlIndex::parseHost(std::string_view url, std::string &out_host, bool &is_ip) {
+    auto not_space = [](unsigned char c) { return !std::isspace(c); };
+    while (!url.empty() && !not_space(url.front())) url.remove_prefix(1);
+    while (!url.empty() && !not_space(url.back())) url.remove_suffix(1);
+
+    size_t scheme_end = url.find("://");
+    if (scheme_end != std::string_view::npos) {
+        url.remove_prefix(scheme_end + 3);
+    }
+    std::string_view authority = url.substr(0, url.find_first_of("/?#"));
+    size_t at = authority.rfind('@');
+    if (at != std::string_view::npos) {
+        authority.remove_prefix(at + 1);
+    }
+
+    std::string_view host = authority;
+    is_ip = false;
+    if (!host.empty() && host.front() == '[') {
+        // IPv6 в скобках
+        size_t close = host.find(']');
+        if (close == std::string_view::npos) {
+            return false;
+        }
+        host = host.substr(1, close - 1);
+        is_ip = true;
+    } else {
+        size_t colon = host.rfind(':');
+        if (colon != std::string_view::npos) {
+            std::string_view port = host.substr(colon + 1);
+            if (!std::all_of(port.begin(), port.end(), [](char c) { return c >= '0' && c <= '9'; })) {
+                return false;
+            }
+            host = host.substr(0, colon);
+        }
+    }
+    while (!host.empty() && host.back() == '.') {
+        host.remove_suffix(1);
+    }
+    if (host.empty()) {
+        return false;
+    }
+
+    out_host.assign(host);
+    for (char &c: out_host) {
+        c = static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+    }
+    if (!is_ip) {
+        if (!std::all_of(out_host.begin(), out_host.end(), [](char c) { return isHostChar(static_cast<unsigned char>(c)); }) ||
+            out_host.front() == '.' || out_host.find("..") != std::string::npos) {
+            return false;
+        }
+        // IPv4: четыре числовые метки
+        is_ip = std::count(out_host.begin(), out_host.end(), '.') == 3 &&
+                std::all_of(out_host.begin(), out_host.end(), [](char c) { return c == '.' || (c >= '0' && c <= '9'); });
+    }
+    return true;
+}
+
+// eTLD+1: публичный суффикс и еще одна метка
+std::string_view UrlIndex::registrableDomain(std::string_view host) {
+    std::string_view suffix = PublicSuffixList::publicSuffix(host);
+    if (suffix.empty() || suffix.size() >= host.size()) {
+        return {};
+    }
+    size_t suffix_dot = host.size() - suffix.size() - 1;
+    size_t previous = suffix_dot == 0 ? std::string_view::npos : host.rfind('.', suffix_dot - 1);
+    return host.substr(previous == std::string_view::npos ? 0 : previous + 1);
+}
+
+// Добавление записи; повторы не проверяются - за уникальность пары
+// отвечает вызывающий (у записи хранилища одна запись индекса)
+bool UrlIndex::insert(std::string_view url, std::string_view service_name) {
+    std::string host;
+    bool is_ip = false;
+    if (!parseHost(url, host, is_ip)) {
+        return false;
+    }
+    uint32_t node = 0;
+    for (std::string_view rest = host; !rest.empty();) {
+        size_t dot = rest.rfind('.');
+        node = findOrAddChild(node, dot == std::string_view::npos ? rest : rest.substr(dot + 1));
+        rest = rest.substr(0, dot == std::string_view::npos ? 0 : dot);
+    }
+    nodes[node].service_names.push_back(service_name);
+    ++entry_count;
+    return true;
+}
+
+// Удаление записи; опустевшие узлы остаются до очистки индекса
+bool UrlIndex::erase(std::string_view url, std::string_view service_name) {
+    std::string host;
+    bool is_ip = false;
+    if (!parseHost(url, host, is_ip)) {
+        return false;
+    }
+    uint32_t node = findHostNode(host);
+    if (node == NO_NODE) {
+        return false;
+    }
+    auto &names = nodes[node].service_names;
+    auto it = std::find(names.begin(), names.end(), service_name);
+    if (it == names.end()) {
+        return false;
+    }
+    names.erase(it);
+    --entry_count;
+    return true;
+}
+
+// Очистка; метки хостов обнуляются
+void UrlIndex::clear() {
+    for (auto &node: nodes) {
+        for (auto &child: node.children) {
+            OPENSSL_cleanse(child.first.data(), child.first.size());
+        }
+    }
+    nodes.assign(1, Node());
+    entry_count = 0;
+}
+
+size_t UrlIndex::size() const {
+    return entry_count;
+}
+
+// Поиск по адресу страницы
+std::vector<std::pair<std::string_view, UrlMatchKind>> UrlIndex::find(std::string_view url, size_t limit) const {
+    std::vector<std::pair<std::string_view, UrlMatchKind>> matches;
+    NormalizedUrl normalized;
+    if (!normalize(url, normalized)) {
+        return matches;
+    }
+    auto full = [&]() { return limit && matches.size() >= limit; };
+
+    // Путь по меткам страницы: path[d] - узел на глубине d + 1
+    std::vector<std::string_view> labels = reversedLabels(normalized.host);
+    std::vector<uint32_t> path;
+    uint32_t node = 0;
+    for (std::string_view label: labels) {
+        node = findChild(node, label);
+        if (node == NO_NODE) {
+            break;
+        }
+        path.push_back(node);
+    }
+
+    // Для IP и хостов без регистрируемого домена - только точный хост
+    size_t site_depth = normalized.registrable.empty() ? labels.size()
+                                                       : reversedLabels(normalized.registrable).size();
+    if (path.size() < site_depth) {
+        return matches;
+    }
+
+    if (path.size() == labels.size()) {
+        for (std::string_view name: nodes[path.back()].service_names) {
+            if (full()) return matches;
+            matches.emplace_back(name, UrlMatchKind::ExactHost);
+        }
+    }
+    for (size_t depth = std::min(path.size(), labels.size() - 1); depth >= site_depth && depth > 0; --depth) {
+        for (std::string_view name: nodes[path[depth - 1]].service_names) {
+            if (full()) return matches;
+            matches.emplace_back(name, UrlMatchKind::Subdomain);
+        }
+    }
+    if (normalized.registrable.empty()) {
+        return matches;
+    }
+
+    // Остальное поддерево регистрируемого домена; узлы пути уже выданы
+    std::vector<uint32_t> stack{path[site_depth - 1]};
+    while (!stack.empty()) {
+        uint32_t current = stack.back();
+        stack.pop_back();
+        if (std::find(path.begin() + static_cast<ptrdiff_t>(site_depth - 1), path.end(), current) == path.end()) {
+            for (std::string_view name: nodes[current].service_names) {
+                if (full()) return matches;
+                matches.emplace_back(name, UrlMatchKind::RegistrableDomain);
+            }
+        }
+        for (auto it = nodes[current].children.rbegin(); it != nodes[current].children.rend(); ++it) {
+            stack.push_back(it->second);
+        }
+    }
+    return matches;
+}
+
+std::vector<std::string_view> UrlIndex::reversedLabels(std::string_view host) {
+    std::vector<std::string_view> labels;
+    while (!host.empty()) {
+        size_t dot = host.rfind('.');
+        if (dot == std::string_view::npos) {
+            labels.push_back(host);
+            break;
+        }
+        labels.push_back(host.substr(dot + 1));
+        host = host.substr(0, dot);
+    }
+    return labels;
+}
+
+uint32_t UrlIndex::findChild(uint32_t node, std::string_view label) const {
+    const auto &children = nodes[node].children;
+    auto it = std::lower_bound(children.begin(), children.end(), label,
+                               [](const auto &child, std::string_view key) { return child.first < key; });
+    return it != children.end() && it->first == label ? it->second : NO_NODE;
+}
+
+uint32_t UrlIndex::findOrAddChild(uint32_t node, std::string_view label) {
+    uint32_t child = findChild(node, label);
+    if (child != NO_NODE) {
+        return child;
+    }
+    child = static_cast<uint32_t>(nodes.size());
+    nodes.emplace_back();
+    auto &children = nodes[node].children;
+    auto it = std::lower_bound(children.begin(), children.end(), label,
+                               [](const auto &entry, std::string_view key) { return entry.first < key; });
+    children.emplace(it, std::string(label), child);
+    return child;
+}
+
+uint32_t UrlIndex::findHostNode(std::string_view host) const {
+    uint32_t node = 0;
+    for (std::string_view rest = host; !rest.empty() && node != NO_NODE;) {
+        size_t dot = rest.rfind('.');
+        node = findChild(node, dot == std::string_view::npos ? rest : rest.substr(dot + 1));
+        rest = rest.substr(0, dot == std::string_view::npos ? 0 : dot);
+    }
+    return node;
+}
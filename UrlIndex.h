@@ -0,0 +1,83 @@
+#ifndef IRONVAULT_MANAGER_URLINDEX_H
+#define IRONVAULT_MANAGER_URLINDEX_H
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+// Насколько адрес записи совпадает с адресом страницы
+enum class UrlMatchKind {
+    ExactHost,        // тот же хост
+    Subdomain,        // страница - поддомен хоста записи (login.example.com для example.com)
+    RegistrableDomain // общий регистрируемый домен (eTLD+1), другой поддомен
+};
+
+// Адрес, сведенный к хосту
+struct NormalizedUrl {
+    std::string host;         // в нижнем регистре, без порта, учетных данных и точки в конце
+    std::string registrable;  // eTLD+1; пусто для IP-адресов, публичных и неизвестных суффиксов
+    bool is_ip;
+};
+
+// Индекс адресов записей для автозаполнения.
+// Хосты хранятся в trie по меткам справа налево (com -> example -> login),
+// поэтому все кандидаты для страницы лежат на одном пути и в одном поддереве
+// регистрируемого домена: поиск не зависит от числа записей в хранилище.
+// Выше регистрируемого домена поиск не поднимается - "evil.com" не совпадает
+// с "example.com", а "evil.co.th" с "bank.co.th". Хост с суффиксом не из
+// списка совпадает только с тем же хостом.
+// Значения - имена сервисов (string_view на поле записи в арене хранилища).
+class UrlIndex {
+private:
+    struct Node {
+        std::vector<std::pair<std::string, uint32_t>> children; // по метке, отсортированы
+        std::vector<std::string_view> service_names;
+    };
+
+    std::vector<Node> nodes; // nodes[0] - корень
+    size_t entry_count;
+
+public:
+    // Конструкторы
+    UrlIndex();
+
+    // Разбор адреса ("https://user@Login.Example.com:8443/path", "example.com/x");
+    // false - хоста нет или он некорректен
+    static bool normalize(std::string_view url, NormalizedUrl &out);
+
+    // Регистрируемый домен по встроенному Public Suffix List; пустой, если
+    // хост сам является суффиксом или его суффикса нет в списке
+    static std::string_view registrableDomain(std::string_view host);
+
+    // Добавление и удаление записи; адреса без хоста не индексируются.
+    // Одна и та же пара не добавляется дважды (не проверяется).
+    bool insert(std::string_view url, std::string_view service_name);
+
+    bool erase(std::string_view url, std::string_view service_name);
+
+    void clear();
+
+    size_t size() const;
+
+    // Имена сервисов для страницы: точный хост, затем родительские домены
+    // от ближнего к дальнему, затем остальные хосты того же регистрируемого
+    // домена; limit == 0 - без ограничения
+    std::vector<std::pair<std::string_view, UrlMatchKind>> find(std::string_view url, size_t limit = 0) const;
+
+private:
+    static bool parseHost(std::string_view url, std::string &out_host, bool &is_ip);
+
+    // Метки хоста справа налево
+    static std::vector<std::string_view> reversedLabels(std::string_view host);
+
+    uint32_t findChild(uint32_t node, std::string_view label) const;
+
+    uint32_t findOrAddChild(uint32_t node, std::string_view label);
+
+    uint32_t findHostNode(std::string_view host) const;
+};
+
+
+#endif //IRONVAULT_MANAGER_URLINDEX_H
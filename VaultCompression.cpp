@@ -0,0 +1,201 @@
+#include "VaultCompression.h"
+#include "VaultTrace.h"
+#include <stdexcept>
+#include <string>
+
+#ifdef IRONVAULT_HAVE_ZLIB
+#include <zlib.h>
+#endif
+#ifdef IRONVAULT_HAVE_ZSTD
+#include <zstd.h>
+#endif
+
+namespace {
+#ifdef IRONVAULT_HAVE_ZLIB
+    const int ZLIB_LEVEL = 6;
+#endif
+#ifdef IRONVAULT_HAVE_ZSTD
+    const int ZSTD_LEVEL = 3;
+#endif
+}
+
+// Имя кодека
+const char *VaultCompression::codecName(Codec codec) {
+    switch (codec) {
+        case Codec::Zlib:
+            return "zlib";
+        case Codec::Zstd:
+            return "zstd";
+        case Codec::None:
+        default:
+            return "none";
+    }
+}
+
+VaultCompression::Codec VaultCompression::parseCodec(std::string_view name) {
+    if (name == "none") {
+        return Codec::None;
+    }
+    if (name == "zlib") {
+        return Codec::Zlib;
+    }
+    if (name == "zstd") {
+        return Codec::Zstd;
+    }
+    throw std::runtime_error("Unknown compression codec: " + std::string(name));
+}
+
+bool VaultCompression::isAvailable(Codec codec) {
+    switch (codec) {
+        case Codec::None:
+            return true;
+        case Codec::Zlib:
+#ifdef IRONVAULT_HAVE_ZLIB
+            return true;
+#else
+            return false;
+#endif
+        case Codec::Zstd:
+#ifdef IRONVAULT_HAVE_ZSTD
+            return true;
+#else
+            return false;
+#endif
+    }
+    return false;
+}
+
+// Сжатие
+secure_string VaultCompression::compress(Codec codec, std::string_view data) {
+    ensureAvailable(codec);
+    IRONVAULT_TRACE_SPAN_ARG("compression.compress", "bytes", data.size());
+
+    switch (codec) {
+        case Codec::None:
+            return secure_string(data);
+
+#ifdef IRONVAULT_HAVE_ZLIB
+        case Codec::Zlib: {
+            uLongf length = compressBound(static_cast<uLong>(data.size()));
+            secure_string result(length, '\0');
+            if (compress2(reinterpret_cast<Bytef *>(result.data()), &length,
+                          reinterpret_cast<const Bytef *>(data.data()), static_cast<uLong>(data.size()),
+                          ZLIB_LEVEL) != Z_OK) {
+                throw std::runtime_error("Failed to compress data");
+            }
+            result.resize(length);
+            return result;
+        }
+#endif
+
+#ifdef IRONVAULT_HAVE_ZSTD
+        case Codec::Zstd: {
+            secure_string result(ZSTD_compressBound(data.size()), '\0');
+            size_t length = ZSTD_compress(result.data(), result.size(), data.data(), data.size(), ZSTD_LEVEL);
+            if (ZSTD_isError(length)) {
+                throw std::runtime_error(std::string("Failed to compress data: ") + ZSTD_getErrorName(length));
+            }
+            result.resize(length);
+            return result;
+        }
+#endif
+
+        default:
+            throw std::runtime_error("Compression codec is not available");
+    }
+}
+
+// Потоковая распаковка кусками STREAM_CHUNK_SIZE
+void VaultCompression::decompress(Codec codec, std::string_view data,
+                                  const std::function<void(std::string_view)> &sink) {
+    ensureAvailable(codec);
+    IRONVAULT_TRACE_SPAN_ARG("compression.decompress", "bytes", data.size());
+
+    if (codec == Codec::None) {
+        for (size_t offset = 0; offset < data.size(); offset += STREAM_CHUNK_SIZE) {
+            sink(data.substr(offset, STREAM_CHUNK_SIZE));
+        }
+        return;
+    }
+
+    secure_vector<char> chunk(STREAM_CHUNK_SIZE);
+
+#ifdef IRONVAULT_HAVE_ZLIB
+    if (codec == Codec::Zlib) {
+        z_stream stream{};
+        if (inflateInit(&stream) != Z_OK) {
+            throw std::runtime_error("Failed to initialize decompression");
+        }
+        stream.next_in = reinterpret_cast<Bytef *>(const_cast<char *>(data.data()));
+        stream.avail_in = static_cast<uInt>(data.size());
+
+        int status = Z_OK;
+        try {
+            while (status != Z_STREAM_END) {
+                stream.next_out = reinterpret_cast<Bytef *>(chunk.data());
+                stream.avail_out = static_cast<uInt>(chunk.size());
+                status = inflate(&stream, Z_NO_FLUSH);
+                if (status != Z_OK && status != Z_STREAM_END) {
+                    throw std::runtime_error("Failed to decompress data - corrupted stream");
+                }
+                size_t produced = chunk.size() - stream.avail_out;
+                if (produced == 0 && status != Z_STREAM_END) {
+                    throw std::runtime_error("Failed to decompress data - truncated stream");
+                }
+                if (produced > 0) {
+                    sink(std::string_view(chunk.data(), produced));
+                }
+            }
+        } catch (...) {
+            inflateEnd(&stream);
+            throw;
+        }
+        inflateEnd(&stream);
+        if (stream.avail_in != 0) {
+            throw std::runtime_error("Unexpected data after compressed stream");
+        }
+        return;
+    }
+#endif
+
+#ifdef IRONVAULT_HAVE_ZSTD
+    if (codec == Codec::Zstd) {
+        ZSTD_DCtx *context = ZSTD_createDCtx();
+        if (!context) {
+            throw std::runtime_error("Failed to initialize decompression");
+        }
+        ZSTD_inBuffer input{data.data(), data.size(), 0};
+        size_t remaining = 1;
+        try {
+            while (input.pos < input.size || remaining != 0) {
+                ZSTD_outBuffer output{chunk.data(), chunk.size(), 0};
+                remaining = ZSTD_decompressStream(context, &output, &input);
+                if (ZSTD_isError(remaining)) {
+                    throw std::runtime_error(std::string("Failed to decompress data: ") +
+                                             ZSTD_getErrorName(remaining));
+                }
+                if (output.pos == 0 && input.pos == input.size && remaining != 0) {
+                    throw std::runtime_error("Failed to decompress data - truncated stream");
+                }
+                if (output.pos > 0) {
+                    sink(std::string_view(chunk.data(), output.pos));
+                }
+            }
+        } catch (...) {
+            ZSTD_freeDCtx(context);
+            throw;
+        }
+        ZSTD_freeDCtx(context);
+        return;
+    }
+#endif
+
+    throw std::runtime_error("Compression codec is not available");
+}
+
+void VaultCompression::ensureAvailable(Codec codec) {
+    if (!isAvailable(codec)) {
+        throw std::runtime_error(std::string("Compression codec is not available in this build: ") +
+                                 codecName(codec));
+    }
+}
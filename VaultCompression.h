@@ -0,0 +1,44 @@
+#ifndef IRONVAULT_MANAGER_VAULTCOMPRESSION_H
+#define IRONVAULT_MANAGER_VAULTCOMPRESSION_H
+
+#include "SecureMemory.h"
+#include <functional>
+#include <string_view>
+
+// Сжатие сегментов хранилища перед шифрованием.
+// Сжимается только сегмент категории целиком, никогда отдельная запись:
+// размер сжатой записи раскрывал бы сведения о ее содержимом.
+// Кодеки подключаются при сборке: IRONVAULT_HAVE_ZLIB, IRONVAULT_HAVE_ZSTD.
+class VaultCompression {
+public:
+    enum class Codec {
+        None,
+        Zlib,
+        Zstd
+    };
+
+    // Размер куска потоковой распаковки
+    static const size_t STREAM_CHUNK_SIZE = 64 * 1024;
+
+    // Имя кодека в заголовке файла и обратно
+    static const char *codecName(Codec codec);
+
+    static Codec parseCodec(std::string_view name);
+
+    // Кодек собран в эту программу
+    static bool isAvailable(Codec codec);
+
+    // Сжатие в защищенную память
+    static secure_string compress(Codec codec, std::string_view data);
+
+    // Потоковая распаковка: sink получает последовательные куски до
+    // STREAM_CHUNK_SIZE байт; буфер куска переиспользуется и обнуляется
+    static void decompress(Codec codec, std::string_view data,
+                           const std::function<void(std::string_view)> &sink);
+
+private:
+    static void ensureAvailable(Codec codec);
+};
+
+
+#endif //IRONVAULT_MANAGER_VAULTCOMPRESSION_H
@@ -0,0 +1,85 @@
+#include "VaultExecutor.h"
+#include "ParallelRunner.h"
+#include <stdexcept>
+
+// Общий исполнитель создается при первом асинхронном вызове
+std::shared_ptr<VaultExecutor> VaultExecutor::shared() {
+    static std::shared_ptr<VaultExecutor> instance = std::make_shared<PooledVaultExecutor>();
+    return instance;
+}
+
+// Конструктор
+PooledVaultExecutor::PooledVaultExecutor(size_t cpu_threads, size_t io_threads) {
+    if (io_threads == 0) {
+        throw std::invalid_argument("I/O pool needs at least one thread");
+    }
+    startPool(cpu_pool, cpu_threads ? cpu_threads : ParallelRunner::defaultThreadCount());
+    startPool(io_pool, io_threads);
+}
+
+// Деструктор
+PooledVaultExecutor::~PooledVaultExecutor() {
+    stopPool(cpu_pool);
+    stopPool(io_pool);
+}
+
+// Постановка работы в пул вида kind
+void PooledVaultExecutor::execute(VaultWork kind, std::function<void()> work) {
+    if (kind == VaultWork::Completion) {
+        work();
+        return;
+    }
+    Pool &pool = kind == VaultWork::Cpu ? cpu_pool : io_pool;
+    {
+        std::lock_guard<std::mutex> lock(pool.mutex);
+        if (pool.stopping) {
+            throw std::runtime_error("Executor is shutting down");
+        }
+        pool.queue.push_back(std::move(work));
+    }
+    pool.ready.notify_one();
+}
+
+size_t PooledVaultExecutor::getCpuThreadCount() const {
+    return cpu_pool.threads.size();
+}
+
+size_t PooledVaultExecutor::getIoThreadCount() const {
+    return io_pool.threads.size();
+}
+
+void PooledVaultExecutor::startPool(Pool &pool, size_t thread_count) {
+    pool.threads.reserve(thread_count);
+    for (size_t i = 0; i < thread_count; ++i) {
+        pool.threads.emplace_back([&pool] { runWorker(pool); });
+    }
+}
+
+void PooledVaultExecutor::stopPool(Pool &pool) {
+    {
+        std::lock_guard<std::mutex> lock(pool.mutex);
+        pool.stopping = true;
+    }
+    pool.ready.notify_all();
+    for (auto &thread : pool.threads) {
+        thread.join();
+    }
+    pool.threads.clear();
+}
+
+// Цикл потока пула: задачи по очереди, после остановки - до опустошения очереди
+void PooledVaultExecutor::runWorker(Pool &pool) {
+    for (;;) {
+        std::function<void()> work;
+        {
+            std::unique_lock<std::mutex> lock(pool.mutex);
+            pool.ready.wait(lock, [&pool] { return pool.stopping || !pool.queue.empty(); });
+            if (pool.queue.empty()) {
+                return;
+            }
+            work = std::move(pool.queue.front());
+            pool.queue.pop_front();
+        }
+        work();
+    }
+}
@@ -0,0 +1,97 @@
+#ifndef IRONVAULT_MANAGER_VAULTEXECUTOR_H
+#define IRONVAULT_MANAGER_VAULTEXECUTOR_H
+
+#include <condition_variable>
+#include <coroutine>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Вид работы асинхронного вызова хранилища
+enum class VaultWork {
+    Cpu,        // KDF, шифрование, разбор, поиск
+    Io,         // чтение и запись файлов
+    Completion  // продолжение вызывающего после завершения вызова
+};
+
+// Исполнитель асинхронных вызовов CredentialVault. Цикл событий GUI или
+// агента подставляет свой исполнитель, чтобы, например, направлять
+// Completion в поток цикла, а Cpu и Io - в свои пулы.
+class VaultExecutor {
+public:
+    virtual ~VaultExecutor() = default;
+
+    // Выполнение work в контексте kind; может выполнить сразу в вызывающем потоке
+    virtual void execute(VaultWork kind, std::function<void()> work) = 0;
+
+    // co_await executor.schedule(kind) - продолжение сопрограммы в контексте kind
+    auto schedule(VaultWork kind) {
+        struct Awaiter {
+            VaultExecutor &executor;
+            VaultWork kind;
+
+            bool await_ready() const noexcept { return false; }
+
+            void await_suspend(std::coroutine_handle<> coroutine) {
+                executor.execute(kind, [coroutine] { coroutine.resume(); });
+            }
+
+            void await_resume() const noexcept {}
+        };
+        return Awaiter{*this, kind};
+    }
+
+    // Общий исполнитель процесса (PooledVaultExecutor по умолчанию)
+    static std::shared_ptr<VaultExecutor> shared();
+};
+
+// Исполнитель с двумя пулами потоков: Cpu - по числу ядер, Io - несколько
+// потоков, чтобы медленный диск не занимал потоки KDF. Completion
+// выполняется сразу в потоке, завершившем вызов.
+// Деструктор выполняет оставшиеся задачи и останавливает потоки.
+class PooledVaultExecutor : public VaultExecutor {
+private:
+    struct Pool {
+        std::mutex mutex;
+        std::condition_variable ready;
+        std::deque<std::function<void()>> queue;
+        std::vector<std::thread> threads;
+        bool stopping = false;
+    };
+
+    Pool cpu_pool;
+    Pool io_pool;
+
+public:
+    // Константы
+    static const size_t DEFAULT_IO_THREADS = 2;
+
+    // Конструкторы; cpu_threads == 0 - по числу ядер
+    explicit PooledVaultExecutor(size_t cpu_threads = 0, size_t io_threads = DEFAULT_IO_THREADS);
+
+    ~PooledVaultExecutor() override;
+
+    PooledVaultExecutor(const PooledVaultExecutor &) = delete;
+
+    PooledVaultExecutor &operator=(const PooledVaultExecutor &) = delete;
+
+    void execute(VaultWork kind, std::function<void()> work) override;
+
+    size_t getCpuThreadCount() const;
+
+    size_t getIoThreadCount() const;
+
+private:
+    static void startPool(Pool &pool, size_t thread_count);
+
+    static void stopPool(Pool &pool);
+
+    static void runWorker(Pool &pool);
+};
+
+
+#endif //IRONVAULT_MANAGER_VAULTEXECUTOR_H
@@ -0,0 +1,625 @@
+#include "VaultFileIO.h"
+#include "VaultTrace.h"
+#include <atomic>
+#include <filesystem>
+#include <stdexcept>
+#include <system_error>
+
+#ifdef _WIN32
+#include <fstream>
+#include <sstream>
+#else
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <memory>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#if defined(IRONVAULT_HAVE_IO_URING) && defined(__linux__)
+#define IRONVAULT_USE_IO_URING
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#endif
+#endif
+
+namespace {
+    std::atomic<bool> io_uring_enabled(true);
+
+#ifndef _WIN32
+    // Порция чтения одного запроса
+    const size_t READ_CHUNK = 4 * 1024 * 1024;
+
+    [[noreturn]] void throwError(const std::string &what, const std::string &path, int error) {
+        throw std::runtime_error(what + " " + path + ": " + std::generic_category().message(error));
+    }
+
+    // Дочитывание файла с offset до конца: после короткого чтения или если файл вырос
+    void readRest(int fd, std::string &data, size_t offset, const std::string &path) {
+        char probe[4096];
+        for (;;) {
+            bool at_end = offset == data.size();
+            char *target = at_end ? probe : data.data() + offset;
+            size_t length = at_end ? sizeof(probe) : data.size() - offset;
+            ssize_t count = ::pread(fd, target, length, static_cast<off_t>(offset));
+            if (count < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                throwError("Failed to read", path, errno);
+            }
+            if (count == 0) {
+                data.resize(offset);
+                return;
+            }
+            if (at_end) {
+                data.append(probe, static_cast<size_t>(count));
+            }
+            offset += static_cast<size_t>(count);
+        }
+    }
+
+    // Запись одного файла: какие шаги уже выполнены
+    struct PendingWrite {
+        const VaultFileIO::FileWrite *file;
+        std::string temp_path;
+        int fd = -1;
+        int dir_fd = -1;
+        size_t written = 0;
+        bool synced = false;
+        bool closed = false;
+        bool renamed = false;
+        int error = 0; // первая ошибка шага io_uring
+        const char *error_step = nullptr;
+    };
+
+    void openPending(PendingWrite &pending, bool durable) {
+        pending.temp_path = pending.file->path + ".tmp";
+        pending.fd = ::open(pending.temp_path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0600);
+        if (pending.fd < 0) {
+            throwError("Failed to create", pending.temp_path, errno);
+        }
+        if (durable) {
+            std::string parent = std::filesystem::path(pending.file->path).parent_path().string();
+            pending.dir_fd = ::open(parent.empty() ? "." : parent.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+        }
+    }
+
+    // Ошибка: временный файл удаляется, дескрипторы закрываются
+    void abandon(PendingWrite &pending) {
+        if (pending.fd >= 0 && !pending.closed) {
+            ::close(pending.fd);
+            pending.closed = true;
+        }
+        if (!pending.renamed && !pending.temp_path.empty()) {
+            ::unlink(pending.temp_path.c_str());
+        }
+        if (pending.dir_fd >= 0) {
+            ::close(pending.dir_fd);
+            pending.dir_fd = -1;
+        }
+    }
+
+    // Оставшиеся шаги обычными вызовами; fsync каталога - по возможности
+    void finishPosix(PendingWrite &pending, bool durable) {
+        std::string_view data = pending.file->data;
+        while (pending.written < data.size()) {
+            ssize_t count = ::pwrite(pending.fd, data.data() + pending.written, data.size() - pending.written,
+                                     static_cast<off_t>(pending.written));
+            if (count < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                throwError("Failed to write", pending.temp_path, errno);
+            }
+            pending.written += static_cast<size_t>(count);
+        }
+        if (durable && !pending.synced) {
+            if (::fsync(pending.fd) != 0) {
+                throwError("Failed to sync", pending.temp_path, errno);
+            }
+            pending.synced = true;
+        }
+        if (!pending.closed) {
+            pending.closed = true;
+            if (::close(pending.fd) != 0) {
+                throwError("Failed to close", pending.temp_path, errno);
+            }
+        }
+        if (!pending.renamed) {
+            if (::rename(pending.temp_path.c_str(), pending.file->path.c_str()) != 0) {
+                throwError("Failed to replace", pending.file->path, errno);
+            }
+            pending.renamed = true;
+        }
+        if (pending.dir_fd >= 0) {
+            ::fsync(pending.dir_fd);
+            ::close(pending.dir_fd);
+            pending.dir_fd = -1;
+        }
+    }
+
+#ifdef IRONVAULT_USE_IO_URING
+    // Кольцо io_uring без liburing: системные вызовы и разделяемые очереди
+    class IoRing {
+    public:
+        static const unsigned ENTRIES = 64;
+
+        // Кольцо потока; nullptr, если io_uring недоступен или отключен.
+        // После сбоя io_uring_enter кольцо закрывается, и все потоки
+        // переходят на обычные вызовы
+        static IoRing *forThread() {
+            static std::atomic<bool> unavailable(false);
+            thread_local std::unique_ptr<IoRing> ring;
+            thread_local bool tried = false;
+            if (ring && ring->broken) {
+                ring.reset();
+                unavailable = true;
+            }
+            if (!io_uring_enabled.load(std::memory_order_relaxed) || unavailable.load(std::memory_order_relaxed)) {
+                return nullptr;
+            }
+            if (!tried) {
+                tried = true;
+                auto created = std::make_unique<IoRing>();
+                if (created->setup()) {
+                    ring = std::move(created);
+                } else {
+                    unavailable = true;
+                }
+            }
+            return ring.get();
+        }
+
+        IoRing() = default;
+
+        IoRing(const IoRing &) = delete;
+
+        IoRing &operator=(const IoRing &) = delete;
+
+        ~IoRing() {
+            if (sqes != MAP_FAILED) {
+                ::munmap(sqes, sqes_size);
+            }
+            if (cq_ring != MAP_FAILED && cq_ring != sq_ring) {
+                ::munmap(cq_ring, cq_ring_size);
+            }
+            if (sq_ring != MAP_FAILED) {
+                ::munmap(sq_ring, sq_ring_size);
+            }
+            if (ring_fd >= 0) {
+                ::close(ring_fd);
+            }
+        }
+
+        bool supports(unsigned opcode) const {
+            return opcode < supported.size() && supported[opcode];
+        }
+
+        unsigned freeEntries() const {
+            unsigned head = __atomic_load_n(sq_head, __ATOMIC_ACQUIRE);
+            return sq_entries - (local_tail + queued - head);
+        }
+
+        // Очередной запрос; вызывающий проверяет freeEntries()
+        io_uring_sqe *nextSqe() {
+            unsigned index = (local_tail + queued) & sq_mask;
+            sq_array[index] = index;
+            io_uring_sqe *sqe = &sqes[index];
+            std::memset(sqe, 0, sizeof(*sqe));
+            ++queued;
+            return sqe;
+        }
+
+        // Отправка поставленных запросов и ожидание всех их завершений:
+        // пары (user_data, результат)
+        std::vector<std::pair<uint64_t, int>> submitAndWait() {
+            std::vector<std::pair<uint64_t, int>> completions;
+            unsigned submitted_from = local_tail;
+            unsigned expected = queued;
+            unsigned to_submit = queued;
+            local_tail += queued;
+            queued = 0;
+            __atomic_store_n(sq_tail, local_tail, __ATOMIC_RELEASE);
+
+            while (completions.size() < expected) {
+                unsigned wait = to_submit == 0 ? 1 : 0;
+                long submitted = ::syscall(__NR_io_uring_enter, ring_fd, to_submit, wait,
+                                           IORING_ENTER_GETEVENTS, nullptr, 0);
+                if (submitted < 0) {
+                    if (errno == EINTR || errno == EAGAIN || errno == EBUSY) {
+                        continue;
+                    }
+                    int error = errno;
+                    drain(submitted_from, completions);
+                    throwError("io_uring_enter failed for", "vault I/O", error);
+                }
+                to_submit -= std::min<unsigned>(to_submit, static_cast<unsigned>(submitted));
+                reap(completions);
+            }
+            return completions;
+        }
+
+    private:
+        int ring_fd = -1;
+        void *sq_ring = MAP_FAILED;
+        void *cq_ring = MAP_FAILED;
+        io_uring_sqe *sqes = static_cast<io_uring_sqe *>(MAP_FAILED);
+        size_t sq_ring_size = 0;
+        size_t cq_ring_size = 0;
+        size_t sqes_size = 0;
+        unsigned *sq_head = nullptr;
+        unsigned *sq_tail = nullptr;
+        unsigned *sq_array = nullptr;
+        unsigned sq_mask = 0;
+        unsigned sq_entries = 0;
+        unsigned *cq_head = nullptr;
+        unsigned *cq_tail = nullptr;
+        unsigned cq_mask = 0;
+        io_uring_cqe *cqes = nullptr;
+        unsigned local_tail = 0;
+        unsigned queued = 0;
+        bool broken = false; // сбой io_uring_enter: кольцо больше не используется
+        std::vector<bool> supported;
+
+        void reap(std::vector<std::pair<uint64_t, int>> &completions) {
+            unsigned head = *cq_head;
+            unsigned tail = __atomic_load_n(cq_tail, __ATOMIC_ACQUIRE);
+            for (; head != tail; ++head) {
+                const io_uring_cqe &cqe = cqes[head & cq_mask];
+                completions.emplace_back(cqe.user_data, cqe.res);
+            }
+            __atomic_store_n(cq_head, head, __ATOMIC_RELEASE);
+        }
+
+        // Ожидание запросов, уже принятых ядром: они ссылаются на буферы и
+        // дескрипторы вызывающего, которые после исключения освобождаются.
+        // Непринятые запросы ядро не увидит - кольцо больше не используется.
+        // Если не удается и ожидание, оставшиеся запросы отменит ядро при
+        // закрытии кольца
+        void drain(unsigned submitted_from, std::vector<std::pair<uint64_t, int>> &completions) {
+            broken = true;
+            size_t accepted = __atomic_load_n(sq_head, __ATOMIC_ACQUIRE) - submitted_from;
+            while (completions.size() < accepted) {
+                long result = ::syscall(__NR_io_uring_enter, ring_fd, 0, 1, IORING_ENTER_GETEVENTS, nullptr, 0);
+                if (result < 0 && errno != EINTR && errno != EAGAIN && errno != EBUSY) {
+                    return;
+                }
+                reap(completions);
+            }
+        }
+
+        bool setup() {
+            io_uring_params params;
+            std::memset(&params, 0, sizeof(params));
+            ring_fd = static_cast<int>(::syscall(__NR_io_uring_setup, ENTRIES, &params));
+            if (ring_fd < 0) {
+                return false;
+            }
+
+            sq_ring_size = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+            cq_ring_size = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+            bool single_mmap = (params.features & IORING_FEAT_SINGLE_MMAP) != 0;
+            if (single_mmap) {
+                sq_ring_size = cq_ring_size = std::max(sq_ring_size, cq_ring_size);
+            }
+            sq_ring = ::mmap(nullptr, sq_ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                             ring_fd, IORING_OFF_SQ_RING);
+            if (sq_ring == MAP_FAILED) {
+                return false;
+            }
+            cq_ring = single_mmap ? sq_ring
+                                  : ::mmap(nullptr, cq_ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                                           ring_fd, IORING_OFF_CQ_RING);
+            if (cq_ring == MAP_FAILED) {
+                return false;
+            }
+            sqes_size = params.sq_entries * sizeof(io_uring_sqe);
+            void *sqe_memory = ::mmap(nullptr, sqes_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                                      ring_fd, IORING_OFF_SQES);
+            if (sqe_memory == MAP_FAILED) {
+                return false;
+            }
+            sqes = static_cast<io_uring_sqe *>(sqe_memory);
+
+            auto *sq = static_cast<unsigned char *>(sq_ring);
+            auto *cq = static_cast<unsigned char *>(cq_ring);
+            sq_head = reinterpret_cast<unsigned *>(sq + params.sq_off.head);
+            sq_tail = reinterpret_cast<unsigned *>(sq + params.sq_off.tail);
+            sq_mask = *reinterpret_cast<unsigned *>(sq + params.sq_off.ring_mask);
+            sq_array = reinterpret_cast<unsigned *>(sq + params.sq_off.array);
+            sq_entries = params.sq_entries;
+            cq_head = reinterpret_cast<unsigned *>(cq + params.cq_off.head);
+            cq_tail = reinterpret_cast<unsigned *>(cq + params.cq_off.tail);
+            cq_mask = *reinterpret_cast<unsigned *>(cq + params.cq_off.ring_mask);
+            cqes = reinterpret_cast<io_uring_cqe *>(cq + params.cq_off.cqes);
+            local_tail = *sq_tail;
+
+            // Поддерживаемые ядром операции; без чтения и записи кольцо бесполезно
+            const unsigned PROBE_OPS = 256;
+            std::vector<unsigned char> probe_memory(sizeof(io_uring_probe) + PROBE_OPS * sizeof(io_uring_probe_op));
+            auto *probe = reinterpret_cast<io_uring_probe *>(probe_memory.data());
+            if (::syscall(__NR_io_uring_register, ring_fd, IORING_REGISTER_PROBE, probe, PROBE_OPS) < 0) {
+                return false;
+            }
+            supported.assign(PROBE_OPS, false);
+            for (unsigned i = 0; i < probe->ops_len && i < PROBE_OPS; ++i) {
+                if (probe->ops[i].flags & IO_URING_OP_SUPPORTED) {
+                    supported[probe->ops[i].op] = true;
+                }
+            }
+            return supports(IORING_OP_READ) && supports(IORING_OP_WRITE);
+        }
+    };
+
+    // Шаги цепочки записи; user_data = номер файла * STAGE_COUNT + шаг
+    enum WriteStage : uint64_t {
+        STAGE_WRITE,
+        STAGE_FSYNC,
+        STAGE_CLOSE,
+        STAGE_RENAME,
+        STAGE_DIR_FSYNC,
+        STAGE_COUNT
+    };
+
+    // Чтение порциями: все порции отправляются вместе. Возвращает длину
+    // непрерывно прочитанного начала файла
+    size_t readWithRing(IoRing &ring, int fd, std::string &data, const std::string &path) {
+        size_t filled = 0;
+        while (filled < data.size()) {
+            size_t batch_start = filled;
+            size_t pieces = 0;
+            for (size_t offset = batch_start; offset < data.size() && ring.freeEntries() > 0; offset += READ_CHUNK) {
+                io_uring_sqe *sqe = ring.nextSqe();
+                sqe->opcode = IORING_OP_READ;
+                sqe->fd = fd;
+                sqe->addr = reinterpret_cast<uint64_t>(data.data() + offset);
+                sqe->len = static_cast<uint32_t>(std::min(READ_CHUNK, data.size() - offset));
+                sqe->off = offset;
+                sqe->user_data = pieces++;
+            }
+            std::vector<int> results(pieces, 0);
+            for (const auto &[piece, result] : ring.submitAndWait()) {
+                results[piece] = result;
+            }
+            for (size_t piece = 0; piece < pieces; ++piece) {
+                size_t expected = std::min(READ_CHUNK, data.size() - (batch_start + piece * READ_CHUNK));
+                int result = results[piece];
+                if (result < 0 && result != -EINTR && result != -EAGAIN) {
+                    throwError("Failed to read", path, -result);
+                }
+                if (result < 0 || static_cast<size_t>(result) != expected) {
+                    // Короткое чтение: остальное - через pread
+                    return filled + std::max(result, 0);
+                }
+                filled += expected;
+            }
+        }
+        return filled;
+    }
+
+    // Цепочки записи файлов пакета, пока хватает места в очереди
+    void writeWithRing(IoRing &ring, std::vector<PendingWrite> &pending, bool durable) {
+        // Цепочка обрывается на первом шаге, который ядро не поддерживает
+        bool with_fsync = durable && ring.supports(IORING_OP_FSYNC);
+        bool with_close = (!durable || with_fsync) && ring.supports(IORING_OP_CLOSE);
+        bool with_rename = with_close && ring.supports(IORING_OP_RENAMEAT);
+        unsigned chain_length = 1 + (with_fsync ? 1 : 0) + (with_close ? 1 : 0) + (with_rename ? 1 : 0) +
+                                (durable && with_rename ? 1 : 0);
+
+        size_t next = 0;
+        while (next < pending.size()) {
+            while (next < pending.size() && ring.freeEntries() >= chain_length) {
+                PendingWrite &file = pending[next];
+                std::vector<io_uring_sqe *> chain;
+                auto add = [&](uint8_t opcode, WriteStage stage) {
+                    io_uring_sqe *sqe = ring.nextSqe();
+                    sqe->opcode = opcode;
+                    sqe->user_data = next * STAGE_COUNT + stage;
+                    chain.push_back(sqe);
+                    return sqe;
+                };
+                io_uring_sqe *write = add(IORING_OP_WRITE, STAGE_WRITE);
+                write->fd = file.fd;
+                write->addr = reinterpret_cast<uint64_t>(file.file->data.data());
+                write->len = static_cast<uint32_t>(std::min<size_t>(file.file->data.size(), 0x7ffff000));
+                write->off = 0;
+                if (with_fsync) {
+                    add(IORING_OP_FSYNC, STAGE_FSYNC)->fd = file.fd;
+                }
+                if (with_close) {
+                    add(IORING_OP_CLOSE, STAGE_CLOSE)->fd = file.fd;
+                }
+                if (with_rename) {
+                    io_uring_sqe *rename = add(IORING_OP_RENAMEAT, STAGE_RENAME);
+                    rename->fd = AT_FDCWD;
+                    rename->addr = reinterpret_cast<uint64_t>(file.temp_path.c_str());
+                    rename->len = static_cast<uint32_t>(AT_FDCWD);
+                    rename->addr2 = reinterpret_cast<uint64_t>(file.file->path.c_str());
+                    if (durable && file.dir_fd >= 0) {
+                        add(IORING_OP_FSYNC, STAGE_DIR_FSYNC)->fd = file.dir_fd;
+                    }
+                }
+                for (size_t i = 0; i + 1 < chain.size(); ++i) {
+                    chain[i]->flags |= IOSQE_IO_LINK;
+                }
+                ++next;
+            }
+
+            for (const auto &[user_data, result] : ring.submitAndWait()) {
+                PendingWrite &file = pending[user_data / STAGE_COUNT];
+                auto stage = static_cast<WriteStage>(user_data % STAGE_COUNT);
+                if (result == -ECANCELED) {
+                    continue; // шаг выполнит finishPosix
+                }
+                auto fail = [&](const char *step) {
+                    if (!file.error) {
+                        file.error = -result;
+                        file.error_step = step;
+                    }
+                };
+                switch (stage) {
+                    case STAGE_WRITE:
+                        if (result >= 0) {
+                            file.written = static_cast<size_t>(result);
+                        } else if (result != -EINTR && result != -EAGAIN) {
+                            fail("Failed to write");
+                        }
+                        break;
+                    case STAGE_FSYNC:
+                        if (result == 0) {
+                            file.synced = true;
+                        } else {
+                            fail("Failed to sync");
+                        }
+                        break;
+                    case STAGE_CLOSE:
+                        // После close с ошибкой дескриптор все равно освобожден
+                        file.closed = true;
+                        if (result != 0) {
+                            fail("Failed to close");
+                        }
+                        break;
+                    case STAGE_RENAME:
+                        if (result == 0) {
+                            file.renamed = true;
+                        } else {
+                            fail("Failed to replace");
+                        }
+                        break;
+                    case STAGE_DIR_FSYNC:
+                    case STAGE_COUNT:
+                        break;
+                }
+            }
+        }
+    }
+#endif
+#endif
+}
+
+const char *VaultFileIO::backendName() {
+#ifdef IRONVAULT_USE_IO_URING
+    if (IoRing::forThread()) {
+        return "io_uring";
+    }
+#endif
+    return "posix";
+}
+
+void VaultFileIO::setIoUringEnabled(bool enabled) {
+    io_uring_enabled = enabled;
+}
+
+// Чтение файла целиком
+std::optional<std::string> VaultFileIO::readFile(const std::string &path) {
+    IRONVAULT_TRACE_SPAN("file.read");
+#ifdef _WIN32
+    std::ifstream file(path, std::ios::binary);
+    if (!file.is_open()) {
+        return std::nullopt;
+    }
+    std::stringstream buffer;
+    buffer << file.rdbuf();
+    if (file.bad()) {
+        throw std::runtime_error("Failed to read " + path);
+    }
+    return buffer.str();
+#else
+    int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        if (errno == ENOENT) {
+            return std::nullopt;
+        }
+        throwError("Failed to open", path, errno);
+    }
+    try {
+        struct stat info;
+        if (::fstat(fd, &info) != 0) {
+            throwError("Failed to stat", path, errno);
+        }
+        std::string data(static_cast<size_t>(info.st_size), '\0');
+        size_t filled = 0;
+#ifdef IRONVAULT_USE_IO_URING
+        if (IoRing *ring = IoRing::forThread(); ring && !data.empty()) {
+            filled = readWithRing(*ring, fd, data, path);
+        }
+#endif
+        readRest(fd, data, filled, path);
+        ::close(fd);
+        return data;
+    } catch (...) {
+        ::close(fd);
+        throw;
+    }
+#endif
+}
+
+void VaultFileIO::writeFileAtomically(const std::string &path, std::string_view data, bool durable) {
+    writeFilesAtomically({FileWrite{path, data}}, durable);
+}
+
+// Пакетная атомарная запись
+void VaultFileIO::writeFilesAtomically(const std::vector<FileWrite> &files, bool durable) {
+    if (files.empty()) {
+        return;
+    }
+    IRONVAULT_TRACE_SPAN_ARG("file.write_batch", "files", files.size());
+#ifdef _WIN32
+    for (const auto &file : files) {
+        std::string temp_path = file.path + ".tmp";
+        {
+            std::ofstream out(temp_path, std::ios::binary | std::ios::trunc);
+            if (!out.is_open()) {
+                throw std::runtime_error("Failed to create " + temp_path);
+            }
+            out.write(file.data.data(), static_cast<std::streamsize>(file.data.size()));
+            out.flush();
+            if (!out) {
+                throw std::runtime_error("Failed to write " + temp_path);
+            }
+        }
+        std::filesystem::rename(temp_path, file.path);
+    }
+    (void) durable;
+#else
+    std::vector<PendingWrite> pending(files.size());
+    for (size_t i = 0; i < files.size(); ++i) {
+        pending[i].file = &files[i];
+    }
+    std::string first_error;
+    try {
+        for (auto &file : pending) {
+            openPending(file, durable);
+        }
+#ifdef IRONVAULT_USE_IO_URING
+        if (IoRing *ring = IoRing::forThread()) {
+            writeWithRing(*ring, pending, durable);
+        }
+#endif
+    } catch (const std::exception &e) {
+        first_error = e.what();
+    }
+
+    for (auto &file : pending) {
+        if (!first_error.empty() || file.error) {
+            if (first_error.empty()) {
+                first_error = std::string(file.error_step) + " " + file.file->path + ": " +
+                              std::generic_category().message(file.error);
+            }
+            abandon(file);
+            continue;
+        }
+        try {
+            finishPosix(file, durable);
+        } catch (const std::exception &e) {
+            first_error = e.what();
+            abandon(file);
+        }
+    }
+    if (!first_error.empty()) {
+        throw std::runtime_error(first_error);
+    }
+#endif
+}
@@ -0,0 +1,48 @@
+#ifndef IRONVAULT_MANAGER_VAULTFILEIO_H
+#define IRONVAULT_MANAGER_VAULTFILEIO_H
+
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Файловый ввод-вывод хранилища и резервных копий.
+// На Linux (сборка с IRONVAULT_HAVE_IO_URING) операции идут через io_uring:
+// чтение файла - несколькими независимыми запросами за один системный вызов,
+// запись - цепочкой связанных запросов write -> fsync -> close -> renameat
+// -> fsync каталога, отправленной одним вызовом; пакет файлов отправляется
+// общими порциями. Кольцо создается одно на поток при первом вызове.
+// Если кольцо недоступно (старое ядро, seccomp) или операция ядром не
+// поддерживается, соответствующие шаги выполняются через pread/pwrite,
+// fsync, close и rename. Прерванная цепочка (короткая запись, ошибка)
+// дописывается теми же вызовами с места остановки.
+// Запись всегда идет во временный файл <путь>.tmp с правами 0600 и
+// заменяет файл переименованием: читатели видят старый или новый файл целиком.
+class VaultFileIO {
+public:
+    // Файл пакетной записи; data должна жить до возврата из вызова
+    struct FileWrite {
+        std::string path;
+        std::string_view data;
+    };
+
+    // Используемый механизм: "io_uring" или "posix"
+    static const char *backendName();
+
+    // Отключение io_uring (сравнение механизмов, отладка); действует на все потоки
+    static void setIoUringEnabled(bool enabled);
+
+    // Содержимое файла; nullopt, если файла нет; исключение при ошибке чтения
+    static std::optional<std::string> readFile(const std::string &path);
+
+    // Атомарная замена файла. durable: данные и переименование закреплены
+    // на диске (fsync файла и каталога) до возврата.
+    static void writeFileAtomically(const std::string &path, std::string_view data, bool durable);
+
+    // То же для нескольких файлов с общими отправками запросов. При ошибке
+    // исключение; файлы, замененные до нее, остаются новыми.
+    static void writeFilesAtomically(const std::vector<FileWrite> &files, bool durable);
+};
+
+
+#endif //IRONVAULT_MANAGER_VAULTFILEIO_H
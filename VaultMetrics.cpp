@@ -0,0 +1,259 @@
+#include "VaultMetrics.h"
+#include <algorithm>
+#include <bit>
+#include <memory>
+#include <mutex>
+#include <sstream>
+
+namespace {
+    const size_t OPERATION_COUNT = static_cast<size_t>(MetricOperation::Count);
+    const size_t COUNTER_COUNT = static_cast<size_t>(MetricCounter::Count);
+
+    // Шард метрик одного потока; пишет только владелец
+    struct ThreadShard {
+        std::array<std::array<std::atomic<uint64_t>, VaultMetrics::BUCKET_COUNT>, OPERATION_COUNT> buckets{};
+        std::array<std::atomic<uint64_t>, OPERATION_COUNT> counts{};
+        std::array<std::atomic<uint64_t>, OPERATION_COUNT> sums{};
+        std::array<std::atomic<uint64_t>, OPERATION_COUNT> maxes{};
+        std::array<std::atomic<uint64_t>, COUNTER_COUNT> counters{};
+    };
+
+    // Реестр шардов живых потоков. Шард завершившегося потока
+    // прибавляется к retired и удаляется: реестр не растет с числом
+    // когда-либо созданных потоков.
+    struct ShardRegistry {
+        std::mutex mutex;
+        std::vector<ThreadShard *> shards;
+        ThreadShard retired;
+    };
+
+    ShardRegistry &registry() {
+        static ShardRegistry *instance = new ShardRegistry();
+        return *instance;
+    }
+
+    // Прибавление значений шарда from к into (под мьютексом реестра)
+    void foldShard(const ThreadShard &from, ThreadShard &into) {
+        auto add = [](const std::atomic<uint64_t> &value, std::atomic<uint64_t> &total) {
+            total.store(total.load(std::memory_order_relaxed) + value.load(std::memory_order_relaxed),
+                        std::memory_order_relaxed);
+        };
+        for (size_t op = 0; op < OPERATION_COUNT; ++op) {
+            for (size_t i = 0; i < VaultMetrics::BUCKET_COUNT; ++i) {
+                add(from.buckets[op][i], into.buckets[op][i]);
+            }
+            add(from.counts[op], into.counts[op]);
+            add(from.sums[op], into.sums[op]);
+            into.maxes[op].store(std::max(into.maxes[op].load(std::memory_order_relaxed),
+                                          from.maxes[op].load(std::memory_order_relaxed)),
+                                 std::memory_order_relaxed);
+        }
+        for (size_t c = 0; c < COUNTER_COUNT; ++c) {
+            add(from.counters[c], into.counters[c]);
+        }
+    }
+
+    // Шард потока: регистрируется при первой записи, при завершении потока
+    // переносится в итог завершившихся
+    class LocalShard {
+    private:
+        std::unique_ptr<ThreadShard> shard;
+
+    public:
+        LocalShard() : shard(std::make_unique<ThreadShard>()) {
+            ShardRegistry &reg = registry();
+            std::lock_guard<std::mutex> lock(reg.mutex);
+            reg.shards.push_back(shard.get());
+        }
+
+        LocalShard(const LocalShard &) = delete;
+
+        LocalShard &operator=(const LocalShard &) = delete;
+
+        ~LocalShard() {
+            ShardRegistry &reg = registry();
+            std::lock_guard<std::mutex> lock(reg.mutex);
+            foldShard(*shard, reg.retired);
+            reg.shards.erase(std::find(reg.shards.begin(), reg.shards.end(), shard.get()));
+        }
+
+        ThreadShard &get() { return *shard; }
+    };
+
+    ThreadShard &localShard() {
+        thread_local LocalShard shard;
+        return shard.get();
+    }
+
+    // Увеличение без read-modify-write: у шарда единственный писатель
+    void bump(std::atomic<uint64_t> &value, uint64_t delta) {
+        value.store(value.load(std::memory_order_relaxed) + delta, std::memory_order_relaxed);
+    }
+
+    const char *const OPERATION_NAMES[] = {
+            "load_vault", "save_vault", "derive_key", "encrypt", "decrypt", "search", "generate_password"
+    };
+
+    const char *const COUNTER_NAMES[] = {
+            "kdf_calls", "bytes_encrypted", "bytes_decrypted", "search_calls", "records_scanned",
+            "save_bytes", "cipher_context_hits", "cipher_context_misses",
+            "load_failures", "save_failures", "decrypt_failures"
+    };
+
+    static_assert(sizeof(OPERATION_NAMES) / sizeof(OPERATION_NAMES[0]) == OPERATION_COUNT,
+                  "Every operation needs a name");
+    static_assert(sizeof(COUNTER_NAMES) / sizeof(COUNTER_NAMES[0]) == COUNTER_COUNT,
+                  "Every counter needs a name");
+}
+
+// Перцентиль по накопленным корзинам
+uint64_t HistogramSnapshot::percentile(double p) const {
+    if (count == 0 || buckets.empty()) {
+        return 0;
+    }
+    p = std::clamp(p, 0.0, 1.0);
+    uint64_t target = static_cast<uint64_t>(p * static_cast<double>(count));
+    if (target == 0) {
+        target = 1;
+    }
+
+    uint64_t seen = 0;
+    for (size_t i = 0; i < buckets.size(); ++i) {
+        seen += buckets[i];
+        if (seen >= target) {
+            return std::min(VaultMetrics::bucketUpperBound(i), max_ns);
+        }
+    }
+    return max_ns;
+}
+
+const HistogramSnapshot &MetricsSnapshot::get(MetricOperation operation) const {
+    return operations[static_cast<size_t>(operation)];
+}
+
+uint64_t MetricsSnapshot::get(MetricCounter counter) const {
+    return counters[static_cast<size_t>(counter)];
+}
+
+// ScopedTimer
+VaultMetrics::ScopedTimer::ScopedTimer(MetricOperation operation)
+        : operation(operation), start(std::chrono::steady_clock::now()) {}
+
+VaultMetrics::ScopedTimer::~ScopedTimer() {
+    auto elapsed = std::chrono::steady_clock::now() - start;
+    record(operation, std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count());
+}
+
+// Запись длительности операции
+void VaultMetrics::record(MetricOperation operation, uint64_t duration_ns) {
+    size_t op = static_cast<size_t>(operation);
+    ThreadShard &shard = localShard();
+    bump(shard.buckets[op][bucketIndex(duration_ns)], 1);
+    bump(shard.counts[op], 1);
+    bump(shard.sums[op], duration_ns);
+    if (duration_ns > shard.maxes[op].load(std::memory_order_relaxed)) {
+        shard.maxes[op].store(duration_ns, std::memory_order_relaxed);
+    }
+}
+
+// Увеличение счетчика
+void VaultMetrics::add(MetricCounter counter, uint64_t value) {
+    bump(localShard().counters[static_cast<size_t>(counter)], value);
+}
+
+// Снимок: итог завершившихся потоков плюс шарды живых
+MetricsSnapshot VaultMetrics::snapshot() {
+    MetricsSnapshot result;
+    for (auto &histogram: result.operations) {
+        histogram.buckets.assign(BUCKET_COUNT, 0);
+    }
+
+    ShardRegistry &reg = registry();
+    std::lock_guard<std::mutex> lock(reg.mutex);
+    auto accumulate = [&result](const ThreadShard &shard) {
+        for (size_t op = 0; op < OPERATION_COUNT; ++op) {
+            HistogramSnapshot &histogram = result.operations[op];
+            histogram.count += shard.counts[op].load(std::memory_order_relaxed);
+            histogram.sum_ns += shard.sums[op].load(std::memory_order_relaxed);
+            histogram.max_ns = std::max(histogram.max_ns, shard.maxes[op].load(std::memory_order_relaxed));
+            for (size_t i = 0; i < BUCKET_COUNT; ++i) {
+                histogram.buckets[i] += shard.buckets[op][i].load(std::memory_order_relaxed);
+            }
+        }
+        for (size_t c = 0; c < COUNTER_COUNT; ++c) {
+            result.counters[c] += shard.counters[c].load(std::memory_order_relaxed);
+        }
+    };
+    accumulate(reg.retired);
+    for (const ThreadShard *shard: reg.shards) {
+        accumulate(*shard);
+    }
+    return result;
+}
+
+std::string VaultMetrics::toPrometheus() {
+    return toPrometheus(snapshot());
+}
+
+// Текстовый формат Prometheus: счетчики и summary с квантилями
+std::string VaultMetrics::toPrometheus(const MetricsSnapshot &snapshot) {
+    static const double QUANTILES[] = {0.5, 0.9, 0.99, 0.999};
+    std::ostringstream out;
+
+    for (size_t c = 0; c < COUNTER_COUNT; ++c) {
+        out << "# TYPE ironvault_" << COUNTER_NAMES[c] << "_total counter\n";
+        out << "ironvault_" << COUNTER_NAMES[c] << "_total " << snapshot.counters[c] << "\n";
+    }
+
+    out << "# TYPE ironvault_operation_duration_seconds summary\n";
+    for (size_t op = 0; op < OPERATION_COUNT; ++op) {
+        const HistogramSnapshot &histogram = snapshot.operations[op];
+        const char *name = OPERATION_NAMES[op];
+        for (double q: QUANTILES) {
+            out << "ironvault_operation_duration_seconds{operation=\"" << name << "\",quantile=\"" << q << "\"} "
+                << static_cast<double>(histogram.percentile(q)) / 1e9 << "\n";
+        }
+        out << "ironvault_operation_duration_seconds_sum{operation=\"" << name << "\"} "
+            << static_cast<double>(histogram.sum_ns) / 1e9 << "\n";
+        out << "ironvault_operation_duration_seconds_count{operation=\"" << name << "\"} "
+            << histogram.count << "\n";
+    }
+    return out.str();
+}
+
+bool VaultMetrics::isEnabled() {
+#ifdef IRONVAULT_ENABLE_METRICS
+    return true;
+#else
+    return false;
+#endif
+}
+
+const char *VaultMetrics::operationName(MetricOperation operation) {
+    return OPERATION_NAMES[static_cast<size_t>(operation)];
+}
+
+const char *VaultMetrics::counterName(MetricCounter counter) {
+    return COUNTER_NAMES[static_cast<size_t>(counter)];
+}
+
+// Индекс корзины: значения до 8 - линейно, дальше 8 корзин на каждую степень двойки
+size_t VaultMetrics::bucketIndex(uint64_t value) {
+    if (value < SUB_BUCKETS) {
+        return value;
+    }
+    unsigned msb = 63 - std::countl_zero(value);
+    uint64_t sub = (value >> (msb - 3)) & (SUB_BUCKETS - 1);
+    return (msb - 2) * SUB_BUCKETS + sub;
+}
+
+// Верхняя граница значений, попадающих в корзину
+uint64_t VaultMetrics::bucketUpperBound(size_t index) {
+    if (index < SUB_BUCKETS) {
+        return index;
+    }
+    unsigned msb = static_cast<unsigned>(index / SUB_BUCKETS) + 2;
+    uint64_t sub = index % SUB_BUCKETS;
+    uint64_t lower = (SUB_BUCKETS + sub) << (msb - 3);
+    return lower + (uint64_t(1) << (msb - 3)) - 1;
+}
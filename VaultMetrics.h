@@ -0,0 +1,125 @@
+#ifndef IRONVAULT_MANAGER_VAULTMETRICS_H
+#define IRONVAULT_MANAGER_VAULTMETRICS_H
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Операции, для которых собираются гистограммы задержек
+enum class MetricOperation : size_t {
+    LoadVault,
+    SaveVault,
+    DeriveKey,
+    Encrypt,
+    Decrypt,
+    Search,
+    GeneratePassword,
+    Count
+};
+
+// Счетчики
+enum class MetricCounter : size_t {
+    KdfCalls,
+    BytesEncrypted,
+    BytesDecrypted,
+    SearchCalls,
+    RecordsScanned,
+    SaveBytes,
+    CipherContextHits,
+    CipherContextMisses,
+    LoadFailures,
+    SaveFailures,
+    DecryptFailures,
+    Count
+};
+
+// Снимок гистограммы задержек (в наносекундах)
+struct HistogramSnapshot {
+    uint64_t count = 0;
+    uint64_t sum_ns = 0;
+    uint64_t max_ns = 0;
+    std::vector<uint64_t> buckets;
+
+    // Оценка перцентиля (p от 0 до 1) по верхней границе корзины
+    uint64_t percentile(double p) const;
+};
+
+// Снимок всех метрик
+struct MetricsSnapshot {
+    std::array<HistogramSnapshot, static_cast<size_t>(MetricOperation::Count)> operations;
+    std::array<uint64_t, static_cast<size_t>(MetricCounter::Count)> counters{};
+
+    const HistogramSnapshot &get(MetricOperation operation) const;
+
+    uint64_t get(MetricCounter counter) const;
+};
+
+// Легковесные метрики хранилища.
+// Каждый поток пишет в свой шард без блокировок (один писатель, relaxed-атомики),
+// снимок суммирует шарды всех потоков; шард завершившегося потока переносится
+// в общий итог и освобождается. Гистограммы логарифмически-линейные
+// в стиле HDR: 64 степени двойки по 8 линейных корзин, погрешность не больше 12.5%.
+// При сборке без IRONVAULT_ENABLE_METRICS макросы ниже ничего не делают.
+class VaultMetrics {
+public:
+    // Константы
+    static const size_t SUB_BUCKETS = 8;
+    static const size_t BUCKET_COUNT = 64 * SUB_BUCKETS;
+
+    // Замер длительности операции в пределах области видимости
+    class ScopedTimer {
+    private:
+        MetricOperation operation;
+        std::chrono::steady_clock::time_point start;
+
+    public:
+        explicit ScopedTimer(MetricOperation operation);
+
+        ScopedTimer(const ScopedTimer &) = delete;
+
+        ScopedTimer &operator=(const ScopedTimer &) = delete;
+
+        ~ScopedTimer();
+    };
+
+    // Запись значений
+    static void record(MetricOperation operation, uint64_t duration_ns);
+
+    static void add(MetricCounter counter, uint64_t value = 1);
+
+    // Чтение
+    static MetricsSnapshot snapshot();
+
+    static std::string toPrometheus();
+
+    static std::string toPrometheus(const MetricsSnapshot &snapshot);
+
+    static bool isEnabled();
+
+    // Имена для экспорта
+    static const char *operationName(MetricOperation operation);
+
+    static const char *counterName(MetricCounter counter);
+
+    // Границы корзин
+    static size_t bucketIndex(uint64_t value);
+
+    static uint64_t bucketUpperBound(size_t index);
+};
+
+#ifdef IRONVAULT_ENABLE_METRICS
+#define IRONVAULT_METRIC_CONCAT_INNER(a, b) a##b
+#define IRONVAULT_METRIC_CONCAT(a, b) IRONVAULT_METRIC_CONCAT_INNER(a, b)
+#define IRONVAULT_METRIC_TIMER(operation) \
+    VaultMetrics::ScopedTimer IRONVAULT_METRIC_CONCAT(ironvault_metric_timer_, __LINE__)(operation)
+#define IRONVAULT_METRIC_ADD(counter, value) VaultMetrics::add(counter, value)
+#else
+#define IRONVAULT_METRIC_TIMER(operation) ((void)0)
+#define IRONVAULT_METRIC_ADD(counter, value) ((void)0)
+#endif
+
+
+#endif //IRONVAULT_MANAGER_VAULTMETRICS_H
@@ -0,0 +1,406 @@
+#include "VaultMigrator.h"
+#include "CredentialVault.h"
+#include "ParallelRunner.h"
+#include "SessionKeyCache.h"
+#include "VaultTrace.h"
+#include <openssl/crypto.h>
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <filesystem>
+#include <fstream>
+#include <map>
+#include <mutex>
+#include <sstream>
+#include <stdexcept>
+#include <thread>
+
+#ifdef _WIN32
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+const std::string VaultMigrator::JOURNAL_NAME = ".ironvault-migration.journal";
+const std::string VaultMigrator::TEMP_SUFFIX = ".migrating";
+
+namespace {
+    // Отметка файла в журнале: размер и время изменения после переноса
+    struct FileStamp {
+        uintmax_t size = 0;
+        int64_t modified = 0;
+
+        bool operator==(const FileStamp &other) const {
+            return size == other.size && modified == other.modified;
+        }
+    };
+
+    bool readStamp(const std::filesystem::path &path, FileStamp &stamp) {
+        std::error_code error;
+        stamp.size = std::filesystem::file_size(path, error);
+        if (error) {
+            return false;
+        }
+        auto time = std::filesystem::last_write_time(path, error);
+        if (error) {
+            return false;
+        }
+        stamp.modified = static_cast<int64_t>(time.time_since_epoch().count());
+        return true;
+    }
+
+    // Строки журнала: "<размер> <время> <имя файла>"
+    std::map<std::string, FileStamp> readJournal(const std::filesystem::path &path) {
+        std::map<std::string, FileStamp> entries;
+        std::ifstream journal(path);
+        std::string line;
+        while (std::getline(journal, line)) {
+            std::istringstream fields(line);
+            FileStamp stamp;
+            std::string name;
+            if (fields >> stamp.size >> stamp.modified && fields.get() == ' ' && std::getline(fields, name) &&
+                !name.empty()) {
+                entries[name] = stamp;
+            }
+        }
+        return entries;
+    }
+
+    // Копия пароля для API хранилища, обнуляемая при выходе из области
+    class PasswordCopy {
+    private:
+        std::string value;
+
+    public:
+        explicit PasswordCopy(const secure_string &password)
+                : value(password.view()) {}
+
+        PasswordCopy(const PasswordCopy &) = delete;
+
+        PasswordCopy &operator=(const PasswordCopy &) = delete;
+
+        ~PasswordCopy() {
+            OPENSSL_cleanse(value.data(), value.size());
+        }
+
+        const std::string &get() const {
+            return value;
+        }
+    };
+
+    // Одинаковые записи в одинаковом порядке
+    bool sameRecords(const CredentialVault &expected, const CredentialVault &actual) {
+        if (expected.getRecordCount() != actual.getRecordCount()) {
+            return false;
+        }
+        std::vector<CredentialRecord> left = expected.getAllRecords();
+        std::vector<CredentialRecord> right = actual.getAllRecords();
+        return std::equal(left.begin(), left.end(), right.begin(), right.end(),
+                          [](const CredentialRecord &a, const CredentialRecord &b) {
+                              return a.serialize() == b.serialize();
+                          });
+    }
+}
+
+double MigrationReport::vaultsPerSecond() const {
+    return seconds > 0 ? static_cast<double>(migrated) / seconds : 0.0;
+}
+
+double MigrationReport::megabytesPerSecond() const {
+    return seconds > 0 ? static_cast<double>(bytes_read) / (1024.0 * 1024.0) / seconds : 0.0;
+}
+
+// Конструктор
+VaultMigrator::VaultMigrator(std::string directory, PasswordSource passwords, MigrationOptions options)
+        : directory(std::move(directory)), passwords(std::move(passwords)), options(std::move(options)) {
+    if (this->directory.empty()) {
+        throw std::invalid_argument("Migration directory cannot be empty");
+    }
+    if (!this->passwords) {
+        throw std::invalid_argument("Password source cannot be empty");
+    }
+    if (this->options.max_buffered_bytes == 0) {
+        throw std::invalid_argument("Migration buffer cannot be empty");
+    }
+    if (!VaultCompression::isAvailable(this->options.codec)) {
+        throw std::invalid_argument("Compression codec is not available in this build");
+    }
+}
+
+void VaultMigrator::setProgressCallback(ProgressCallback callback) {
+    progress = std::move(callback);
+}
+
+// Перенос каталога: поток чтения и рабочие потоки через ограниченную очередь
+MigrationReport VaultMigrator::run() {
+    IRONVAULT_TRACE_SPAN("migrate.run");
+    auto started = std::chrono::steady_clock::now();
+    std::filesystem::path root(directory);
+    if (!std::filesystem::is_directory(root)) {
+        throw std::runtime_error("Migration directory does not exist: " + directory);
+    }
+
+    // Хранилища каталога по имени; брошенные прошлым запуском временные файлы удаляются
+    std::vector<std::filesystem::path> files;
+    for (const auto &entry: std::filesystem::directory_iterator(root)) {
+        if (!entry.is_regular_file()) {
+            continue;
+        }
+        std::string name = entry.path().filename().string();
+        if (name.size() > TEMP_SUFFIX.size() &&
+            name.compare(name.size() - TEMP_SUFFIX.size(), TEMP_SUFFIX.size(), TEMP_SUFFIX) == 0) {
+            std::error_code error;
+            std::filesystem::remove(entry.path(), error);
+        } else if (entry.path().extension() == options.extension) {
+            files.push_back(entry.path());
+        }
+    }
+    std::sort(files.begin(), files.end());
+
+    std::filesystem::path journal_path = root / JOURNAL_NAME;
+    std::map<std::string, FileStamp> journal_entries = readJournal(journal_path);
+    std::ofstream journal(journal_path, std::ios::app);
+    if (!journal.is_open()) {
+        throw std::runtime_error("Failed to open migration journal");
+    }
+
+    MigrationReport report;
+    std::mutex report_mutex;
+    auto finish = [&](const std::string &path, const std::string &status) {
+        if (progress) {
+            progress(path, status);
+        }
+    };
+
+    // Очередь прочитанных файлов; объем ограничен max_buffered_bytes
+    // (файл больше лимита проходит один, когда очередь пуста)
+    struct Pending {
+        std::string path;
+        std::string data;
+    };
+    std::deque<Pending> queue;
+    size_t buffered_bytes = 0;
+    bool reading_done = false;
+    std::exception_ptr reader_error;
+    std::mutex queue_mutex;
+    std::condition_variable queue_ready;
+    std::condition_variable space_ready;
+
+    std::thread reader([&]() {
+        try {
+            for (const auto &file_path: files) {
+                std::string path = file_path.string();
+                std::string name = file_path.filename().string();
+                FileStamp stamp;
+                bool has_stamp = readStamp(file_path, stamp);
+                {
+                    std::lock_guard<std::mutex> lock(report_mutex);
+                    ++report.scanned;
+                    auto done = journal_entries.find(name);
+                    if (has_stamp && done != journal_entries.end() && done->second == stamp) {
+                        ++report.resumed;
+                        finish(path, "resumed");
+                        continue;
+                    }
+                }
+
+                std::string data;
+                {
+                    IRONVAULT_TRACE_SPAN_ARG("migrate.read_file", "bytes", stamp.size);
+                    std::ifstream in(file_path, std::ios::binary);
+                    std::stringstream buffer;
+                    buffer << in.rdbuf();
+                    data = buffer.str();
+                }
+                {
+                    std::lock_guard<std::mutex> lock(report_mutex);
+                    report.bytes_read += data.size();
+                    if (CredentialVault::isCurrentFormat(data, options.codec)) {
+                        ++report.up_to_date;
+                        finish(path, "up-to-date");
+                        continue;
+                    }
+                }
+
+                std::unique_lock<std::mutex> lock(queue_mutex);
+                space_ready.wait(lock, [&]() {
+                    return buffered_bytes == 0 || buffered_bytes + data.size() <= options.max_buffered_bytes;
+                });
+                buffered_bytes += data.size();
+                queue.push_back(Pending{std::move(path), std::move(data)});
+                queue_ready.notify_one();
+            }
+        } catch (...) {
+            reader_error = std::current_exception();
+        }
+        std::lock_guard<std::mutex> lock(queue_mutex);
+        reading_done = true;
+        queue_ready.notify_all();
+    });
+
+    size_t thread_count = options.max_threads ? options.max_threads : ParallelRunner::defaultThreadCount();
+    try {
+        ParallelRunner::forEach(thread_count, thread_count, [&](size_t) {
+            while (true) {
+                Pending pending;
+                {
+                    std::unique_lock<std::mutex> lock(queue_mutex);
+                    queue_ready.wait(lock, [&]() { return !queue.empty() || reading_done; });
+                    if (queue.empty()) {
+                        return;
+                    }
+                    pending = std::move(queue.front());
+                    queue.pop_front();
+                }
+                size_t size = pending.data.size();
+
+                std::string status = "migrated";
+                bool migrated = true;
+                uint64_t written = 0;
+                try {
+                    written = migrateVault(pending.path, pending.data);
+                } catch (const std::exception &e) {
+                    status = e.what();
+                    migrated = false;
+                }
+                pending.data.clear();
+                pending.data.shrink_to_fit();
+                {
+                    std::lock_guard<std::mutex> lock(queue_mutex);
+                    buffered_bytes -= size;
+                    space_ready.notify_one();
+                }
+
+                std::lock_guard<std::mutex> lock(report_mutex);
+                if (migrated) {
+                    ++report.migrated;
+                    report.bytes_written += written;
+                    FileStamp stamp;
+                    if (readStamp(pending.path, stamp)) {
+                        journal << stamp.size << " " << stamp.modified << " "
+                                << std::filesystem::path(pending.path).filename().string() << "\n";
+                        journal.flush();
+                    }
+                } else {
+                    ++report.failed;
+                    report.failures.emplace_back(pending.path, status);
+                }
+                finish(pending.path, status);
+            }
+        });
+    } catch (...) {
+        // Поток чтения не должен ждать места в очереди, которую некому разбирать
+        {
+            std::lock_guard<std::mutex> lock(queue_mutex);
+            buffered_bytes = 0;
+            queue.clear();
+            space_ready.notify_all();
+        }
+        reader.join();
+        throw;
+    }
+    reader.join();
+    if (reader_error) {
+        std::rethrow_exception(reader_error);
+    }
+
+    report.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+    return report;
+}
+
+// Перенос одного хранилища: расшифровка, новый файл рядом, проверка, замена.
+// Ключ нового файла попадает в кэш, поэтому проверка не повторяет KDF
+uint64_t VaultMigrator::migrateVault(const std::string &path, const std::string &file_data) const {
+    IRONVAULT_TRACE_SPAN_ARG("migrate.vault", "bytes", file_data.size());
+    PasswordCopy master_password(passwords(path));
+    auto key_cache = std::make_shared<SessionKeyCache>();
+
+    CredentialVault source(path);
+    source.setKeyCache(key_cache);
+    if (!source.loadFromData(file_data, master_password.get())) {
+        throw std::runtime_error("Failed to decrypt vault (wrong password or corrupted file)");
+    }
+    // Каждый блок записи исходного файла должен стать записью: иначе
+    // замена файла окончательно потеряет выпавшие записи
+    if (source.getLoadedRecordMarkers() != source.getRecordCount()) {
+        throw std::runtime_error("Vault records were dropped while loading: " +
+                                 std::to_string(source.getLoadedRecordMarkers()) + " blocks, " +
+                                 std::to_string(source.getRecordCount()) + " records");
+    }
+    source.setCompression(options.codec);
+    std::string image = source.buildFileImage(master_password.get());
+
+    std::string temp_path = path + TEMP_SUFFIX;
+    try {
+        writeDurably(temp_path, image);
+        std::error_code error;
+        std::filesystem::permissions(temp_path, std::filesystem::status(path).permissions(), error);
+
+        // Записанный файл должен открываться тем же паролем и давать те же записи
+        IRONVAULT_TRACE_SPAN("migrate.verify");
+        CredentialVault check(temp_path);
+        check.setKeyCache(key_cache);
+        if (!check.loadFromFile(master_password.get()) || !sameRecords(source, check)) {
+            throw std::runtime_error("Migrated vault failed verification");
+        }
+        replaceFile(temp_path, path);
+    } catch (...) {
+        std::error_code error;
+        std::filesystem::remove(temp_path, error);
+        throw;
+    }
+    return image.size();
+}
+
+// Запись файла целиком с fsync: после возврата содержимое на диске
+void VaultMigrator::writeDurably(const std::string &path, std::string_view data) {
+#ifdef _WIN32
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    file.write(data.data(), static_cast<std::streamsize>(data.size()));
+    file.flush();
+    if (!file) {
+        throw std::runtime_error("Failed to write " + path);
+    }
+#else
+    int fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0600);
+    if (fd < 0) {
+        throw std::runtime_error("Failed to create " + path);
+    }
+    size_t offset = 0;
+    while (offset < data.size()) {
+        ssize_t written = ::write(fd, data.data() + offset, data.size() - offset);
+        if (written < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            ::close(fd);
+            throw std::runtime_error("Failed to write " + path);
+        }
+        offset += static_cast<size_t>(written);
+    }
+    if (::fsync(fd) != 0) {
+        ::close(fd);
+        throw std::runtime_error("Failed to sync " + path);
+    }
+    if (::close(fd) != 0) {
+        throw std::runtime_error("Failed to close " + path);
+    }
+#endif
+}
+
+// Атомарная замена переименованием; на POSIX переименование закрепляется
+// fsync каталога
+void VaultMigrator::replaceFile(const std::string &from, const std::string &to) {
+    std::filesystem::rename(from, to);
+#ifndef _WIN32
+    std::string parent = std::filesystem::path(to).parent_path().string();
+    int fd = ::open(parent.empty() ? "." : parent.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (fd >= 0) {
+        ::fsync(fd);
+        ::close(fd);
+    }
+#endif
+}
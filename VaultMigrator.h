@@ -0,0 +1,87 @@
+#ifndef IRONVAULT_MANAGER_VAULTMIGRATOR_H
+#define IRONVAULT_MANAGER_VAULTMIGRATOR_H
+
+#include "SecureMemory.h"
+#include "VaultCompression.h"
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <utility>
+#include <vector>
+
+// Настройки миграции
+struct MigrationOptions {
+    size_t max_threads = 0;                         // 0 - по числу ядер
+    size_t max_buffered_bytes = 256 * 1024 * 1024;  // прочитанные, но еще не перенесенные файлы
+    VaultCompression::Codec codec = VaultCompression::Codec::None;
+    std::string extension = ".dat";                 // какие файлы каталога считаются хранилищами
+};
+
+// Итог миграции
+struct MigrationReport {
+    size_t scanned = 0;
+    size_t migrated = 0;
+    size_t up_to_date = 0;   // уже в текущем формате
+    size_t resumed = 0;      // перенесены прошлым запуском (по журналу)
+    size_t failed = 0;
+    uint64_t bytes_read = 0;
+    uint64_t bytes_written = 0;
+    double seconds = 0;
+    std::vector<std::pair<std::string, std::string>> failures; // файл и причина
+
+    double vaultsPerSecond() const;
+
+    double megabytesPerSecond() const;
+};
+
+// Офлайн-перевод каталога хранилищ в текущий формат файла.
+// Конвейер: поток чтения читает файлы по очереди, пока прочитанное, но не
+// перенесенное не превышает max_buffered_bytes; рабочие потоки расшифровывают
+// (KDF), собирают файл нового формата, пишут его рядом с исходным
+// (*.migrating, с fsync), загружают записанное заново и сверяют записи,
+// и только после этого атомарно заменяют исходный файл переименованием.
+// Файл, часть блоков записей которого не стала записями, не заменяется.
+// Журнал каталога (JOURNAL_NAME) фиксирует перенесенные файлы по размеру
+// и времени изменения: повторный запуск после прерывания пропускает их
+// без чтения, а брошенные *.migrating удаляет. Перенос не меняет записи,
+// отметки удаления и часы репликации; соль и ключи сегментов новые.
+class VaultMigrator {
+public:
+    // Мастер-пароль хранилища по пути к файлу; исключение - файл пропускается
+    using PasswordSource = std::function<secure_string(const std::string &vault_path)>;
+
+    // Ход миграции: путь к файлу и итог ("migrated", "up-to-date", "resumed" или текст ошибки);
+    // вызывается по одному из потоков миграции
+    using ProgressCallback = std::function<void(const std::string &vault_path, const std::string &status)>;
+
+    // Константы
+    static const std::string JOURNAL_NAME;
+    static const std::string TEMP_SUFFIX;
+
+private:
+    std::string directory;
+    PasswordSource passwords;
+    MigrationOptions options;
+    ProgressCallback progress;
+
+public:
+    // Конструкторы
+    VaultMigrator(std::string directory, PasswordSource passwords, MigrationOptions options = MigrationOptions());
+
+    void setProgressCallback(ProgressCallback callback);
+
+    // Перенос всех хранилищ каталога; ошибки отдельных файлов попадают в отчет
+    MigrationReport run();
+
+private:
+    // Перенос одного прочитанного файла; возвращает размер нового файла
+    uint64_t migrateVault(const std::string &path, const std::string &file_data) const;
+
+    // Запись с fsync и атомарная замена
+    static void writeDurably(const std::string &path, std::string_view data);
+
+    static void replaceFile(const std::string &from, const std::string &to);
+};
+
+
+#endif //IRONVAULT_MANAGER_VAULTMIGRATOR_H
@@ -0,0 +1,180 @@
+#include "VaultSet.h"
+#include "ParallelRunner.h"
+#include "VaultTrace.h"
+#include <algorithm>
+#include <atomic>
+#include <queue>
+#include <stdexcept>
+
+// Конструкторы
+VaultSet::VaultSet()
+        : VaultSet(std::make_shared<SessionKeyCache>()) {}
+
+VaultSet::VaultSet(std::shared_ptr<SessionKeyCache> key_cache, size_t max_threads)
+        : key_cache(std::move(key_cache)),
+          max_threads(max_threads ? max_threads : ParallelRunner::defaultThreadCount()) {
+    if (!this->key_cache) {
+        throw std::invalid_argument("Key cache cannot be null");
+    }
+}
+
+// Добавление хранилища
+void VaultSet::addVault(const std::string &file_path) {
+    if (file_path.empty()) {
+        throw std::invalid_argument("Vault file path cannot be empty");
+    }
+    if (findMember(file_path)) {
+        throw std::invalid_argument("Vault is already in the set: " + file_path);
+    }
+    Member member;
+    member.vault = std::make_unique<CredentialVault>(file_path);
+    member.vault->setKeyCache(key_cache);
+    members.push_back(std::move(member));
+}
+
+// Удаление хранилища (оно блокируется)
+bool VaultSet::removeVault(const std::string &file_path) {
+    auto it = std::find_if(members.begin(), members.end(), [&file_path](const Member &member) {
+        return member.vault->getVaultFilePath() == file_path;
+    });
+    if (it == members.end()) {
+        return false;
+    }
+    it->vault->lockVault();
+    members.erase(it);
+    return true;
+}
+
+CredentialVault *VaultSet::getVault(const std::string &file_path) {
+    Member *member = findMember(file_path);
+    return member ? member->vault.get() : nullptr;
+}
+
+size_t VaultSet::getVaultCount() const {
+    return members.size();
+}
+
+std::vector<std::string> VaultSet::getVaultPaths() const {
+    std::vector<std::string> paths;
+    paths.reserve(members.size());
+    for (const auto &member: members) {
+        paths.push_back(member.vault->getVaultFilePath());
+    }
+    return paths;
+}
+
+// Параллельная загрузка: каждое хранилище загружается в своем потоке
+size_t VaultSet::loadAll(const std::string &master_password, const std::string &client_id) {
+    if (master_password.empty()) {
+        throw std::invalid_argument("Master password cannot be empty");
+    }
+    IRONVAULT_TRACE_SPAN_ARG("vault_set.load_all", "vaults", members.size());
+
+    std::atomic<size_t> loaded{0};
+    forEachParallel(members.size(), [&](size_t i) {
+        Member &member = members[i];
+        member.load_error.clear();
+        try {
+            if (member.vault->loadFromFile(master_password, client_id)) {
+                loaded.fetch_add(1, std::memory_order_relaxed);
+            } else {
+                member.load_error = "Failed to load vault";
+            }
+        } catch (const std::exception &e) {
+            member.load_error = e.what();
+        }
+    });
+    return loaded.load();
+}
+
+std::string VaultSet::getLoadError(const std::string &file_path) const {
+    const Member *member = findMember(file_path);
+    if (!member) {
+        throw std::invalid_argument("Vault is not in the set: " + file_path);
+    }
+    return member->load_error;
+}
+
+// Поиск: фильтр применяется к каждому хранилищу параллельно, затем
+// отсортированные списки сливаются через кучу
+std::vector<VaultSearchResult> VaultSet::search(const SearchFilter &filter) const {
+    IRONVAULT_TRACE_SPAN_ARG("vault_set.search", "vaults", members.size());
+
+    std::vector<std::vector<CredentialRecord>> partial(members.size());
+    forEachParallel(members.size(), [&](size_t i) {
+        const CredentialVault &vault = *members[i].vault;
+        if (vault.isAuthenticated()) {
+            partial[i] = vault.searchRecords(filter);
+        }
+    });
+
+    size_t total = 0;
+    for (const auto &records: partial) {
+        total += records.size();
+    }
+
+    // Позиция в списке: (хранилище, индекс записи)
+    using Cursor = std::pair<size_t, size_t>;
+    auto later = [&partial](const Cursor &a, const Cursor &b) {
+        std::string_view name_a = partial[a.first][a.second].getServiceName();
+        std::string_view name_b = partial[b.first][b.second].getServiceName();
+        if (name_a != name_b) {
+            return name_a > name_b;
+        }
+        return a.first > b.first;
+    };
+    std::priority_queue<Cursor, std::vector<Cursor>, decltype(later)> heap(later);
+    for (size_t i = 0; i < partial.size(); ++i) {
+        if (!partial[i].empty()) {
+            heap.emplace(i, 0);
+        }
+    }
+
+    std::vector<VaultSearchResult> results;
+    results.reserve(total);
+    while (!heap.empty()) {
+        Cursor cursor = heap.top();
+        heap.pop();
+        results.push_back(VaultSearchResult{members[cursor.first].vault->getVaultFilePath(),
+                                            std::move(partial[cursor.first][cursor.second])});
+        if (cursor.second + 1 < partial[cursor.first].size()) {
+            heap.emplace(cursor.first, cursor.second + 1);
+        }
+    }
+    return results;
+}
+
+// Блокировка всех хранилищ
+void VaultSet::lockAll() {
+    for (auto &member: members) {
+        member.vault->lockVault();
+    }
+    key_cache->clear();
+}
+
+const std::shared_ptr<SessionKeyCache> &VaultSet::getKeyCache() const {
+    return key_cache;
+}
+
+VaultSet::Member *VaultSet::findMember(const std::string &file_path) {
+    for (auto &member: members) {
+        if (member.vault->getVaultFilePath() == file_path) {
+            return &member;
+        }
+    }
+    return nullptr;
+}
+
+const VaultSet::Member *VaultSet::findMember(const std::string &file_path) const {
+    for (const auto &member: members) {
+        if (member.vault->getVaultFilePath() == file_path) {
+            return &member;
+        }
+    }
+    return nullptr;
+}
+
+// Выполнение task(i) для i из [0, count) на ограниченном числе потоков
+void VaultSet::forEachParallel(size_t count, const std::function<void(size_t)> &task) const {
+    ParallelRunner::forEach(count, max_threads, task);
+}
@@ -0,0 +1,74 @@
+#ifndef IRONVAULT_MANAGER_VAULTSET_H
+#define IRONVAULT_MANAGER_VAULTSET_H
+
+#include "CredentialVault.h"
+#include "SessionKeyCache.h"
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+// Запись из результата поиска по нескольким хранилищам
+struct VaultSearchResult {
+    std::string vault_path; // файл хранилища, из которого взята запись
+    CredentialRecord record;
+};
+
+// Набор хранилищ (например, по одному на команду).
+// Хранилища загружаются параллельно и разделяют один кэш ключей сессии;
+// поиск выполняется по всем хранилищам параллельно, результаты сливаются
+// в порядке имени сервиса, затем порядка добавления хранилищ.
+class VaultSet {
+private:
+    struct Member {
+        std::unique_ptr<CredentialVault> vault;
+        std::string load_error; // пусто, если загрузка успешна
+    };
+
+    std::vector<Member> members;
+    std::shared_ptr<SessionKeyCache> key_cache;
+    size_t max_threads;
+
+public:
+    // Конструкторы
+    VaultSet();
+
+    explicit VaultSet(std::shared_ptr<SessionKeyCache> key_cache, size_t max_threads = 0);
+
+    // Управление составом
+    void addVault(const std::string &file_path);
+
+    bool removeVault(const std::string &file_path);
+
+    CredentialVault *getVault(const std::string &file_path);
+
+    size_t getVaultCount() const;
+
+    std::vector<std::string> getVaultPaths() const;
+
+    // Параллельная загрузка всех хранилищ одним мастер-паролем;
+    // возвращает число успешно загруженных
+    size_t loadAll(const std::string &master_password,
+                   const std::string &client_id = CredentialVault::DEFAULT_CLIENT_ID);
+
+    // Текст ошибки загрузки хранилища (пусто, если ошибки не было)
+    std::string getLoadError(const std::string &file_path) const;
+
+    // Параллельный поиск по всем разблокированным хранилищам
+    std::vector<VaultSearchResult> search(const SearchFilter &filter) const;
+
+    // Блокировка всех хранилищ и очистка кэша ключей
+    void lockAll();
+
+    const std::shared_ptr<SessionKeyCache> &getKeyCache() const;
+
+private:
+    Member *findMember(const std::string &file_path);
+
+    const Member *findMember(const std::string &file_path) const;
+
+    void forEachParallel(size_t count, const std::function<void(size_t)> &task) const;
+};
+
+
+#endif //IRONVAULT_MANAGER_VAULTSET_H
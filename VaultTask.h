@@ -0,0 +1,164 @@
+#ifndef IRONVAULT_MANAGER_VAULTTASK_H
+#define IRONVAULT_MANAGER_VAULTTASK_H
+
+#include <condition_variable>
+#include <coroutine>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <optional>
+#include <utility>
+
+template<typename T>
+class VaultTask;
+
+namespace vault_task_detail {
+    // Общая часть обещания: продолжение и исключение
+    struct PromiseBase {
+        std::coroutine_handle<> continuation;
+        std::function<void()> on_complete; // для get(): вызывается, если продолжения нет
+        std::exception_ptr error;
+
+        std::suspend_always initial_suspend() noexcept { return {}; }
+
+        // Завершение передает управление ожидающей сопрограмме без роста стека
+        struct FinalAwaiter {
+            bool await_ready() noexcept { return false; }
+
+            template<typename Promise>
+            std::coroutine_handle<> await_suspend(std::coroutine_handle<Promise> handle) noexcept {
+                PromiseBase &promise = handle.promise();
+                if (promise.continuation) {
+                    return promise.continuation;
+                }
+                if (promise.on_complete) {
+                    // Кадр может быть уничтожен сразу после сигнала: функция
+                    // выносится из обещания до вызова
+                    auto complete = std::move(promise.on_complete);
+                    complete();
+                }
+                return std::noop_coroutine();
+            }
+
+            void await_resume() noexcept {}
+        };
+
+        FinalAwaiter final_suspend() noexcept { return {}; }
+
+        void unhandled_exception() noexcept { error = std::current_exception(); }
+    };
+
+    template<typename T>
+    struct Promise : PromiseBase {
+        std::optional<T> value;
+
+        VaultTask<T> get_return_object();
+
+        void return_value(T result) { value.emplace(std::move(result)); }
+
+        T take() {
+            if (error) {
+                std::rethrow_exception(error);
+            }
+            return std::move(*value);
+        }
+    };
+
+    template<>
+    struct Promise<void> : PromiseBase {
+        VaultTask<void> get_return_object();
+
+        void return_void() noexcept {}
+
+        void take() {
+            if (error) {
+                std::rethrow_exception(error);
+            }
+        }
+    };
+}
+
+// Ленивая задача-сопрограмма: тело начинает выполняться при co_await
+// (или get()), результат и исключение передаются ожидающему. Ожидать
+// можно из сопрограммы любого типа. Задача владеет кадром и ожидается
+// один раз; объект, чей метод вернул задачу, должен пережить ее.
+template<typename T>
+class VaultTask {
+public:
+    using promise_type = vault_task_detail::Promise<T>;
+
+private:
+    std::coroutine_handle<promise_type> handle;
+
+public:
+    // Конструкторы
+    explicit VaultTask(std::coroutine_handle<promise_type> coroutine) : handle(coroutine) {}
+
+    VaultTask(VaultTask &&other) noexcept : handle(std::exchange(other.handle, {})) {}
+
+    VaultTask &operator=(VaultTask &&other) noexcept {
+        if (this != &other) {
+            if (handle) {
+                handle.destroy();
+            }
+            handle = std::exchange(other.handle, {});
+        }
+        return *this;
+    }
+
+    VaultTask(const VaultTask &) = delete;
+
+    VaultTask &operator=(const VaultTask &) = delete;
+
+    ~VaultTask() {
+        if (handle) {
+            handle.destroy();
+        }
+    }
+
+    // Ожидание из сопрограммы
+    auto operator co_await() && noexcept {
+        struct Awaiter {
+            std::coroutine_handle<promise_type> handle;
+
+            bool await_ready() noexcept { return !handle || handle.done(); }
+
+            std::coroutine_handle<> await_suspend(std::coroutine_handle<> awaiting) noexcept {
+                handle.promise().continuation = awaiting;
+                return handle;
+            }
+
+            T await_resume() { return handle.promise().take(); }
+        };
+        return Awaiter{handle};
+    }
+
+    // Запуск и блокирующее ожидание результата (вне цикла событий:
+    // утилиты, тесты)
+    T get() && {
+        std::mutex mutex;
+        std::condition_variable finished;
+        bool done = false;
+        handle.promise().on_complete = [&] {
+            std::lock_guard<std::mutex> lock(mutex);
+            done = true;
+            finished.notify_one();
+        };
+        handle.resume();
+        std::unique_lock<std::mutex> lock(mutex);
+        finished.wait(lock, [&] { return done; });
+        return handle.promise().take();
+    }
+};
+
+template<typename T>
+VaultTask<T> vault_task_detail::Promise<T>::get_return_object() {
+    return VaultTask<T>(std::coroutine_handle<Promise<T>>::from_promise(*this));
+}
+
+inline VaultTask<void> vault_task_detail::Promise<void>::get_return_object() {
+    return VaultTask<void>(std::coroutine_handle<Promise<void>>::from_promise(*this));
+}
+
+
+#endif //IRONVAULT_MANAGER_VAULTTASK_H
@@ -0,0 +1,197 @@
+#include "VaultTrace.h"
+#include <atomic>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace {
+    struct TraceEvent {
+        const char *name;
+        const char *arg_name;
+        uint64_t arg_value;
+        int64_t start_us;
+        int64_t duration_us;
+    };
+
+    // Буфер событий одного потока. Мьютекс почти всегда свободен:
+    // его берет только сам поток и, изредка, выгрузка трассы.
+    struct ThreadBuffer {
+        uint32_t thread_id;
+        std::mutex mutex;
+        std::vector<TraceEvent> events;
+        size_t dropped = 0;
+    };
+
+    struct TraceRegistry {
+        std::mutex mutex;
+        std::vector<std::shared_ptr<ThreadBuffer>> buffers;
+        uint32_t next_thread_id = 1;
+    };
+
+    std::atomic<bool> recording(false);
+    std::atomic<size_t> max_events(VaultTrace::DEFAULT_EVENTS_PER_THREAD);
+    const std::chrono::steady_clock::time_point EPOCH = std::chrono::steady_clock::now();
+
+    TraceRegistry &registry() {
+        static TraceRegistry *instance = new TraceRegistry();
+        return *instance;
+    }
+
+    ThreadBuffer &localBuffer() {
+        thread_local std::shared_ptr<ThreadBuffer> buffer = [] {
+            auto created = std::make_shared<ThreadBuffer>();
+            TraceRegistry &reg = registry();
+            std::lock_guard<std::mutex> lock(reg.mutex);
+            created->thread_id = reg.next_thread_id++;
+            reg.buffers.push_back(created);
+            return created;
+        }();
+        return *buffer;
+    }
+
+    // Экранирование строк для JSON
+    void writeJsonString(std::ostream &out, const char *text) {
+        out << '"';
+        for (const char *c = text; *c; ++c) {
+            switch (*c) {
+                case '"':
+                    out << "\\\"";
+                    break;
+                case '\\':
+                    out << "\\\\";
+                    break;
+                case '\n':
+                    out << "\\n";
+                    break;
+                default:
+                    out << *c;
+            }
+        }
+        out << '"';
+    }
+}
+
+// Span
+VaultTrace::Span::Span(const char *name)
+        : Span(name, nullptr, 0) {}
+
+VaultTrace::Span::Span(const char *name, const char *arg_name, uint64_t arg_value)
+        : name(name), arg_name(arg_name), arg_value(arg_value), start_us(0),
+          active(recording.load(std::memory_order_relaxed)) {
+    if (active) {
+        start_us = nowMicros();
+    }
+}
+
+VaultTrace::Span::~Span() {
+    if (active) {
+        emit(name, arg_name, arg_value, start_us, nowMicros());
+    }
+}
+
+// Включение записи
+void VaultTrace::start(size_t max_events_per_thread) {
+    max_events.store(max_events_per_thread, std::memory_order_relaxed);
+    recording.store(true, std::memory_order_release);
+}
+
+void VaultTrace::stop() {
+    recording.store(false, std::memory_order_release);
+}
+
+bool VaultTrace::isRecording() {
+    return recording.load(std::memory_order_relaxed);
+}
+
+// Очистка буферов всех потоков
+void VaultTrace::clear() {
+    TraceRegistry &reg = registry();
+    std::lock_guard<std::mutex> lock(reg.mutex);
+    for (const auto &buffer: reg.buffers) {
+        std::lock_guard<std::mutex> buffer_lock(buffer->mutex);
+        buffer->events.clear();
+        buffer->dropped = 0;
+    }
+}
+
+// Выгрузка в формате Chrome trace_event
+void VaultTrace::writeChromeTrace(std::ostream &out) {
+    out << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+    bool first = true;
+
+    TraceRegistry &reg = registry();
+    std::lock_guard<std::mutex> lock(reg.mutex);
+    for (const auto &buffer: reg.buffers) {
+        std::lock_guard<std::mutex> buffer_lock(buffer->mutex);
+
+        // Имя потока для Perfetto
+        out << (first ? "" : ",") << "\n{\"ph\":\"M\",\"name\":\"thread_name\",\"pid\":1,\"tid\":"
+            << buffer->thread_id << ",\"args\":{\"name\":\"thread-" << buffer->thread_id << "\"}}";
+        first = false;
+
+        for (const TraceEvent &event: buffer->events) {
+            out << ",\n{\"ph\":\"X\",\"cat\":\"ironvault\",\"name\":";
+            writeJsonString(out, event.name);
+            out << ",\"pid\":1,\"tid\":" << buffer->thread_id
+                << ",\"ts\":" << event.start_us
+                << ",\"dur\":" << event.duration_us;
+            if (event.arg_name) {
+                out << ",\"args\":{";
+                writeJsonString(out, event.arg_name);
+                out << ":" << event.arg_value << "}";
+            }
+            out << "}";
+        }
+    }
+    out << "\n]}\n";
+}
+
+bool VaultTrace::writeChromeTrace(const std::string &file_path) {
+    std::ofstream file(file_path, std::ios::binary);
+    if (!file.is_open()) {
+        return false;
+    }
+    writeChromeTrace(file);
+    return file.good();
+}
+
+// Статистика
+size_t VaultTrace::getEventCount() {
+    size_t total = 0;
+    TraceRegistry &reg = registry();
+    std::lock_guard<std::mutex> lock(reg.mutex);
+    for (const auto &buffer: reg.buffers) {
+        std::lock_guard<std::mutex> buffer_lock(buffer->mutex);
+        total += buffer->events.size();
+    }
+    return total;
+}
+
+size_t VaultTrace::getDroppedCount() {
+    size_t total = 0;
+    TraceRegistry &reg = registry();
+    std::lock_guard<std::mutex> lock(reg.mutex);
+    for (const auto &buffer: reg.buffers) {
+        std::lock_guard<std::mutex> buffer_lock(buffer->mutex);
+        total += buffer->dropped;
+    }
+    return total;
+}
+
+// Приватные методы
+int64_t VaultTrace::nowMicros() {
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now() - EPOCH).count();
+}
+
+// Запись события в буфер потока; при переполнении событие отбрасывается
+void VaultTrace::emit(const char *name, const char *arg_name, uint64_t arg_value, int64_t start_us, int64_t end_us) {
+    ThreadBuffer &buffer = localBuffer();
+    std::lock_guard<std::mutex> lock(buffer.mutex);
+    if (buffer.events.size() >= max_events.load(std::memory_order_relaxed)) {
+        buffer.dropped++;
+        return;
+    }
+    buffer.events.push_back(TraceEvent{name, arg_name, arg_value, start_us, end_us - start_us});
+}
@@ -0,0 +1,76 @@
+#ifndef IRONVAULT_MANAGER_VAULTTRACE_H
+#define IRONVAULT_MANAGER_VAULTTRACE_H
+
+#include <chrono>
+#include <cstdint>
+#include <ostream>
+#include <string>
+
+// Трассировка фаз загрузки, сохранения, шифрования и поиска.
+// Спаны пишутся в буфер своего потока и выгружаются в формате Chrome
+// trace_event (JSON), который открывается в Perfetto и chrome://tracing.
+// Спаны компилируются только с IRONVAULT_ENABLE_TRACING и записываются,
+// пока трассировка включена через VaultTrace::start().
+class VaultTrace {
+public:
+    // Спан: событие "X" (complete) с началом и длительностью
+    class Span {
+    private:
+        const char *name;
+        const char *arg_name;
+        uint64_t arg_value;
+        int64_t start_us;
+        bool active;
+
+    public:
+        explicit Span(const char *name);
+
+        Span(const char *name, const char *arg_name, uint64_t arg_value);
+
+        Span(const Span &) = delete;
+
+        Span &operator=(const Span &) = delete;
+
+        ~Span();
+    };
+
+    // Константы
+    static const size_t DEFAULT_EVENTS_PER_THREAD = 1 << 16;
+
+    // Управление записью
+    static void start(size_t max_events_per_thread = DEFAULT_EVENTS_PER_THREAD);
+
+    static void stop();
+
+    static bool isRecording();
+
+    static void clear();
+
+    // Выгрузка накопленных событий
+    static void writeChromeTrace(std::ostream &out);
+
+    static bool writeChromeTrace(const std::string &file_path);
+
+    static size_t getEventCount();
+
+    static size_t getDroppedCount();
+
+private:
+    static int64_t nowMicros();
+
+    static void emit(const char *name, const char *arg_name, uint64_t arg_value, int64_t start_us, int64_t end_us);
+};
+
+#ifdef IRONVAULT_ENABLE_TRACING
+#define IRONVAULT_TRACE_CONCAT_INNER(a, b) a##b
+#define IRONVAULT_TRACE_CONCAT(a, b) IRONVAULT_TRACE_CONCAT_INNER(a, b)
+#define IRONVAULT_TRACE_SPAN(name) VaultTrace::Span IRONVAULT_TRACE_CONCAT(ironvault_trace_span_, __LINE__)(name)
+#define IRONVAULT_TRACE_SPAN_ARG(name, arg_name, arg_value) \
+    VaultTrace::Span IRONVAULT_TRACE_CONCAT(ironvault_trace_span_, __LINE__)(name, arg_name, arg_value)
+#else
+#define IRONVAULT_TRACE_SPAN(name) ((void)0)
+#define IRONVAULT_TRACE_SPAN_ARG(name, arg_name, arg_value) ((void)0)
+#endif
+
+
+#endif //IRONVAULT_MANAGER_VAULTTRACE_H
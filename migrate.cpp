@@ -0,0 +1,136 @@
+// Офлайн-миграция каталога хранилищ в текущий формат.
+// Использование: IronVault_Migrate <каталог> [--threads N] [--buffer-mb N]
+//                [--codec none|zlib|zstd] [--passwords ФАЙЛ]
+// Без --passwords мастер-пароль запрашивается один раз для всех хранилищ;
+// файл паролей состоит из строк "<имя файла хранилища>\t<мастер-пароль>".
+// Код возврата: 0 - все хранилища перенесены, 1 - были ошибки, 2 - неверный вызов.
+#include "SecureInputBuffer.h"
+#include "VaultMigrator.h"
+#include <openssl/crypto.h>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+
+namespace {
+    void printUsage() {
+        std::cerr << "Usage: IronVault_Migrate <directory> [--threads N] [--buffer-mb N]"
+                     " [--codec none|zlib|zstd] [--passwords FILE]" << std::endl;
+    }
+
+    // Самый сильный кодек сборки: новый формат - сжатые сегменты
+    VaultCompression::Codec defaultCodec() {
+        if (VaultCompression::isAvailable(VaultCompression::Codec::Zstd)) {
+            return VaultCompression::Codec::Zstd;
+        }
+        if (VaultCompression::isAvailable(VaultCompression::Codec::Zlib)) {
+            return VaultCompression::Codec::Zlib;
+        }
+        return VaultCompression::Codec::None;
+    }
+
+    // Пароли по имени файла хранилища
+    std::map<std::string, secure_string> readPasswordFile(const std::string &path) {
+        std::ifstream file(path);
+        if (!file.is_open()) {
+            throw std::runtime_error("Failed to open password file: " + path);
+        }
+        std::map<std::string, secure_string> passwords;
+        std::string line;
+        while (std::getline(file, line)) {
+            size_t tab = line.find('\t');
+            if (tab != std::string::npos && tab > 0 && tab + 1 < line.size()) {
+                passwords[line.substr(0, tab)] = secure_string(std::string_view(line).substr(tab + 1));
+            }
+            OPENSSL_cleanse(line.data(), line.size());
+        }
+        return passwords;
+    }
+}
+
+int main(int argc, char *argv[]) {
+    if (argc < 2) {
+        printUsage();
+        return 2;
+    }
+
+    std::string directory = argv[1];
+    MigrationOptions options;
+    options.codec = defaultCodec();
+    std::string password_file;
+    try {
+        for (int i = 2; i < argc; ++i) {
+            std::string option = argv[i];
+            if (i + 1 >= argc) {
+                throw std::invalid_argument("Missing value for " + option);
+            }
+            std::string value = argv[++i];
+            if (option == "--threads") {
+                options.max_threads = std::stoul(value);
+            } else if (option == "--buffer-mb") {
+                options.max_buffered_bytes = std::stoul(value) * 1024 * 1024;
+            } else if (option == "--codec") {
+                options.codec = VaultCompression::parseCodec(value);
+            } else if (option == "--passwords") {
+                password_file = value;
+            } else {
+                throw std::invalid_argument("Unknown option " + option);
+            }
+        }
+    } catch (const std::exception &e) {
+        std::cerr << e.what() << std::endl;
+        printUsage();
+        return 2;
+    }
+
+    VaultMigrator::PasswordSource passwords;
+    try {
+        if (!password_file.empty()) {
+            auto by_name = std::make_shared<std::map<std::string, secure_string>>(readPasswordFile(password_file));
+            passwords = [by_name](const std::string &vault_path) {
+                auto it = by_name->find(std::filesystem::path(vault_path).filename().string());
+                if (it == by_name->end()) {
+                    throw std::runtime_error("No password for this vault");
+                }
+                return it->second;
+            };
+        } else {
+            std::cout << "Master password for all vaults: " << std::flush;
+            auto shared = std::make_shared<secure_string>(SecureInputBuffer::readSecureString(true));
+            std::cout << std::endl;
+            if (shared->empty()) {
+                std::cerr << "Master password cannot be empty" << std::endl;
+                return 2;
+            }
+            passwords = [shared](const std::string &) { return *shared; };
+        }
+    } catch (const std::exception &e) {
+        std::cerr << e.what() << std::endl;
+        return 2;
+    }
+
+    try {
+        VaultMigrator migrator(directory, passwords, options);
+        migrator.setProgressCallback([](const std::string &vault_path, const std::string &status) {
+            std::cout << vault_path << ": " << status << std::endl;
+        });
+        MigrationReport report = migrator.run();
+
+        std::cout << std::fixed << std::setprecision(2)
+                  << "Scanned " << report.scanned << ", migrated " << report.migrated
+                  << ", up to date " << report.up_to_date << ", resumed " << report.resumed
+                  << ", failed " << report.failed << std::endl
+                  << "Read " << report.bytes_read << " bytes, wrote " << report.bytes_written << " bytes in "
+                  << report.seconds << " s (" << report.vaultsPerSecond() << " vaults/s, "
+                  << report.megabytesPerSecond() << " MB/s, codec "
+                  << VaultCompression::codecName(options.codec) << ")" << std::endl;
+        return report.failed ? 1 : 0;
+    } catch (const std::exception &e) {
+        std::cerr << "Migration failed: " << e.what() << std::endl;
+        return 1;
+    }
+}
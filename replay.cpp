@@ -0,0 +1,97 @@
+// Воспроизведение обезличенной трассы вызовов API на синтетическом хранилище.
+// Использование: IronVault_Replay <трасса> [--work-dir КАТАЛОГ] [--realtime] [--speed X]
+// Трасса записывается ApiTraceRecorder (CredentialVault::setApiTrace).
+// Без --realtime вызовы выполняются подряд; с ним выдерживаются интервалы
+// трассы, ускоренные в X раз. Отчет: задержки по операциям в трассе и
+// при воспроизведении, расхождения числа результатов.
+// Код возврата: 0 - трасса воспроизведена, 1 - ошибка, 2 - неверный вызов.
+#include "ApiTraceReplayer.h"
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+
+namespace {
+    void printUsage() {
+        std::cerr << "Usage: IronVault_Replay <trace> [--work-dir DIR] [--realtime] [--speed X]" << std::endl;
+    }
+
+    // Наносекунды в микросекундах с одним знаком
+    std::string micros(int64_t nanoseconds) {
+        std::ostringstream out;
+        out << std::fixed << std::setprecision(1) << static_cast<double>(nanoseconds) / 1000.0;
+        return out.str();
+    }
+}
+
+int main(int argc, char *argv[]) {
+    if (argc < 2) {
+        printUsage();
+        return 2;
+    }
+
+    std::string trace_path = argv[1];
+    ReplayOptions options;
+    options.work_directory = trace_path + ".replay";
+    try {
+        for (int i = 2; i < argc; ++i) {
+            std::string option = argv[i];
+            if (option == "--realtime") {
+                options.realtime = true;
+                continue;
+            }
+            if (i + 1 >= argc) {
+                throw std::invalid_argument("Missing value for " + option);
+            }
+            std::string value = argv[++i];
+            if (option == "--work-dir") {
+                options.work_directory = value;
+            } else if (option == "--speed") {
+                options.speed = std::stod(value);
+                if (options.speed <= 0) {
+                    throw std::invalid_argument("Speed must be positive");
+                }
+            } else {
+                throw std::invalid_argument("Unknown option " + option);
+            }
+        }
+    } catch (const std::exception &e) {
+        std::cerr << e.what() << std::endl;
+        printUsage();
+        return 2;
+    }
+
+    try {
+        ApiTraceReplayer replayer(trace_path);
+        ReplayReport report = replayer.run(options);
+
+        std::cout << "Snapshot " << report.snapshot_records << " records";
+        if (report.skipped_records) {
+            std::cout << " (" << report.skipped_records << " duplicate names skipped)";
+        }
+        std::cout << ", replayed " << report.calls << " calls in " << std::fixed << std::setprecision(3)
+                  << report.seconds << " s" << std::endl;
+
+        std::cout << std::left << std::setw(10) << "operation" << std::right
+                  << std::setw(8) << "count"
+                  << std::setw(12) << "rec p50" << std::setw(12) << "rec p99" << std::setw(14) << "rec total"
+                  << std::setw(12) << "play p50" << std::setw(12) << "play p99" << std::setw(14) << "play total"
+                  << std::setw(11) << "mismatch" << "   (us)" << std::endl;
+        for (const auto &[name, stats] : report.operations) {
+            std::cout << std::left << std::setw(10) << name << std::right
+                      << std::setw(8) << stats.count
+                      << std::setw(12) << micros(OperationReplayStats::percentile(stats.recorded_ns, 0.5))
+                      << std::setw(12) << micros(OperationReplayStats::percentile(stats.recorded_ns, 0.99))
+                      << std::setw(14) << micros(OperationReplayStats::total(stats.recorded_ns))
+                      << std::setw(12) << micros(OperationReplayStats::percentile(stats.replayed_ns, 0.5))
+                      << std::setw(12) << micros(OperationReplayStats::percentile(stats.replayed_ns, 0.99))
+                      << std::setw(14) << micros(OperationReplayStats::total(stats.replayed_ns))
+                      << std::setw(11) << stats.result_mismatches << std::endl;
+        }
+        return 0;
+    } catch (const std::exception &e) {
+        std::cerr << "Replay failed: " << e.what() << std::endl;
+        return 1;
+    }
+}